@@ -30,9 +30,6 @@
 typedef Bitu IO_ReadHandler(Bitu port,Bitu iolen);
 typedef void IO_WriteHandler(Bitu port,Bitu val,Bitu iolen);
 
-extern IO_WriteHandler * io_writehandlers[3][IO_MAX];
-extern IO_ReadHandler * io_readhandlers[3][IO_MAX];
-
 void IO_RegisterReadHandler(Bitu port,IO_ReadHandler * handler,Bitu mask,Bitu range=1);
 void IO_RegisterWriteHandler(Bitu port,IO_WriteHandler * handler,Bitu mask,Bitu range=1);
 
@@ -47,6 +44,19 @@ Bitu IO_ReadB(Bitu port);
 Bitu IO_ReadW(Bitu port);
 Bitu IO_ReadD(Bitu port);
 
+/* The handler slot of a port stays valid while the emulator runs, so a core
+ * can look it up once for a constant port. */
+IO_ReadHandler ** IO_GetReadSlot(Bitu port,Bitu width);
+IO_WriteHandler ** IO_GetWriteSlot(Bitu port,Bitu width);
+
+Bitu IO_ReadSlotB(Bitu port,IO_ReadHandler ** slot);
+Bitu IO_ReadSlotW(Bitu port,IO_ReadHandler ** slot);
+Bitu IO_ReadSlotD(Bitu port,IO_ReadHandler ** slot);
+
+void IO_WriteSlotB(Bitu port,Bitu val,IO_WriteHandler ** slot);
+void IO_WriteSlotW(Bitu port,Bitu val,IO_WriteHandler ** slot);
+void IO_WriteSlotD(Bitu port,Bitu val,IO_WriteHandler ** slot);
+
 /* Classes to manage the IO objects created by the various devices.
  * The io objects will remove itself on destruction.*/
 class IO_Base{
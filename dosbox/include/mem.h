@@ -52,6 +52,15 @@ bool MEM_ReAllocatePages(MemHandle & handle,Bitu pages,bool sequence);
 MemHandle MEM_NextHandle(MemHandle handle);
 MemHandle MEM_NextHandleAt(MemHandle handle,Bitu where);
 
+/* Copy-on-write snapshot of the guest memory, only the pages written after
+   taking it are copied. Restoring leaves the snapshot in place and invalidates
+   translated code that changed, the cpu state has to be reset by the caller.
+   Only guest RAM is covered; XMS/EMS handles, the DOS file table, video
+   memory and pending PIC events are not, so this is no save state by itself. */
+bool MEM_SnapshotTake(void);
+bool MEM_SnapshotRestore(void);
+void MEM_SnapshotDrop(void);
+
 /* 
 	The folowing six functions are used everywhere in the end so these should be changed for
 	Working on big or little endian machines 
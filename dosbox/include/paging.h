@@ -27,9 +27,12 @@
 #include "mem.h"
 #endif
 
-// disable this to reduce the size of the TLB
-// NOTE: does not work with the dynamic core (dynrec is fine)
+// the dynamic x86 core indexes the TLB arrays directly and needs the full
+// TLB, everything else uses a page directory of TLB tables that are only
+// allocated for the 4MB regions that get mapped
+#if (C_DYNAMIC_X86)
 #define USE_FULL_TLB
+#endif
 
 class PageDirectory;
 
@@ -39,10 +42,10 @@ class PageDirectory;
 #if defined(USE_FULL_TLB)
 #define TLB_SIZE		(1024*1024)
 #else
-#define TLB_SIZE		65536	// This must a power of 2 and greater then LINK_START
-#define BANK_SHIFT		28
-#define BANK_MASK		0xffff // always the same as TLB_SIZE-1?
-#define TLB_BANKS		((1024*1024/TLB_SIZE)-1)
+#define TLB_SIZE		(1024*1024)
+#define TLB_DIR_SHIFT	22
+#define TLB_DIR_SIZE	1024
+#define TLB_TABLE_SIZE	1024
 #endif
 
 #define PFLAG_READABLE		0x1
@@ -140,13 +143,14 @@ union X86PageEntry {
 };
 
 #if !defined(USE_FULL_TLB)
-typedef struct {
-	HostPt read;
-	HostPt write;
-	PageHandler * readhandler;
-	PageHandler * writehandler;
-	Bit32u phys_page;
-} tlb_entry;
+/* The TLB for one 4MB region, same layout as the full TLB */
+struct tlb_table {
+	HostPt read[TLB_TABLE_SIZE];
+	HostPt write[TLB_TABLE_SIZE];
+	PageHandler * readhandler[TLB_TABLE_SIZE];
+	PageHandler * writehandler[TLB_TABLE_SIZE];
+	Bit32u phys_page[TLB_TABLE_SIZE];
+};
 #endif
 
 struct PagingBlock {
@@ -165,8 +169,11 @@ struct PagingBlock {
 		Bit32u	phys_page[TLB_SIZE];
 	} tlb;
 #else
-	tlb_entry tlbh[TLB_SIZE];
-	tlb_entry *tlbh_banks[TLB_BANKS];
+	/* regions without a table of their own share tlb_empty, which is never
+	   written to, so a lookup does not need to check for a missing table */
+	tlb_table * tlb_dir[TLB_DIR_SIZE];
+	tlb_table tlb_empty;
+	Bitu tlb_tables;
 #endif
 	struct {
 		Bitu used;
@@ -174,10 +181,28 @@ struct PagingBlock {
 	} links;
 	Bit32u		firstmb[LINK_START];
 	bool		enabled;
+	bool		pf_unwind;		// the running core can restart a faulting instruction
 };
 
 extern PagingBlock paging; 
 
+/* Thrown by a page fault when paging.pf_unwind is set, the core restores
+   the state from the start of the instruction and raises the exception */
+struct GuestPageFault {
+	Bitu faultcode;
+};
+
+/* Sets for its scope whether page faults unwind to the core or run the
+   fault handler nested, the latter for code that changes cpu state
+   before all of its memory accesses are done */
+class PAGING_FaultScope {
+public:
+	PAGING_FaultScope(bool unwind) : old_unwind(paging.pf_unwind) { paging.pf_unwind=unwind; }
+	~PAGING_FaultScope() { paging.pf_unwind=old_unwind; }
+private:
+	bool old_unwind;
+};
+
 /* Some support functions */
 
 PageHandler * MEM_GetPageHandler(Bitu phys_page);
@@ -220,41 +245,32 @@ static INLINE PhysPt PAGING_GetPhysicalAddress(PhysPt linAddr) {
 
 #else
 
-void PAGING_InitTLBBank(tlb_entry **bank);
-
-static INLINE tlb_entry *get_tlb_entry(PhysPt address) {
-	Bitu index=(address>>12);
-	if (TLB_BANKS && (index > TLB_SIZE)) {
-		Bitu bank=(address>>BANK_SHIFT) - 1;
-		if (!paging.tlbh_banks[bank])
-			PAGING_InitTLBBank(&paging.tlbh_banks[bank]);
-		return &paging.tlbh_banks[bank][index & BANK_MASK];
-	}
-	return &paging.tlbh[index];
+#define TLB_INDEX(address) (((address)>>12)&(TLB_TABLE_SIZE-1))
+
+static INLINE tlb_table * get_tlb_table(PhysPt address) {
+	return paging.tlb_dir[address>>TLB_DIR_SHIFT];
 }
 
 static INLINE HostPt get_tlb_read(PhysPt address) {
-	return get_tlb_entry(address)->read;
+	return get_tlb_table(address)->read[TLB_INDEX(address)];
 }
 static INLINE HostPt get_tlb_write(PhysPt address) {
-	return get_tlb_entry(address)->write;
+	return get_tlb_table(address)->write[TLB_INDEX(address)];
 }
 static INLINE PageHandler* get_tlb_readhandler(PhysPt address) {
-	return get_tlb_entry(address)->readhandler;
+	return get_tlb_table(address)->readhandler[TLB_INDEX(address)];
 }
 static INLINE PageHandler* get_tlb_writehandler(PhysPt address) {
-	return get_tlb_entry(address)->writehandler;
+	return get_tlb_table(address)->writehandler[TLB_INDEX(address)];
 }
 
 /* Use these helper functions to access linear addresses in readX/writeX functions */
 static INLINE PhysPt PAGING_GetPhysicalPage(PhysPt linePage) {
-	tlb_entry *entry = get_tlb_entry(linePage);
-	return (entry->phys_page<<12);
+	return (get_tlb_table(linePage)->phys_page[TLB_INDEX(linePage)]<<12);
 }
 
 static INLINE PhysPt PAGING_GetPhysicalAddress(PhysPt linAddr) {
-	tlb_entry *entry = get_tlb_entry(linAddr);
-	return (entry->phys_page<<12)|(linAddr&0xfff);
+	return (get_tlb_table(linAddr)->phys_page[TLB_INDEX(linAddr)]<<12)|(linAddr&0xfff);
 }
 #endif
 
@@ -29,7 +29,7 @@
 
 #define RENDER_SKIP_CACHE	16
 //Enable this for scalers to support 0 input for empty lines
-//#define RENDER_NULL_INPUT
+#define RENDER_NULL_INPUT
 
 typedef struct {
 	struct { 
@@ -70,6 +70,7 @@ typedef struct {
 		scalerOperation_t op;
 		bool clearCache;
 		bool forced;
+		bool direct;
 		ScalerLineHandler_t lineHandler;
 		ScalerLineHandler_t linePalHandler;
 		ScalerComplexHandler_t complexHandler;
@@ -24,10 +24,11 @@
 #include "dosbox.h"
 #endif
 
-//Don't enable keeping changes and mapping lfb probably...
 #define VGA_LFB_MAPPED
-//#define VGA_KEEP_CHANGES
+//Track the video memory written through the trapping handlers to skip unchanged lines
+#define VGA_KEEP_CHANGES
 #define VGA_CHANGE_SHIFT	9
+#define VGA_CHANGE_WRITTEN	0x2
 
 class PageHandler;
 
@@ -364,13 +365,16 @@ typedef struct {
 } VGA_Memory;
 
 typedef struct {
-	//Add a few more just to be safe
-	Bit8u*	map; /* allocated dynamically: [(VGA_MEMORY >> VGA_CHANGE_SHIFT) + 32] */
-	Bit8u	checkMask, frame, writeMask;
-	bool	active;
-	Bit32u  clearMask;
-	Bit32u	start, last;
-	Bit32u	lastAddress;
+	/* One byte per block of video memory: VGA_CHANGE_WRITTEN is set on writes since
+	 * the current frame started, bit 0 holds the writes during the frame before */
+	Bit8u*	map; /* allocated dynamically: [((VGA_MEMORY << 3) >> VGA_CHANGE_SHIFT) + 32] */
+	Bitu	mapsize;
+	bool	active;			/* the current frame skips unchanged lines */
+	bool	complete;		/* all lines of the last frame were drawn */
+	bool	palette;		/* the dac changed since the last frame */
+	Bitu	skipped;		/* lines skipped in the current frame */
+	Bitu	skipped_last;	/* lines skipped in the last complete frame */
+	Bit64u	total_skipped, total_lines;
 } VGA_Changes;
 
 typedef struct {
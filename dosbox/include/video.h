@@ -53,6 +53,7 @@ struct GFX_PalEntry {
 #define GFX_HARDWARE	0x2000
 
 #define GFX_CAN_RANDOM	0x4000		//If the interface can also do random access surface
+#define GFX_DIRECT		0x8000		//Lines go straight into the display surface, render redraws them per buffer
 
 void GFX_Events(void);
 void GFX_SetPalette(Bitu start,Bitu count,GFX_PalEntry * entries);
@@ -70,6 +71,7 @@ bool GFX_IsDoubleBuffering(void);
 void GFX_SwitchDoubleBuffering(void);
 bool GFX_StartUpdate(Bit8u * & pixels,Bitu & pitch);
 void GFX_EndUpdate( const Bit16u *changedLines );
+bool GFX_DirectOverlaid(void);
 void GFX_GetSize(int &width, int &height, bool &fullscreen);
 void GFX_LosingFocus(void);
 
@@ -0,0 +1,140 @@
+/*
+ *  Copyright (C) 2002-2013  The DOSBox Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Standalone check and benchmark of the 2x2 downscale kernels in
+ * src/gui/sdl_downscaler.h, needs no SDL. Every output pixel is compared with
+ * the exact rounded 2x2 average, then the kernels are timed against the
+ * BLEND16 blit that sdlmain.cpp used before them.
+ *
+ *   g++ -O2 -o downscale scripts/bench/downscale.cpp -lrt
+ *
+ * Add -mno-sse2 on x86-64 to time the portable kernel, which is the one
+ * MIPS and ARM builds run. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <stdint.h>
+
+typedef uint8_t Bit8u;
+typedef uint16_t Bit16u;
+typedef uint32_t Bit32u;
+#define INLINE inline
+
+struct SDL_Surface {
+	int w,h,pitch;
+	void * pixels;
+};
+#define SDL_MUSTLOCK(s) 0
+#define SDL_LockSurface(s) 0
+#define SDL_UnlockSurface(s)
+
+#include "../../src/gui/sdl_downscaler.h"
+
+typedef void (* DownscaleFunc)(SDL_Surface *,SDL_Surface *);
+
+/* The blit sdlmain.cpp did for 640 pixel wide 16bpp modes before the kernels,
+ * halving before adding loses the low bits of every pixel */
+#define BLEND16(A,B) ((((A) >> 1) & 0x7BEF) + (((B) >> 1) & 0x7BEF))
+
+static void OldBlit16(SDL_Surface * source,SDL_Surface * destination) {
+	Bit16u * s=(Bit16u *)source->pixels;
+	Bit16u * d=(Bit16u *)destination->pixels;
+	Bit16u buffer1[320],buffer2[320];
+	int width=source->w/2,height=source->h/2;
+	for (int y=0;y<height;y++) {
+		int offsety=(y << 1)*source->w;
+		for (int x=0;x<width;x++) buffer1[x]=(Bit16u)BLEND16(s[offsety+(x<<1)],s[offsety+(x<<1)+1]);
+		offsety=((y << 1)|1)*source->w;
+		for (int x=0;x<width;x++) buffer2[x]=(Bit16u)BLEND16(s[offsety+(x<<1)],s[offsety+(x<<1)+1]);
+		for (int x=0;x<width;x++) d[y*destination->w+x]=(Bit16u)BLEND16(buffer1[x],buffer2[x]);
+	}
+}
+
+static double Now(void) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC,&t);
+	return t.tv_sec*1e3+t.tv_nsec/1e6;
+}
+
+static double Time(DownscaleFunc func,SDL_Surface * s,SDL_Surface * d,int runs) {
+	double start=Now();
+	for (int i=0;i<runs;i++) func(s,d);
+	return (Now()-start)/runs;
+}
+
+static Bit32u src[640*480],dst[320*240];
+
+static Bit16u Expect16(int x,int y) {
+	const Bit16u * s=(const Bit16u *)src;
+	Bit16u p[4]={s[(2*y)*640+2*x],s[(2*y)*640+2*x+1],s[(2*y+1)*640+2*x],s[(2*y+1)*640+2*x+1]};
+	int r=0,g=0,b=0;
+	for (int i=0;i<4;i++) {
+		r+=p[i]>>11;
+		g+=(p[i]>>5)&63;
+		b+=p[i]&31;
+	}
+	return (Bit16u)((((r+2)>>2)<<11)|(((g+2)>>2)<<5)|((b+2)>>2));
+}
+
+static Bit32u Expect32(int x,int y) {
+	Bit32u p[4]={src[(2*y)*640+2*x],src[(2*y)*640+2*x+1],src[(2*y+1)*640+2*x],src[(2*y+1)*640+2*x+1]};
+	Bit32u e=0;
+	for (int c=0;c<32;c+=8) {
+		int v=0;
+		for (int i=0;i<4;i++) v+=(p[i]>>c)&255;
+		e|=(Bit32u)((v+2)>>2)<<c;
+	}
+	return e;
+}
+
+int main(void) {
+	srand(1);
+	for (int i=0;i<640*480;i++) src[i]=((Bit32u)rand()<<16)^(Bit32u)rand();
+
+	static const int heights[3]={350,400,480};
+	static const DownscaleFunc kernels16[3]={GFX_Downscale_640x350_to_320x240_16,
+		GFX_Downscale_640x400_to_320x240_16,GFX_Downscale_640x480_to_320x240_16};
+	static const DownscaleFunc kernels32[3]={GFX_Downscale_640x350_to_320x240_32,
+		GFX_Downscale_640x400_to_320x240_32,GFX_Downscale_640x480_to_320x240_32};
+	int mismatches=0;
+	for (int bpp=16;bpp<=32;bpp+=16) {
+		for (int k=0;k<3;k++) {
+			SDL_Surface s={640,heights[k],640*bpp/8,src};
+			SDL_Surface d={320,240,320*bpp/8,dst};
+			memset(dst,0,sizeof(dst));
+			(bpp==16 ? kernels16[k] : kernels32[k])(&s,&d);
+			int top=(240-heights[k]/2)/2;
+			for (int y=0;y<heights[k]/2;y++) for (int x=0;x<320;x++) {
+				if (bpp==16) mismatches+=((Bit16u *)dst)[(y+top)*320+x]!=Expect16(x,y);
+				else mismatches+=dst[(y+top)*320+x]!=Expect32(x,y);
+			}
+		}
+	}
+	printf("pixels differing from the exact average: %d\n",mismatches);
+
+	SDL_Surface s16={640,480,1280,src},d16={320,240,640,dst};
+	SDL_Surface s32={640,480,2560,src},d32={320,240,1280,dst};
+	int runs=2000;
+	printf("640x480 16bpp: old blit %.3f ms, kernel %.3f ms per frame\n",
+		Time(OldBlit16,&s16,&d16,runs),Time(GFX_Downscale_640x480_to_320x240_16,&s16,&d16,runs));
+	printf("640x480 32bpp: kernel %.3f ms per frame\n",
+		Time(GFX_Downscale_640x480_to_320x240_32,&s32,&d32,runs));
+	return mismatches!=0;
+}
@@ -0,0 +1,129 @@
+/*
+ *  Copyright (C) 2002-2013  The DOSBox Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Standalone check and benchmark of the area averaging downscaler in
+ * src/gui/sdl_downscaler.h, needs no SDL. Random frames of the modes without
+ * a fixed downscaler are scaled to a 320x240 screen and compared with a
+ * floating point area average, then the time per frame is measured.
+ *
+ *   g++ -O2 -o downscale_area scripts/bench/downscale_area.cpp -lrt */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <stdint.h>
+
+typedef uint8_t Bit8u;
+typedef uint16_t Bit16u;
+typedef uint32_t Bit32u;
+#define INLINE inline
+
+struct SDL_Surface {
+	int w,h,pitch;
+	void * pixels;
+};
+#define SDL_MUSTLOCK(s) 0
+#define SDL_LockSurface(s) 0
+#define SDL_UnlockSurface(s)
+
+#include "../../src/gui/sdl_downscaler.h"
+
+static double Now(void) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC,&t);
+	return t.tv_sec*1e3+t.tv_nsec/1e6;
+}
+
+/* How much of source pixel k lies under output pixel j */
+static double Coverage(int k,int j,int src,int dst) {
+	double lo=(double)j*src/dst,hi=(double)(j+1)*src/dst;
+	if (lo<k) lo=k;
+	if (hi>k+1) hi=k+1;
+	return hi>lo ? hi-lo : 0;
+}
+
+static void Channels(const void * pixels,int index,int bpp,int * c) {
+	if (bpp==16) {
+		Bit16u p=((const Bit16u *)pixels)[index];
+		c[0]=p>>11;c[1]=(p>>5)&63;c[2]=p&31;
+	} else {
+		Bit32u p=((const Bit32u *)pixels)[index];
+		c[0]=(p>>16)&255;c[1]=(p>>8)&255;c[2]=p&255;
+	}
+}
+
+static Bit32u src[1280*1024],dst[320*240];
+
+int main(void) {
+	static const int sizes[][2]={{800,600},{1024,768},{720,400},{1280,1024},{640,200}};
+	const int dw=320,dh=240;
+	int worst=0;
+	srand(2);
+	for (int z=0;z<5;z++) for (int bpp=16;bpp<=32;bpp+=16) {
+		int sw=sizes[z][0],sh=sizes[z][1];
+		for (int i=0;i<sw*sh;i++) {
+			Bit32u v=((Bit32u)rand()<<16)^(Bit32u)rand();
+			if (bpp==16) ((Bit16u *)src)[i]=(Bit16u)v;
+			else src[i]=v&0xffffff;
+		}
+		memset(dst,0,sizeof(dst));
+		if (!GFX_SetupDownscaleArea(sw,sh,dw,dh)) {
+			printf("%dx%d rejected\n",sw,sh);
+			worst=1000;
+			continue;
+		}
+		SDL_Surface s={sw,sh,sw*bpp/8,src};
+		SDL_Surface d={dw,dh,dw*bpp/8,dst};
+		if (bpp==16) GFX_Downscale_Area_16(&s,&d);
+		else GFX_Downscale_Area_32(&s,&d);
+
+		int maxerr=0;
+		for (int j=0;j<dh;j++) for (int i=0;i<dw;i++) {
+			double acc[3]={0,0,0},total=0;
+			int y0=(int)((double)j*sh/dh),y1=(int)ceil((double)(j+1)*sh/dh);
+			int x0=(int)((double)i*sw/dw),x1=(int)ceil((double)(i+1)*sw/dw);
+			for (int y=y0;y<y1 && y<sh;y++) for (int x=x0;x<x1 && x<sw;x++) {
+				double w=Coverage(y,j,sh,dh)*Coverage(x,i,sw,dw);
+				if (!w) continue;
+				int c[3];
+				Channels(src,y*sw+x,bpp,c);
+				for (int n=0;n<3;n++) acc[n]+=w*c[n];
+				total+=w;
+			}
+			int got[3];
+			Channels(dst,j*dw+i,bpp,got);
+			for (int n=0;n<3;n++) {
+				int err=abs(got[n]-(int)lround(acc[n]/total));
+				if (err>maxerr) maxerr=err;
+			}
+		}
+		if (maxerr>worst) worst=maxerr;
+
+		int runs=300;
+		double start=Now();
+		for (int r=0;r<runs;r++) {
+			if (bpp==16) GFX_Downscale_Area_16(&s,&d);
+			else GFX_Downscale_Area_32(&s,&d);
+		}
+		printf("%4dx%-4d %2dbpp -> %dx%d  max channel error %d  %.3f ms per frame\n",
+			sw,sh,bpp,dw,dh,maxerr,(Now()-start)/runs);
+	}
+	return worst>1;
+}
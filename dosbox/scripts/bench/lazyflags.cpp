@@ -0,0 +1,160 @@
+/*
+ *  Copyright (C) 2002-2013  The DOSBox Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Standalone check and benchmark of the lazy flag condition tables in
+ * src/cpu/flags.cpp. Every condition is compared with the get_* combination
+ * the TFLG_* macros used before the tables, exhaustively for the byte flag
+ * types and on edge values for words and dwords. Then common jcc/flag type
+ * pairs are timed both ways.
+ *
+ *   g++ -std=gnu++98 -O2 -I include -I . -I src/cpu `sdl-config --cflags` -o lazyflags \
+ *       scripts/bench/lazyflags.cpp src/cpu/flags.cpp -lrt
+ *
+ * flags.cpp is a separate unit, so the get_* calls stay out of line as they
+ * are in the cores. */
+
+#include <stdio.h>
+#include <time.h>
+
+#include "dosbox.h"
+#include "cpu.h"
+#include "lazyflags.h"
+
+CPU_Regs cpu_regs;
+
+/* The TFLG_* macros before the condition tables */
+static bool OldCond(Bitu cond) {
+	switch (cond) {
+	case 0x0: return get_OF()!=0;
+	case 0x1: return !get_OF();
+	case 0x2: return get_CF()!=0;
+	case 0x3: return !get_CF();
+	case 0x4: return get_ZF()!=0;
+	case 0x5: return !get_ZF();
+	case 0x6: return get_CF() || get_ZF();
+	case 0x7: return !get_CF() && !get_ZF();
+	case 0x8: return get_SF()!=0;
+	case 0x9: return !get_SF();
+	case 0xa: return get_PF()!=0;
+	case 0xb: return !get_PF();
+	case 0xc: return (get_SF()!=0)!=(get_OF()!=0);
+	case 0xd: return (get_SF()!=0)==(get_OF()!=0);
+	case 0xe: return get_ZF() || ((get_SF()!=0)!=(get_OF()!=0));
+	default:  return !get_ZF() && ((get_SF()!=0)==(get_OF()!=0));
+	}
+}
+
+static Bitu mismatches;
+static void Compare(const char * what,Bitu a,Bitu b) {
+	for (Bitu cond=0;cond<16;cond++) {
+		if (OldCond(cond)==(bool)TFLG_COND(cond)) continue;
+		if (mismatches<10) printf("mismatch %s type %d a %x b %x cond %x\n",
+			what,(int)lflags.type,(unsigned)a,(unsigned)b,(unsigned)cond);
+		mismatches++;
+	}
+}
+
+static Bit32u Result(Bitu type,Bit32u a,Bit32u b) {
+	switch (type) {
+	case t_ADDb: case t_ADDw: case t_ADDd: return a+b;
+	case t_SUBb: case t_SUBw: case t_SUBd:
+	case t_CMPb: case t_CMPw: case t_CMPd: return a-b;
+	case t_ANDb: case t_ANDw: case t_ANDd:
+	case t_TESTb: case t_TESTw: case t_TESTd: return a&b;
+	case t_ORb: case t_ORw: case t_ORd: return a|b;
+	case t_XORb: case t_XORw: case t_XORd: return a^b;
+	case t_INCb: case t_INCw: case t_INCd: return a+1;
+	case t_DECb: case t_DECw: case t_DECd: return a-1;
+	default: return 0;
+	}
+}
+
+static void CheckBytes(void) {
+	static const Bitu types[]={t_ADDb,t_SUBb,t_CMPb,t_ANDb,t_ORb,t_XORb,t_TESTb,t_INCb,t_DECb,t_UNKNOWN};
+	for (Bitu t=0;t<sizeof(types)/sizeof(types[0]);t++) {
+		for (Bit32u a=0;a<256;a++) for (Bit32u b=0;b<256;b++) for (Bitu f=0;f<2;f++) {
+			lflags.type=types[t];
+			lf_var1b=a;lf_var2b=b;lf_resb=Result(types[t],a,b);
+			/* Some known flags for t_UNKNOWN and the carry inc/dec keep */
+			if (f) reg_flags=FLAG_CF|((a&1) ? FLAG_OF : 0)|((b&1) ? FLAG_ZF|FLAG_SF : 0)|((a&2) ? FLAG_PF : 0);
+			else reg_flags=(a&4) ? FLAG_SF : 0;
+			Compare("byte",a,b);
+		}
+	}
+}
+
+static void CheckWords(void) {
+	static const Bit32u values[]={0,1,0x7f,0x80,0xff,0x7fff,0x8000,0xffff,0x7fffffff,0x80000000,0xffffffff,12345,0xdeadbeef};
+	static const Bitu types[]={t_ADDw,t_SUBw,t_CMPw,t_ANDw,t_ORw,t_XORw,t_TESTw,t_INCw,t_DECw,
+		t_ADDd,t_SUBd,t_CMPd,t_ANDd,t_ORd,t_XORd,t_TESTd,t_INCd,t_DECd};
+	const Bitu count=sizeof(values)/sizeof(values[0]);
+	for (Bitu t=0;t<sizeof(types)/sizeof(types[0]);t++) {
+		for (Bitu i=0;i<count;i++) for (Bitu j=0;j<count;j++) for (Bitu f=0;f<2;f++) {
+			Bit32u a=values[i],b=values[j];
+			lflags.type=types[t];
+			if (t<9) {
+				lf_var1w=a;lf_var2w=b;lf_resw=Result(types[t],a,b);
+			} else {
+				lf_var1d=a;lf_var2d=b;lf_resd=Result(types[t],a,b);
+			}
+			reg_flags=f ? FLAG_CF : 0;
+			Compare(t<9 ? "word" : "dword",a,b);
+		}
+	}
+}
+
+static double Now(void) {
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC,&t);
+	return t.tv_sec*1e3+t.tv_nsec/1e6;
+}
+
+#define BENCH_LOOPS 50000000
+
+static void Bench(const char * name,Bitu type,Bitu cond) {
+	volatile Bitu taken=0;
+	lflags.type=type;
+	double start=Now();
+	for (Bit32u i=0;i<BENCH_LOOPS;i++) {
+		lf_var1d=i;lf_var2d=i*7;lf_resd=Result(type,i,i*7);
+		taken+=OldCond(cond);
+	}
+	double old_ms=Now()-start;
+	start=Now();
+	for (Bit32u i=0;i<BENCH_LOOPS;i++) {
+		lf_var1d=i;lf_var2d=i*7;lf_resd=Result(type,i,i*7);
+		taken+=TFLG_COND(cond);
+	}
+	double new_ms=Now()-start;
+	printf("%-9s get_* %6.2f ns  table %6.2f ns  %.2fx\n",name,
+		old_ms*1e6/BENCH_LOOPS,new_ms*1e6/BENCH_LOOPS,old_ms/new_ms);
+}
+
+int main(void) {
+	CheckBytes();
+	CheckWords();
+	printf("%lu mismatches\n",(unsigned long)mismatches);
+
+	Bench("cmp+jl",t_CMPd,0xc);
+	Bench("sub+jnz",t_SUBd,0x5);
+	Bench("test+jz",t_TESTd,0x4);
+	Bench("dec+jb",t_DECd,0x2);
+	Bench("add+jg",t_ADDd,0xf);
+	Bench("cmp+jbe",t_CMPd,0x6);
+	return mismatches!=0;
+}
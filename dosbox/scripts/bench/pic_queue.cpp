@@ -0,0 +1,157 @@
+/*
+ *  Copyright (C) 2002-2013  The DOSBox Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Standalone stress test and benchmark of the PIC event queue in
+ * src/hardware/pic.cpp, with the cpu and io parts stubbed out. A random
+ * trace of adds, removals, ties and events that add events runs for 3000
+ * ticks, the order of every dispatch goes into a hash. A second run keeps a
+ * few hundred events pending to time a deep queue.
+ *
+ *   g++ -std=gnu++98 -O2 -I include -I . `sdl-config --cflags` -o pic_queue scripts/bench/pic_queue.cpp -lrt
+ *
+ * To compare with the sorted list the heap replaced, build the same file
+ * against that pic.cpp, both must print the same hash:
+ *
+ *   git show <commit before the heap>:dosbox/src/hardware/pic.cpp > /tmp/pic_list.cpp
+ *   g++ -std=gnu++98 -O2 -I include -I . `sdl-config --cflags` -DPIC_SOURCE='"/tmp/pic_list.cpp"' -o pic_list scripts/bench/pic_queue.cpp -lrt
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <time.h>
+
+#ifndef PIC_SOURCE
+#define PIC_SOURCE "../../src/hardware/pic.cpp"
+#endif
+#include PIC_SOURCE
+
+#include "cpu.h"
+#include "regs.h"
+
+Bit32s CPU_Cycles=0,CPU_CycleLeft=0,CPU_CycleMax=3000;
+MachineType machine=MCH_VGA;
+CPUBlock cpu;
+CPU_Regs cpu_regs;
+CPU_Decoder * cpudecoder;
+
+void IO_ReadHandleObject::Install(Bitu,IO_ReadHandler *,Bitu,Bitu) {}
+void IO_ReadHandleObject::Uninstall() {}
+IO_ReadHandleObject::~IO_ReadHandleObject() {}
+void IO_WriteHandleObject::Install(Bitu,IO_WriteHandler *,Bitu,Bitu) {}
+void IO_WriteHandleObject::Uninstall() {}
+IO_WriteHandleObject::~IO_WriteHandleObject() {}
+void Section::AddDestroyFunction(SectionFunction,bool) {}
+void GFX_ShowMsg(char const *,...) {}
+void E_Exit(char const * format,...) {
+	va_list args;
+	va_start(args,format);
+	vfprintf(stderr,format,args);
+	va_end(args);
+	exit(1);
+}
+bool CPU_CheckIRQ(void) { return false; }
+Bits CPU_Core_Normal_Trap_Run(void) { return 0; }
+void CPU_Interrupt(Bitu,Bitu,Bitu) {}
+
+struct DummySection : public Section {
+	DummySection() : Section("pic") {}
+	std::string GetPropValue(std::string const &) const { return ""; }
+	bool HandleInputline(std::string const &) { return true; }
+	void PrintData(FILE *) const {}
+};
+
+static Bit32u rng=12345;
+static Bit32u Random(void) {
+	rng=rng*1103515245+12345;
+	return rng>>8;
+}
+
+/* FNV-1a over everything that identifies a dispatch */
+static Bit64u hash=14695981039346656037ULL;
+static Bitu dispatches;
+static void Hash(Bit32u val) {
+	for (Bitu i=0;i<4;i++) {
+		hash^=(val>>(i*8)) & 0xff;
+		hash*=1099511628211ULL;
+	}
+}
+
+static void EventA(Bitu val) {
+	Hash(0xa);Hash((Bit32u)PIC_Ticks);Hash((Bit32u)val);Hash((Bit32u)(PIC_TickIndex()*65536.0f));
+	dispatches++;
+	if ((val%7)==0) PIC_AddEvent(EventA,(Random()%1000)/1000.0f,val+1000);
+}
+
+static void EventB(Bitu val) {
+	Hash(0xb);Hash((Bit32u)PIC_Ticks);Hash((Bit32u)val);
+	dispatches++;
+}
+
+/* Keeps itself pending, so the queue stays deep */
+static void EventDeep(Bitu val) {
+	dispatches++;
+	PIC_AddEvent(EventDeep,1.0f+(Random()%4000)/1000.0f,val);
+}
+
+static double Now(void) {
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC,&t);
+	return t.tv_sec*1e3+t.tv_nsec/1e6;
+}
+
+/* Run the queue like the cpu loop does, the cpu work burns random cycles */
+static void RunTicks(Bitu ticks,bool stress) {
+	for (Bitu tick=0;tick<ticks;tick++) {
+		TIMER_AddTick();
+		while (PIC_RunQueue()) {
+			if (stress) {
+				Bit32u r=Random()%100;
+				if (r<40) PIC_AddEvent(EventA,(Random()%3000)/1000.0f,Random()%50);
+				else if (r<55) PIC_AddEvent(EventB,(Random()%4)/4.0f,Random()%5);
+				else if (r<58) PIC_RemoveSpecificEvents(EventA,Random()%50);
+				else if (r<59) PIC_RemoveEvents(EventB);
+			}
+			Bits burn=1+Random()%200;
+			if (burn>CPU_Cycles) burn=CPU_Cycles;
+			CPU_Cycles-=burn;
+		}
+	}
+}
+
+int main(void) {
+	DummySection section;
+	PIC_Init(&section);
+
+	double start=Now();
+	RunTicks(3000,true);
+	double ms=Now()-start;
+	printf("stress: %lu dispatches, hash %016llx, %.1f ns per dispatch\n",
+		(unsigned long)dispatches,(unsigned long long)hash,ms*1e6/dispatches);
+
+	PIC_RemoveEvents(EventA);
+	PIC_RemoveEvents(EventB);
+	for (Bitu i=0;i<400;i++) PIC_AddEvent(EventDeep,(Random()%4000)/1000.0f,i);
+	dispatches=0;
+	start=Now();
+	RunTicks(20000,false);
+	ms=Now()-start;
+	printf("deep queue: %lu dispatches with 400 pending, %.1f ns per dispatch\n",
+		(unsigned long)dispatches,ms*1e6/dispatches);
+	return 0;
+}
@@ -0,0 +1,210 @@
+/*
+ *  Copyright (C) 2002-2013  The DOSBox Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Standalone benchmark of the TLB in src/cpu/paging.cpp, with the cpu and
+ * memory parts stubbed out. Paging stays disabled and every physical page
+ * maps onto a 16MB RAM buffer, so any linear address can be linked. Two
+ * access patterns are run through mem_readd_inline, one over the low 16MB
+ * like a DOS extender, and one spread over the regions a Windows 9x guest
+ * uses. Each read is checked. The time per read, the time to relink a page
+ * after the TLB is cleared, and the TLB memory are printed.
+ *
+ * Build it once with the page directory of TLB tables and once with the
+ * full TLB that the dynamic x86 core needs, then compare:
+ *
+ *   g++ -std=gnu++98 -O2 -I include -I . -I src/cpu `sdl-config --cflags` -o tlb scripts/bench/tlb.cpp -lrt
+ *   g++ -std=gnu++98 -O2 -I include -I . -I src/cpu `sdl-config --cflags` -DUSE_FULL_TLB -o tlb_full scripts/bench/tlb.cpp -lrt
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <time.h>
+
+#include "../../src/cpu/paging.cpp"
+
+#define RAM_PAGES 4096
+
+Bit32s CPU_Cycles=0,CPU_CycleLeft=0;
+Bitu CPU_ArchitectureType=CPU_ARCHTYPE_PENTIUMSLOW;
+HostPt MemBase;
+Segments Segs;
+CPUBlock cpu;
+CPU_Regs cpu_regs;
+CPU_Decoder * cpudecoder;
+LazyFlags lflags;
+
+void GFX_ShowMsg(char const *,...) {}
+void E_Exit(char const * format,...) {
+	va_list args;
+	va_start(args,format);
+	vfprintf(stderr,format,args);
+	va_end(args);
+	exit(1);
+}
+void CPU_Exception(Bitu,Bitu) {}
+Bits CPU_Core_Full_Run(void) { return 0; }
+Bits CPU_Core_Normal_Run(void) { return 0; }
+Bits CPU_Core_Simple_Run(void) { return 0; }
+void DOSBOX_RunMachine(void) {}
+void TIMER_AddTickHandler(TIMER_TickHandler) {}
+void TIMER_DelTickHandler(TIMER_TickHandler) {}
+
+Bit8u mem_readb(PhysPt address) { return mem_readb_inline(address); }
+Bit16u mem_readw(PhysPt address) { return mem_readw_inline(address); }
+Bit32u mem_readd(PhysPt address) { return mem_readd_inline(address); }
+void mem_writeb(PhysPt address,Bit8u val) { mem_writeb_inline(address,val); }
+void mem_writew(PhysPt address,Bit16u val) { mem_writew_inline(address,val); }
+void mem_writed(PhysPt address,Bit32u val) { mem_writed_inline(address,val); }
+Bit16u mem_unalignedreadw(PhysPt address) {
+	return mem_readb_inline(address)|(mem_readb_inline(address+1)<<8);
+}
+Bit32u mem_unalignedreadd(PhysPt address) {
+	return mem_unalignedreadw(address)|(mem_unalignedreadw(address+2)<<16);
+}
+void mem_unalignedwritew(PhysPt address,Bit16u val) {
+	mem_writeb_inline(address,(Bit8u)val);
+	mem_writeb_inline(address+1,(Bit8u)(val>>8));
+}
+void mem_unalignedwrited(PhysPt address,Bit32u val) {
+	mem_unalignedwritew(address,(Bit16u)val);
+	mem_unalignedwritew(address+2,(Bit16u)(val>>16));
+}
+
+/* Every physical page is RAM, wrapped onto the buffer */
+class BenchRAMHandler : public PageHandler {
+public:
+	BenchRAMHandler() {
+		flags=PFLAG_READABLE|PFLAG_WRITEABLE;
+	}
+	HostPt GetHostReadPt(Bitu phys_page) {
+		return MemBase+(phys_page%RAM_PAGES)*4096;
+	}
+	HostPt GetHostWritePt(Bitu phys_page) {
+		return MemBase+(phys_page%RAM_PAGES)*4096;
+	}
+} ram_handler;
+
+PageHandler * MEM_GetPageHandler(Bitu) {
+	return &ram_handler;
+}
+
+struct DummySection : public Section {
+	DummySection() : Section("paging") {}
+	std::string GetPropValue(std::string const &) const { return ""; }
+	bool HandleInputline(std::string const &) { return true; }
+	void PrintData(FILE *) const {}
+};
+
+static Bit32u rng=12345;
+static Bit32u Random(void) {
+	rng=rng*1103515245+12345;
+	return rng>>8;
+}
+
+static double Now(void) {
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC,&t);
+	return t.tv_sec*1e3+t.tv_nsec/1e6;
+}
+
+struct Region {
+	PhysPt start;
+	Bitu pages;
+};
+
+static const Region dos_regions[]={
+	{0x00000000,4096},			// conventional memory and 15MB of extended memory
+};
+
+static const Region win_regions[]={
+	{0x00000000,256},			// first MB
+	{0x00400000,1024},			// application
+	{0x80000000,1024},			// shared arena
+	{0xbff00000,256},			// system dlls
+	{0xc0000000,1024},			// vxds and the kernel heap
+	{0xd0000000,256},
+};
+
+#define BENCH_ADDRESSES (1<<20)
+#define BENCH_PASSES 32
+
+static PhysPt addresses[BENCH_ADDRESSES];
+static Bitu errors;
+
+static void Bench(const char * name,const Region * regions,Bitu count) {
+	Bitu pages=0;
+	for (Bitu i=0;i<count;i++) pages+=regions[i].pages;
+	for (Bitu i=0;i<BENCH_ADDRESSES;i++) {
+		Bitu page=Random()%pages;
+		Bitu r=0;
+		while (page>=regions[r].pages) page-=regions[r++].pages;
+		addresses[i]=regions[r].start+page*4096+(Random()%1021)*4;
+	}
+
+	/* The first pass links every page, check the reads against the RAM contents */
+	PAGING_ClearTLB();
+	for (Bitu i=0;i<BENCH_ADDRESSES;i++) {
+		PhysPt address=addresses[i];
+		Bit32u expected=(Bit32u)(((address>>12)%RAM_PAGES)*4096+(address&4095));
+		if (mem_readd_inline(address)!=expected) errors++;
+	}
+
+	volatile Bit32u sum=0;
+	double start=Now();
+	for (Bitu pass=0;pass<BENCH_PASSES;pass++) {
+		for (Bitu i=0;i<BENCH_ADDRESSES;i++) sum+=mem_readd_inline(addresses[i]);
+	}
+	double read_ms=Now()-start;
+
+	/* Relink every page after a TLB flush, as a cr3 load does */
+	Bitu links=0;
+	start=Now();
+	for (Bitu pass=0;pass<BENCH_PASSES;pass++) {
+		PAGING_ClearTLB();
+		for (Bitu i=0;i<count;i++) {
+			for (Bitu p=0;p<regions[i].pages;p++) sum+=mem_readd_inline(regions[i].start+p*4096);
+			links+=regions[i].pages;
+		}
+	}
+	double link_ms=Now()-start;
+
+	printf("%-4s %5d pages  read %5.2f ns  relink %6.1f ns per page\n",name,(int)pages,
+		read_ms*1e6/(BENCH_PASSES*BENCH_ADDRESSES),link_ms*1e6/links);
+}
+
+int main(void) {
+	MemBase=(HostPt)malloc(RAM_PAGES*4096);
+	for (Bitu i=0;i<RAM_PAGES*4096;i+=4) host_writed(MemBase+i,(Bit32u)i);
+	DummySection section;
+	PAGING_Init(&section);
+
+#if defined(USE_FULL_TLB)
+	printf("full TLB, %dKB\n",(int)(sizeof(paging.tlb)>>10));
+#else
+	printf("TLB tables, %dKB at startup\n",(int)((sizeof(paging.tlb_dir)+sizeof(tlb_table))>>10));
+#endif
+	Bench("dos",dos_regions,sizeof(dos_regions)/sizeof(dos_regions[0]));
+	Bench("win",win_regions,sizeof(win_regions)/sizeof(win_regions[0]));
+#if !defined(USE_FULL_TLB)
+	printf("%d tables allocated, %dKB\n",(int)paging.tlb_tables,
+		(int)((sizeof(paging.tlb_dir)+sizeof(tlb_table)*(paging.tlb_tables+1))>>10));
+#endif
+	printf("%lu read errors\n",(unsigned long)errors);
+	return errors!=0;
+}
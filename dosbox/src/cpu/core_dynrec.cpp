@@ -27,6 +27,8 @@
 #include <string.h>
 #include <stddef.h>
 #include <stdlib.h>
+#include <vector>
+#include <algorithm>
 
 #if defined (WIN32)
 #include <windows.h>
@@ -48,11 +50,14 @@
 #include "cpu.h"
 #include "debug.h"
 #include "paging.h"
+#include "fpu.h"
 #include "inout.h"
 #include "lazyflags.h"
 #include "pic.h"
+#include "mapper.h"
 
 #define CACHE_MAXSIZE	(4096*2)
+// default cache dimensions, pages and blocks scale with the configured size
 #define CACHE_TOTAL		(1024*1024*8)
 #define CACHE_PAGES		(512)
 #define CACHE_BLOCKS	(128*1024)
@@ -60,6 +65,7 @@
 #define DYN_HASH_SHIFT	(4)
 #define DYN_PAGE_HASH	(4096>>DYN_HASH_SHIFT)
 #define DYN_LINKS		(16)
+#define DYN_TRACE_PARTS	(4)		// maximum number of jumps/calls followed in a block
 
 
 //#define DYN_LOG 1 //Turn Logging on.
@@ -128,6 +134,9 @@ static struct {
 	Bitu callback;				// the occurred callback
 	Bitu readdata;				// spare space used when reading from memory
 	Bit32u protected_regs[8];	// space to save/restore register values
+	bool native_fpu;			// translate basic x87 operations to host fpu code
+	bool profile_blocks;		// blocks count how often they're entered
+	bool tiered;				// only translate code that has been interpreted often
 } core_dynrec;
 
 
@@ -153,6 +162,13 @@ static struct {
 
 #include "core_dynrec/decoder.h"
 
+static void LinkBlock(CacheBlockDynRec * from,Bitu index,CacheBlockDynRec * to,PhysPt to_ip) {
+	// an indirect exit that missed its target cache is relinked
+	from->Unlink(index);
+	from->LinkTo(index,to);
+	if (index) from->ind_ip=(Bit32u)(-(Bit32s)to_ip);
+}
+
 CacheBlockDynRec * LinkBlocks(BlockReturn ret) {
 	CacheBlockDynRec * block=NULL;
 	// the last instruction was a control flow modifying instruction
@@ -162,14 +178,38 @@ CacheBlockDynRec * LinkBlocks(BlockReturn ret) {
 		// see if the target is an already translated block
 		block=temp_handler->FindCacheBlock(temp_ip & 4095);
 		if (!block) return NULL;
+		cache_stats.hits++;
 
 		// found it, link the current block to 
-		cache.block.running->LinkTo(ret==BR_Link2,block);
+		LinkBlock(cache.block.running,ret==BR_Link2,block,temp_ip);
 		return block;
 	}
 	return NULL;
 }
 
+// let the normal core run up to max_cycles cycles, returns false if
+// the dynamic core has to be left with the returncode nc_retcode
+static bool RunNormalSlice(Bits max_cycles,Bits & nc_retcode) {
+	// the cycles are used up, return to let the pic run its events
+	if (CPU_Cycles<=0) {
+		nc_retcode=CBRET_NONE;
+		return false;
+	}
+	Bits old_cycles=CPU_Cycles;
+	Bits slice=(old_cycles<max_cycles) ? old_cycles : max_cycles;
+	CPU_Cycles=slice;
+	nc_retcode=CPU_Core_Normal_Run();
+	// keep the trap handling within this core
+	if (cpudecoder==&CPU_Core_Normal_Trap_Run) cpudecoder=&CPU_Core_Dynrec_Trap_Run;
+	if (!nc_retcode && (cpudecoder==&CPU_Core_Dynrec_Run)) {
+		CPU_Cycles+=old_cycles-slice;
+		if (CPU_Cycles<=0) return false;
+		return true;
+	}
+	CPU_CycleLeft+=old_cycles-slice;
+	return false;
+}
+
 /*
 	The core tries to find the block that should be executed next.
 	If such a block is found, it is run, otherwise the instruction
@@ -183,6 +223,10 @@ CacheBlockDynRec * LinkBlocks(BlockReturn ret) {
 */
 
 Bits CPU_Core_Dynrec_Run(void) {
+	// block that exited towards code which was not translated yet
+	CacheBlockDynRec * link_from=NULL;
+	Bitu link_index=0;
+	Bit8u * link_start=NULL;
 	for (;;) {
 		// Determine the linear address of CS:EIP
 		PhysPt ip_point=SegPhys(cs)+reg_eip;
@@ -190,24 +234,53 @@ Bits CPU_Core_Dynrec_Run(void) {
 			if (DEBUG_HeavyIsBreakpoint()) return debugCallback;
 		#endif
 
+		// in tiered mode code is interpreted until its page has become hot
+		if (GCC_UNLIKELY(core_dynrec.tiered) && !(get_tlb_readhandler(ip_point)->flags & PFLAG_HASCODE) &&
+			!cache_tier_hot(ip_point)) {
+			Bits nc_retcode;
+			if (RunNormalSlice(CACHE_TIER_SLICE,nc_retcode)) {
+				link_from=NULL;
+				continue;
+			}
+			return nc_retcode;
+		}
+
 		CodePageHandlerDynRec * chandler=0;
 		// see if the current page is present and contains code
 		if (GCC_UNLIKELY(MakeCodePage(ip_point,chandler))) {
 			// page not present, throw the exception
 			CPU_Exception(cpu.exception.which,cpu.exception.error);
+			link_from=NULL;
 			continue;
 		}
 
 		// page doesn't contain code or is special
 		if (GCC_UNLIKELY(!chandler)) return CPU_Core_Normal_Run();
 
+		// code in this page is modified too often to be worth translating
+		if (GCC_UNLIKELY(chandler->smc.interpret) && chandler->Interpreting()) {
+			// blocks that are still there may run through links only
+			if (chandler->HasBlocks()) chandler->ClearBlocks();
+			Bits nc_retcode;
+			if (RunNormalSlice(CACHE_SMC_SLICE,nc_retcode)) {
+				link_from=NULL;
+				continue;
+			}
+			return nc_retcode;
+		}
+
+		// keep recently executed pages away from eviction
+		chandler->MarkUsed();
+
 		// find correct Dynamic Block to run
 		CacheBlockDynRec * block=chandler->FindCacheBlock(ip_point&4095);
-		if (!block) {
+		if (block) cache_stats.hits++;
+		else {
 			// no block found, thus translate the instruction stream
 			// unless the instruction is known to be modified
 			if (!chandler->invalidation_map || (chandler->invalidation_map[ip_point&4095]<4)) {
 				// translate up to 32 instructions
+				cache_stats.misses++;
 				block=CreateCacheBlock(chandler,ip_point,32);
 			} else {
 				// let the normal core handle this instruction to avoid zero-sized blocks
@@ -216,6 +289,7 @@ Bits CPU_Core_Dynrec_Run(void) {
 				Bits nc_retcode=CPU_Core_Normal_Run();
 				if (!nc_retcode) {
 					CPU_Cycles=old_cycles-1;
+					link_from=NULL;
 					continue;
 				}
 				CPU_CycleLeft+=old_cycles;
@@ -223,6 +297,15 @@ Bits CPU_Core_Dynrec_Run(void) {
 			}
 		}
 
+		if (link_from) {
+			// link the block that exited to here right away instead of waiting
+			// for it to run into its link code again, unless the translation
+			// above has thrown it out of the cache
+			if ((link_from!=block) && link_from->page.handler && link_from->hash.index &&
+				(link_from->cache.start==link_start)) LinkBlock(link_from,link_index,block,ip_point);
+			link_from=NULL;
+		}
+
 run_block:
 		cache.block.running=0;
 		// now we're ready to run the dynamic code block
@@ -288,6 +371,10 @@ run_block:
 		case BR_Link2:
 			block=LinkBlocks(ret);
 			if (block) goto run_block;
+			// target not translated yet, link to it after the translation
+			link_from=cache.block.running;
+			link_index=(ret==BR_Link2);
+			link_start=link_from->cache.start;
 			break;
 
 		default:
@@ -316,7 +403,82 @@ Bits CPU_Core_Dynrec_Trap_Run(void) {
 	return ret;
 }
 
+// order blocks by the estimated number of cycles spent in them
+static bool ProfileHotter(const CacheBlockDynRec * a,const CacheBlockDynRec * b) {
+	return (Bit64u)a->prof.entries*a->prof.cycles>(Bit64u)b->prof.entries*b->prof.cycles;
+}
+
+#define PROFILE_DUMP_BLOCKS 64
+#define PROFILE_DUMP_FILE "dynrec_profile.txt"
+
+// write the hottest translated blocks to a text file
+static void CPU_Core_Dynrec_DumpProfile(bool pressed) {
+	if (!pressed) return;
+	if (!core_dynrec.profile_blocks) {
+		LOG_MSG("DYNREC:Block profiling is disabled, set dynamic_blockprofile=true");
+		return;
+	}
+	if (!cache_initialized) return;
+	std::vector<CacheBlockDynRec *> blocks;
+	for (Bitu i=0;i<cache_size.blocks;i++) {
+		CacheBlockDynRec * block=&cache_blocks[i];
+		// only the first part of a block counts the entries
+		if (block->page.handler && block->hash.index && block->prof.entries) blocks.push_back(block);
+	}
+	Bitu count=blocks.size();
+	if (count>PROFILE_DUMP_BLOCKS) count=PROFILE_DUMP_BLOCKS;
+	std::partial_sort(blocks.begin(),blocks.begin()+count,blocks.end(),ProfileHotter);
+
+	FILE * f=fopen(PROFILE_DUMP_FILE,"wt");
+	if (!f) {
+		LOG_MSG("DYNREC:Can't write block profile to %s",PROFILE_DUMP_FILE);
+		return;
+	}
+	fprintf(f,"%d translated blocks entered, %d hits, %d misses\n\n",
+		(int)blocks.size(),(int)cache_stats.hits,(int)cache_stats.misses);
+	fprintf(f,"rank  cs:ip          parts guest  host     entries       cycles  invalidations\n");
+	for (Bitu i=0;i<count;i++) {
+		CacheBlockDynRec * block=blocks[i];
+		Bitu parts=0,guest_size=0,invalidations=0;
+		CacheBlockDynRec * part=block;
+		do {
+			parts++;
+			guest_size+=part->page.end-part->page.start+1;
+			// the invalidation map counts the modifications per byte
+			Bit8u * invmap=part->page.handler->invalidation_map;
+			if (invmap) {
+				for (Bitu b=part->page.start;b<=part->page.end;b++) {
+					if (invmap[b]>invalidations) invalidations=invmap[b];
+				}
+			}
+			part=part->crossblock;
+		} while (part && (part!=block));
+		fprintf(f,"%4d  %04X:%08X %5d %5d %5d %11u %12.0f  %d\n",(int)(i+1),
+			block->prof.cs,block->prof.ip,(int)parts,(int)guest_size,(int)block->cache.size,
+			block->prof.entries,(double)block->prof.entries*block->prof.cycles,(int)invalidations);
+	}
+	fclose(f);
+	LOG_MSG("DYNREC:Wrote the %d hottest blocks to %s",(int)count,PROFILE_DUMP_FILE);
+}
+
 void CPU_Core_Dynrec_Init(void) {
+	MAPPER_AddHandler(CPU_Core_Dynrec_DumpProfile,MK_f6,MMOD1|MMOD2,"dynprofile","Dyn Profile");
+}
+
+void CPU_Core_Dynrec_Cache_SetSize(Bitu size_kb) {
+	cache_setsize(size_kb*1024);
+}
+
+void CPU_Core_Dynrec_SetNativeFPU(bool native) {
+	core_dynrec.native_fpu=native;
+}
+
+void CPU_Core_Dynrec_SetProfiling(bool enable) {
+	core_dynrec.profile_blocks=enable;
+}
+
+void CPU_Core_Dynrec_SetTiered(bool tiered) {
+	core_dynrec.tiered=tiered;
 }
 
 void CPU_Core_Dynrec_Cache_Init(bool enable_cache) {
@@ -326,6 +488,7 @@ void CPU_Core_Dynrec_Cache_Init(bool enable_cache) {
 
 void CPU_Core_Dynrec_Cache_Close(void) {
 	cache_close();
+	LogFlagsOptimization();
 }
 
 #endif
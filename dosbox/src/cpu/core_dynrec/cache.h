@@ -23,6 +23,17 @@ class CodePageHandlerDynRec;	// forward
 class CacheBlockDynRec {
 public:
 	void Clear(void);
+	// remove the link of the code path index, it points to the default linking code afterwards
+	void Unlink(Bitu index);
+	// check if block is one of the parts (page crossing or jump target) this block belongs to
+	bool IsPartOf(CacheBlockDynRec * block) {
+		CacheBlockDynRec * part=this;
+		do {
+			if (part==block) return true;
+			part=part->crossblock;
+		} while (part && (part!=this));
+		return false;
+	}
 	// link this cache block to another block, index specifies the code
 	// path (always zero for unconditional links, 0/1 for conditional ones
 	void LinkTo(Bitu index,CacheBlockDynRec * toblock) {
@@ -54,7 +65,18 @@ public:
 		CacheBlockDynRec * next;
 		CacheBlockDynRec * from;	// the from-block can transfer control to this block
 	} link[2];	// maximum two links (conditional jumps)
+	// negated linear address link[1] was last linked to if the block
+	// ends in an indirect near branch (see dyn_exit_indirect)
+	Bit32u ind_ip;
 	CacheBlockDynRec * crossblock;
+	// block profiling, the entry counter is only maintained
+	// by blocks translated while profiling is enabled
+	struct {
+		Bit32u entries;			// number of times the block was entered
+		Bit32u ip;				// guest cs:ip the block was translated at
+		Bit16u cs;
+		Bit16u cycles;			// cycles charged for one run through the block
+	} prof;
 };
 
 static struct {
@@ -71,6 +93,79 @@ static struct {
 } cache;
 
 
+// dimensions of the cache, set up by cache_init according to the configured size
+static struct {
+	Bitu total;			// size of the code cache in bytes
+	Bitu pages;			// number of code page handlers
+	Bitu blocks;		// number of cache blocks
+	Bitu config;		// requested code cache size
+} cache_size={CACHE_TOTAL,CACHE_PAGES,CACHE_BLOCKS,CACHE_TOTAL};
+
+// statistics to help sizing the cache
+static struct {
+	Bitu hits;			// block found by the core
+	Bitu misses;		// block had to be translated
+	Bitu page_evicts;	// code pages thrown out to make room for new ones
+	Bitu block_evicts;	// blocks overwritten when the code cache wrapped around
+	Bitu smc_demotions;	// code pages left to the normal core due to frequent modification
+	Bitu smc_promotions;	// such pages translated again after they went quiet
+	Bitu tier_promotions;	// pages that were run often enough to be translated (tiered mode)
+} cache_stats;
+
+// pages whose translated code is written CACHE_SMC_WRITES times within a second
+// are run by the normal core until the modified code has been left alone for
+// CACHE_SMC_QUIET milliseconds; the normal core runs CACHE_SMC_SLICE cycles
+// before the page is looked at again
+#define CACHE_SMC_WRITES	32
+#define CACHE_SMC_QUIET		2000
+#define CACHE_SMC_SLICE		64
+#define CACHE_SMC_LOG_PAGES	8
+
+// the most recently demoted pages, for the statistics
+static struct {
+	Bitu page[CACHE_SMC_LOG_PAGES];
+	Bitu count[CACHE_SMC_LOG_PAGES];
+	Bitu pos;
+} cache_smc_log;
+
+static void cache_smc_demoted(Bitu phys_page) {
+	cache_stats.smc_demotions++;
+	for (Bitu i=0;i<CACHE_SMC_LOG_PAGES;i++) {
+		if (cache_smc_log.count[i] && (cache_smc_log.page[i]==phys_page)) {
+			cache_smc_log.count[i]++;
+			return;
+		}
+	}
+	cache_smc_log.page[cache_smc_log.pos]=phys_page;
+	cache_smc_log.count[cache_smc_log.pos]=1;
+	cache_smc_log.pos=(cache_smc_log.pos+1)%CACHE_SMC_LOG_PAGES;
+}
+
+// in tiered mode code is run by the normal core until its page has been
+// entered CACHE_TIER_HOT times, only then the page is translated; the normal
+// core runs CACHE_TIER_SLICE cycles per entry, and the entries are counted
+// per physical page of guest memory
+#define CACHE_TIER_HOT		64
+#define CACHE_TIER_SLICE	64
+
+static struct {
+	Bit8u * count;		// entries per physical page, allocated with the cache
+	Bitu pages;
+} cache_tier;
+
+// count an entry into the page of ip_point, true if the page should be translated
+static bool cache_tier_hot(PhysPt ip_point) {
+	Bitu phys_page=ip_point>>12;
+	// pages that aren't present or aren't RAM are left to MakeCodePage
+	if (!PAGING_MakePhysPage(phys_page) || (phys_page>=cache_tier.pages)) return true;
+	Bit8u & count=cache_tier.count[phys_page];
+	if (count>=CACHE_TIER_HOT) return true;
+	if (++count<CACHE_TIER_HOT) return false;
+	cache_stats.tier_promotions++;
+	return true;
+}
+
+
 // cache memory pointers, to be malloc'd later
 static Bit8u * cache_code_start_ptr=NULL;
 static Bit8u * cache_code=NULL;
@@ -101,6 +196,8 @@ public:
 
 		active_blocks=0;
 		active_count=16;
+		memset(&smc,0,sizeof(smc));
+		smc.tick=PIC_Ticks;
 
 		// initialize the maps with zero (no cache blocks as well as code present)
 		memset(&hash_map,0,sizeof(hash_map));
@@ -130,7 +227,11 @@ public:
 				// test if this block is in the range
 				if (start<=block->page.end && end>=block->page.start) {
 					if (ip_point<=block->page.end && ip_point>=block->page.start) is_current_block=true;
+					// the running block may consist of several parts
+					else if (block->crossblock && block->IsPartOf(cache.block.running)) is_current_block=true;
 					block->Clear();		// clear the block, decrements the write_map accordingly
+					// other parts of the block may have been removed from this list as well
+					nextblock=hash_map[index];
 				}
 				block=nextblock;
 			}
@@ -146,6 +247,10 @@ public:
 		host_writeb(hostmem+addr,val);
 		// see if there's code where we are writing to
 		if (!host_readb(&write_map[addr])) {
+			if (GCC_UNLIKELY(smc.interpret)) {
+				NoteDataWrite(addr,1);
+				return;
+			}
 			if (active_blocks) return;		// still some blocks in this page
 			active_count--;
 			if (!active_count) Release();	// delay page releasing until active_count is zero
@@ -155,6 +260,7 @@ public:
 			memset(invalidation_map,0,4096);
 		}
 		invalidation_map[addr]++;
+		NoteCodeWrite();
 		InvalidateRange(addr,addr);
 	}
 	void writew(PhysPt addr,Bitu val){
@@ -163,6 +269,10 @@ public:
 		host_writew(hostmem+addr,val);
 		// see if there's code where we are writing to
 		if (!host_readw(&write_map[addr])) {
+			if (GCC_UNLIKELY(smc.interpret)) {
+				NoteDataWrite(addr,2);
+				return;
+			}
 			if (active_blocks) return;		// still some blocks in this page
 			active_count--;
 			if (!active_count) Release();	// delay page releasing until active_count is zero
@@ -177,6 +287,7 @@ public:
 #else
 		(*(Bit16u*)&invalidation_map[addr])+=0x101;
 #endif
+		NoteCodeWrite();
 		InvalidateRange(addr,addr+1);
 	}
 	void writed(PhysPt addr,Bitu val){
@@ -185,6 +296,10 @@ public:
 		host_writed(hostmem+addr,val);
 		// see if there's code where we are writing to
 		if (!host_readd(&write_map[addr])) {
+			if (GCC_UNLIKELY(smc.interpret)) {
+				NoteDataWrite(addr,4);
+				return;
+			}
 			if (active_blocks) return;		// still some blocks in this page
 			active_count--;
 			if (!active_count) Release();	// delay page releasing until active_count is zero
@@ -199,6 +314,7 @@ public:
 #else
 		(*(Bit32u*)&invalidation_map[addr])+=0x1010101;
 #endif
+		NoteCodeWrite();
 		InvalidateRange(addr,addr+3);
 	}
 	bool writeb_checked(PhysPt addr,Bitu val) {
@@ -206,7 +322,8 @@ public:
 		if (host_readb(hostmem+addr)==(Bit8u)val) return false;
 		// see if there's code where we are writing to
 		if (!host_readb(&write_map[addr])) {
-			if (!active_blocks) {
+			if (GCC_UNLIKELY(smc.interpret)) NoteDataWrite(addr,1);
+			else if (!active_blocks) {
 				// no blocks left in this page, still delay the page releasing a bit
 				active_count--;
 				if (!active_count) Release();
@@ -217,6 +334,7 @@ public:
 				memset(invalidation_map,0,4096);
 			}
 			invalidation_map[addr]++;
+			NoteCodeWrite();
 			if (InvalidateRange(addr,addr)) {
 				cpu.exception.which=SMC_CURRENT_BLOCK;
 				return true;
@@ -230,7 +348,8 @@ public:
 		if (host_readw(hostmem+addr)==(Bit16u)val) return false;
 		// see if there's code where we are writing to
 		if (!host_readw(&write_map[addr])) {
-			if (!active_blocks) {
+			if (GCC_UNLIKELY(smc.interpret)) NoteDataWrite(addr,2);
+			else if (!active_blocks) {
 				// no blocks left in this page, still delay the page releasing a bit
 				active_count--;
 				if (!active_count) Release();
@@ -246,6 +365,7 @@ public:
 #else
 			(*(Bit16u*)&invalidation_map[addr])+=0x101;
 #endif
+			NoteCodeWrite();
 			if (InvalidateRange(addr,addr+1)) {
 				cpu.exception.which=SMC_CURRENT_BLOCK;
 				return true;
@@ -259,7 +379,8 @@ public:
 		if (host_readd(hostmem+addr)==(Bit32u)val) return false;
 		// see if there's code where we are writing to
 		if (!host_readd(&write_map[addr])) {
-			if (!active_blocks) {
+			if (GCC_UNLIKELY(smc.interpret)) NoteDataWrite(addr,4);
+			else if (!active_blocks) {
 				// no blocks left in this page, still delay the page releasing a bit
 				active_count--;
 				if (!active_count) Release();
@@ -275,6 +396,7 @@ public:
 #else
 			(*(Bit32u*)&invalidation_map[addr])+=0x1010101;
 #endif
+			NoteCodeWrite();
 			if (InvalidateRange(addr,addr+3)) {
 				cpu.exception.which=SMC_CURRENT_BLOCK;
 				return true;
@@ -348,19 +470,73 @@ public:
 		cache.free_pages=this;
 		prev=0;
 	}
-	void ClearRelease(void) {
-		// clear out all cache blocks in this page
+	// move the page to the end of the used pages list, so the pages at the
+	// front are the ones that have not been executed for the longest time
+	void MarkUsed(void) {
+		if (!next) return;		// already the most recently used page
+		if (prev) prev->next=next;
+		else cache.used_pages=next;
+		next->prev=prev;
+		prev=cache.last_page;
+		prev->next=this;
+		next=0;
+		cache.last_page=this;
+	}
+	// clear out all cache blocks in this page, clearing a block removes
+	// its other parts (which may be in this page as well) from the maps
+	void ClearBlocks(void) {
 		for (Bitu index=0;index<(1+DYN_PAGE_HASH);index++) {
-			CacheBlockDynRec * block=hash_map[index];
-			while (block) {
-				CacheBlockDynRec * nextblock=block->hash.next;
-				block->page.handler=0;			// no need, full clear
-				block->Clear();
-				block=nextblock;
-			}
+			while (hash_map[index]) hash_map[index]->Clear();
 		}
+	}
+	void ClearRelease(void) {
+		ClearBlocks();
 		Release();	// now can release this page
 	}
+	// count a write to translated code, pages that are modified too often
+	// are run by the normal core for a while (see CPU_Core_Dynrec_Run)
+	void NoteCodeWrite(void) {
+		if (smc.interpret) {
+			smc.last=PIC_Ticks;
+			return;
+		}
+		if ((PIC_Ticks-smc.tick)>=1000) {
+			smc.tick=PIC_Ticks;
+			smc.writes=0;
+		}
+		if (++smc.writes>=CACHE_SMC_WRITES) {
+			smc.interpret=true;
+			smc.last=PIC_Ticks;
+			cache_smc_demoted(phys_page);
+		}
+	}
+	// while the page is interpret-only only writes to code that was
+	// modified before keep it from being translated again
+	void NoteDataWrite(Bitu addr,Bitu len) {
+		for (Bitu i=0;i<len;i++) {
+			if (invalidation_map[addr+i]) {
+				smc.last=PIC_Ticks;
+				return;
+			}
+		}
+	}
+	// check if the page still has to be run by the normal core,
+	// it gets a fresh start once it has not been modified for a while
+	bool Interpreting(void) {
+		if ((PIC_Ticks-smc.last)<CACHE_SMC_QUIET) return true;
+		smc.interpret=false;
+		smc.tick=PIC_Ticks;
+		smc.writes=0;
+		if (invalidation_map!=NULL) {
+			free(invalidation_map);
+			invalidation_map=NULL;
+		}
+		cache_stats.smc_promotions++;
+		return false;
+	}
+	bool HasBlocks(void) {
+		return active_blocks!=0;
+	}
 
 	CacheBlockDynRec * FindCacheBlock(Bitu start) {
 		CacheBlockDynRec * block=hash_map[1+(start>>DYN_HASH_SHIFT)];
@@ -384,6 +560,12 @@ public:
 	Bit8u write_map[4096];
 	Bit8u * invalidation_map;
 	CodePageHandlerDynRec * next, * prev;	// page linking
+	struct {
+		Bitu tick;			// start of the interval the code writes are counted in
+		Bitu writes;		// writes to translated code in the interval
+		Bitu last;			// last write to modified code while interpret-only
+		bool interpret;		// the page is run by the normal core
+	} smc;
 private:
 	PageHandler * old_pagehandler;
 
@@ -412,6 +594,24 @@ static CacheBlockDynRec * cache_getblock(void) {
 	return ret;
 }
 
+void CacheBlockDynRec::Unlink(Bitu index) {
+	if (link[index].to!=&link_blocks[index]) {
+		// not linked to the standard linkcode, find the block that links to this block
+		CacheBlockDynRec * * wherelink=&link[index].to->link[index].from;
+		while (*wherelink != this && *wherelink) {
+			wherelink = &(*wherelink)->link[index].next;
+		}
+		// now remove the link
+		if(*wherelink) 
+			*wherelink = (*wherelink)->link[index].next;
+		else {
+			LOG(LOG_CPU,LOG_ERROR)("Cache anomaly. please investigate");
+		}
+		link[index].to=&link_blocks[index];
+		link[index].next=0;
+	}
+}
+
 void CacheBlockDynRec::Clear(void) {
 	Bitu ind;
 	// check if this is not a cross page block
@@ -426,26 +626,20 @@ void CacheBlockDynRec::Clear(void) {
 
 			fromlink=nextlink;
 		}
-		if (link[ind].to!=&link_blocks[ind]) {
-			// not linked to the standard linkcode, find the block that links to this block
-			CacheBlockDynRec * * wherelink=&link[ind].to->link[ind].from;
-			while (*wherelink != this && *wherelink) {
-				wherelink = &(*wherelink)->link[ind].next;
-			}
-			// now remove the link
-			if(*wherelink) 
-				*wherelink = (*wherelink)->link[ind].next;
-			else {
-				LOG(LOG_CPU,LOG_ERROR)("Cache anomaly. please investigate");
-			}
-		}
-	} else 
+		Unlink(ind);
+	} else if (page.handler)
 		cache_addunusedblock(this);
 	if (crossblock) {
-		// clear out the crossblock (in the page before) as well
-		crossblock->crossblock=0;
-		crossblock->Clear();
+		// clear out the other parts of the block (in other pages or
+		// at jump targets) as well, they're chained into a ring
+		CacheBlockDynRec * part=crossblock;
 		crossblock=0;
+		while (part && (part!=this)) {
+			CacheBlockDynRec * nextpart=part->crossblock;
+			part->crossblock=0;
+			part->Clear();
+			part=nextpart;
+		}
 	}
 	if (page.handler) {
 		// clear out the code page handler
@@ -464,8 +658,10 @@ static CacheBlockDynRec * cache_openblock(void) {
 	// check for enough space in this block
 	Bitu size=block->cache.size;
 	CacheBlockDynRec * nextblock=block->cache.next;
-	if (block->page.handler) 
+	if (block->page.handler) {
+		cache_stats.block_evicts++;
 		block->Clear();
+	}
 	// block size must be at least CACHE_MAXSIZE
 	while (size<CACHE_MAXSIZE) {
 		if (!nextblock)
@@ -473,8 +669,10 @@ static CacheBlockDynRec * cache_openblock(void) {
 		// merge blocks
 		size+=nextblock->cache.size;
 		CacheBlockDynRec * tempblock=nextblock->cache.next;
-		if (nextblock->page.handler) 
+		if (nextblock->page.handler) {
+			cache_stats.block_evicts++;
 			nextblock->Clear();
+		}
 		// block is free now
 		cache_addunusedblock(nextblock);
 		nextblock=tempblock;
@@ -496,6 +694,7 @@ static void cache_closeblock(void) {
 	block->link[1].from=0;
 	block->link[0].next=0;
 	block->link[1].next=0;
+	block->ind_ip=0;
 	// close the block with correct alignment
 	Bitu written=(Bitu)(cache.pos-block->cache.start);
 	if (written>block->cache.size) {
@@ -518,7 +717,7 @@ static void cache_closeblock(void) {
 		}
 	}
 	// advance the active block pointer
-	if (!block->cache.next || (block->cache.next->cache.start>(cache_code_start_ptr + CACHE_TOTAL - CACHE_MAXSIZE))) {
+	if (!block->cache.next || (block->cache.next->cache.start>(cache_code_start_ptr + cache_size.total - CACHE_MAXSIZE))) {
 //		LOG_MSG("Cache full restarting");
 		cache.block.active=cache.block.first;
 	} else {
@@ -563,21 +762,88 @@ static void dyn_run_code(void);
 #endif
 
 static bool cache_initialized = false;
+#if defined (WIN32)
+static bool cache_code_virtualalloc = false;
+#endif
+
+static void cache_log_stats(void) {
+	LOG_MSG("DYNREC:Cache %dKB, %d hits, %d misses, %d pages and %d blocks evicted",
+		cache_size.total>>10,cache_stats.hits,cache_stats.misses,cache_stats.page_evicts,cache_stats.block_evicts);
+	if (cache_stats.smc_demotions) {
+		LOG_MSG("DYNREC:%d code pages demoted to the normal core due to self-modification, %d translated again",
+			cache_stats.smc_demotions,cache_stats.smc_promotions);
+		for (Bitu i=0;i<CACHE_SMC_LOG_PAGES;i++) {
+			if (cache_smc_log.count[i]) LOG_MSG("DYNREC:  page %X demoted %d times",
+				cache_smc_log.page[i]<<12,cache_smc_log.count[i]);
+		}
+	}
+	if (cache_stats.tier_promotions)
+		LOG_MSG("DYNREC:%d pages were run often enough to be translated",cache_stats.tier_promotions);
+}
+
+// set the size of the code cache, becomes active with the next cache_init
+static void cache_setsize(Bitu size) {
+	if (size<CACHE_MAXSIZE*16) size=CACHE_MAXSIZE*16;
+	cache_size.config=size&~(PAGESIZE_TEMP-1);
+}
+
+// throw away all translated code and free the cache memory
+static void cache_free(void) {
+	// release the code pages, this restores the original page handlers
+	while (cache.used_pages) cache.used_pages->ClearRelease();
+	while (cache.free_pages) {
+		CodePageHandlerDynRec * npage=cache.free_pages->next;
+		delete cache.free_pages;
+		cache.free_pages=npage;
+	}
+	cache.last_page=0;
+	cache.block.running=0;
+	free(cache_blocks);
+	cache_blocks=NULL;
+	free(cache_tier.count);
+	cache_tier.count=NULL;
+	cache_tier.pages=0;
+#if defined (WIN32)
+	if (cache_code_virtualalloc) VirtualFree(cache_code_start_ptr,0,MEM_RELEASE);
+	else
+#endif
+	free(cache_code_start_ptr);
+	cache_code_start_ptr=NULL;
+	cache_code=NULL;
+	cache_code_link_blocks=NULL;
+	cache_initialized=false;
+}
 
 static void cache_init(bool enable) {
 	Bits i;
 	if (enable) {
 		// see if cache is already initialized
-		if (cache_initialized) return;
+		if (cache_initialized) {
+			if (cache_size.total==cache_size.config) return;
+			// the cache size has been changed, start over with an empty cache
+			cache_log_stats();
+			cache_free();
+		}
 		cache_initialized = true;
 		if (cache_blocks == NULL) {
+			// the number of blocks and code pages scales with the cache size
+			cache_size.total=cache_size.config;
+			cache_size.blocks=(Bitu)(((Bit64u)CACHE_BLOCKS*cache_size.total)/CACHE_TOTAL);
+			cache_size.pages=(Bitu)(((Bit64u)CACHE_PAGES*cache_size.total)/CACHE_TOTAL);
+			if (cache_size.pages<16) cache_size.pages=16;
+			memset(&cache_stats,0,sizeof(cache_stats));
+			memset(&cache_smc_log,0,sizeof(cache_smc_log));
+			cache_tier.pages=MEM_TotalPages();
+			cache_tier.count=(Bit8u*)calloc(cache_tier.pages,1);
+			if (!cache_tier.count) E_Exit("Allocating the tiered mode counters has failed");
+
 			// allocate the cache blocks memory
-			cache_blocks=(CacheBlockDynRec*)malloc(CACHE_BLOCKS*sizeof(CacheBlockDynRec));
+			cache_blocks=(CacheBlockDynRec*)malloc(cache_size.blocks*sizeof(CacheBlockDynRec));
 			if(!cache_blocks) E_Exit("Allocating cache_blocks has failed");
-			memset(cache_blocks,0,sizeof(CacheBlockDynRec)*CACHE_BLOCKS);
+			memset(cache_blocks,0,sizeof(CacheBlockDynRec)*cache_size.blocks);
 			cache.block.free=&cache_blocks[0];
 			// initialize the cache blocks
-			for (i=0;i<CACHE_BLOCKS-1;i++) {
+			for (i=0;i<(Bits)cache_size.blocks-1;i++) {
 				cache_blocks[i].link[0].to=(CacheBlockDynRec *)1;
 				cache_blocks[i].link[1].to=(CacheBlockDynRec *)1;
 				cache_blocks[i].cache.next=&cache_blocks[i+1];
@@ -586,12 +852,13 @@ static void cache_init(bool enable) {
 		if (cache_code_start_ptr==NULL) {
 			// allocate the code cache memory
 #if defined (WIN32)
-			cache_code_start_ptr=(Bit8u*)VirtualAlloc(0,CACHE_TOTAL+CACHE_MAXSIZE+PAGESIZE_TEMP-1+PAGESIZE_TEMP,
+			cache_code_start_ptr=(Bit8u*)VirtualAlloc(0,cache_size.total+CACHE_MAXSIZE+PAGESIZE_TEMP-1+PAGESIZE_TEMP,
 				MEM_COMMIT,PAGE_EXECUTE_READWRITE);
+			cache_code_virtualalloc=(cache_code_start_ptr!=NULL);
 			if (!cache_code_start_ptr)
-				cache_code_start_ptr=(Bit8u*)malloc(CACHE_TOTAL+CACHE_MAXSIZE+PAGESIZE_TEMP-1+PAGESIZE_TEMP);
+				cache_code_start_ptr=(Bit8u*)malloc(cache_size.total+CACHE_MAXSIZE+PAGESIZE_TEMP-1+PAGESIZE_TEMP);
 #else
-			cache_code_start_ptr=(Bit8u*)malloc(CACHE_TOTAL+CACHE_MAXSIZE+PAGESIZE_TEMP-1+PAGESIZE_TEMP);
+			cache_code_start_ptr=(Bit8u*)malloc(cache_size.total+CACHE_MAXSIZE+PAGESIZE_TEMP-1+PAGESIZE_TEMP);
 #endif
 			if(!cache_code_start_ptr) E_Exit("Allocating dynamic cache failed");
 
@@ -602,14 +869,14 @@ static void cache_init(bool enable) {
 			cache_code=cache_code+PAGESIZE_TEMP;
 
 #if (C_HAVE_MPROTECT)
-			if(mprotect(cache_code_link_blocks,CACHE_TOTAL+CACHE_MAXSIZE+PAGESIZE_TEMP,PROT_WRITE|PROT_READ|PROT_EXEC))
+			if(mprotect(cache_code_link_blocks,cache_size.total+CACHE_MAXSIZE+PAGESIZE_TEMP,PROT_WRITE|PROT_READ|PROT_EXEC))
 				LOG_MSG("Setting excute permission on the code cache has failed");
 #endif
 			CacheBlockDynRec * block=cache_getblock();
 			cache.block.first=block;
 			cache.block.active=block;
 			block->cache.start=&cache_code[0];
-			block->cache.size=CACHE_TOTAL;
+			block->cache.size=cache_size.total;
 			block->cache.next=0;						// last block in the list
 		}
 		// setup the default blocks for block linkage returns
@@ -631,7 +898,7 @@ static void cache_init(bool enable) {
 		cache.last_page=0;
 		cache.used_pages=0;
 		// setup the code pages
-		for (i=0;i<CACHE_PAGES;i++) {
+		for (i=0;i<(Bits)cache_size.pages;i++) {
 			CodePageHandlerDynRec * newpage=new CodePageHandlerDynRec();
 			newpage->next=cache.free_pages;
 			cache.free_pages=newpage;
@@ -640,6 +907,7 @@ static void cache_init(bool enable) {
 }
 
 static void cache_close(void) {
+	if (cache_initialized) cache_log_stats();
 /*	for (;;) {
 		if (cache.used_pages) {
 			CodePageHandler * cpage=cache.used_pages;
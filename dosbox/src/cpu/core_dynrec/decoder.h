@@ -40,6 +40,8 @@ static CacheBlockDynRec * CreateCacheBlock(CodePageHandlerDynRec * codepage,Phys
 	decode.page.wmap=codepage->write_map;
 	decode.page.invmap=codepage->invalidation_map;
 	decode.page.first=start >> 12;
+	decode.trace.parts=0;
+	decode.trace.start[0]=start;
 	decode.active_block=decode.block=cache_openblock();
 	decode.block->page.start=(Bit16u)decode.page.index;
 	codepage->AddCacheBlock(decode.block);
@@ -50,6 +52,16 @@ static CacheBlockDynRec * CreateCacheBlock(CodePageHandlerDynRec * codepage,Phys
 	// so the block linking knows the last executed block
 	gen_mov_direct_ptr(&cache.block.running,(DRC_PTR_SIZE_IM)decode.block);
 
+	decode.block->prof.entries=0;
+	decode.block->prof.cs=(Bit16u)SegValue(cs);
+	decode.block->prof.ip=(Bit32u)(start-SegPhys(cs));
+	if (core_dynrec.profile_blocks) {
+		// count the block entries for the hot block dump
+		gen_mov_word_to_reg(FC_OP1,&decode.block->prof.entries,true);
+		gen_add_imm(FC_OP1,1);
+		gen_mov_word_from_reg(FC_OP1,&decode.block->prof.entries,true);
+	}
+
 	// start with the cycles check
 	gen_mov_word_to_reg(FC_RETOP,&CPU_Cycles,true);
 	save_info_dynrec[used_save_info_dynrec].branch_pos=gen_create_branch_long_leqzero(FC_RETOP);
@@ -509,11 +521,11 @@ restart_prefix:
 
 		// 'call near imm16/32'
 		case 0xe8:
-			dyn_call_near_imm();
+			if (dyn_call_near_imm()) break;
 			goto finish_block;
 		// 'jmp near imm16/32'
 		case 0xe9:
-			dyn_exit_link(decode.big_op ? (Bit32s)decode_fetchd() : (Bit16s)decode_fetchw());
+			if (dyn_jmp_near(decode.big_op ? (Bit32s)decode_fetchd() : (Bit16s)decode_fetchw())) break;
 			goto finish_block;
 		// 'jmp far'
 		case 0xea:
@@ -521,7 +533,7 @@ restart_prefix:
 			goto finish_block;
 		// 'jmp short imm8'
 		case 0xeb:
-			dyn_exit_link((Bit8s)decode_fetchb());
+			if (dyn_jmp_near((Bit8s)decode_fetchb())) break;
 			goto finish_block;
 
 
@@ -574,6 +586,10 @@ restart_prefix:
 				goto core_close_block;
 			case 2:
 				goto illegalopcode;
+			case 3:
+				dyn_reduce_cycles();
+				dyn_exit_indirect();
+				goto finish_block;
 			default:
 				break;
 			}
@@ -610,6 +626,10 @@ finish_block:
 	decode.page.index--;
 	decode.active_block->page.end=(Bit16u)decode.page.index;
 //	LOG_MSG("Created block size %d start %d end %d",decode.block->cache.size,decode.block->page.start,decode.block->page.end);
+#if DYN_LOG
+	LOG_MSG("Flags optimization: %d of %d flag generating functions replaced (total %d of %d)",
+		mf_stats.block_removed,mf_stats.block_generated,mf_stats.total_removed,mf_stats.total_generated);
+#endif
 
 	return decode.block;
 }
@@ -118,6 +118,13 @@ static struct DynDecode {
 		Bitu first;		// page number 
 	} page;
 
+	// jumps and calls that were followed while translating the block
+	struct {
+		Bitu parts;		// number of jumps/calls followed
+		PhysPt start[DYN_TRACE_PARTS+1];	// linear address range of each straight-line part
+		PhysPt end[DYN_TRACE_PARTS+1];
+	} trace;
+
 	// modrm state of the current instruction (if used)
 	struct {
 		Bitu val;
@@ -161,8 +168,9 @@ static bool MakeCodePage(Bitu lin_addr,CodePageHandlerDynRec * &cph) {
 		cph=0;
 		return false;
 	}
-	// find a free CodePage
+	// find a free CodePage, the least recently executed page is evicted if none is left
 	if (!cache.free_pages) {
+		cache_stats.page_evicts++;
 		if (cache.used_pages!=decode.page.code) cache.used_pages->ClearRelease();
 		else {
 			// try another page to avoid clearing our source-crosspage
@@ -192,6 +200,14 @@ static bool MakeCodePage(Bitu lin_addr,CodePageHandlerDynRec * &cph) {
 	return false;
 }
 
+// add a block that covers another part of the instruction stream, all parts of
+// a block are chained into a ring by their crossblock pointers
+static void decode_addpart(CacheBlockDynRec * newblock) {
+	newblock->crossblock=decode.block->crossblock ? decode.block->crossblock : decode.block;
+	decode.block->crossblock=newblock;
+	decode.active_block=newblock;
+}
+
 static void decode_advancepage(void) {
 	// Advance to the next page
 	decode.active_block->page.end=4095;
@@ -201,9 +217,7 @@ static void decode_advancepage(void) {
 	mem_readb(faddr);
 	MakeCodePage(faddr,decode.page.code);
 	CacheBlockDynRec * newblock=cache_getblock();
-	decode.active_block->crossblock=newblock;
-	newblock->crossblock=decode.active_block;
-	decode.active_block=newblock;
+	decode_addpart(newblock);
 	decode.active_block->page.start=0;
 	decode.page.code->AddCrossBlock(decode.active_block);
 	decode.page.wmap=decode.page.code->write_map;
@@ -211,6 +225,56 @@ static void decode_advancepage(void) {
 	decode.page.index=0;
 }
 
+// try to continue the translation at the target of a near jump or call
+// instead of ending the block; this is done if the target is in the current
+// page or in a page that contains translated code already
+static bool decode_follow(Bits eip_change) {
+	if (decode.trace.parts>=DYN_TRACE_PARTS) return false;
+	PhysPt target=decode.code+eip_change;
+	if (!cpu.code.big) {
+		// the exception handling needs positive instruction pointer offsets in 16bit code
+		if (target<decode.code_start) return false;
+	}
+	if (!decode.big_op) {
+		// the instruction pointer is truncated to 16bit
+		Bitu ip=decode.code-SegPhys(cs);
+		if ((ip>0xffff) || (ip+eip_change>0xffff)) return false;
+	}
+	// don't unroll loops
+	decode.trace.end[decode.trace.parts]=decode.code;
+	for (Bitu i=0;i<=decode.trace.parts;i++) {
+		if ((target>=decode.trace.start[i]) && (target<decode.trace.end[i])) return false;
+	}
+
+	CodePageHandlerDynRec * cph;
+	if ((target>>12)==decode.page.first) cph=decode.page.code;
+	else {
+		PageHandler * handler=get_tlb_readhandler(target);
+		if (!(handler->flags & PFLAG_HASCODE)) return false;
+		cph=(CodePageHandlerDynRec *)handler;
+		if (cph->smc.interpret) return false;
+		// keep it away from eviction while this block is translated
+		cph->MarkUsed();
+	}
+	Bitu index=target&4095;
+	if (cph->invalidation_map && (cph->invalidation_map[index]>=4)) return false;
+
+	// the current part ends with the jump, the target starts a new one
+	decode.active_block->page.end=(Bit16u)(decode.page.index-1);
+	decode_addpart(cache_getblock());
+	decode.active_block->page.start=(Bit16u)index;
+	cph->AddCrossBlock(decode.active_block);
+	decode.page.code=cph;
+	decode.page.wmap=cph->write_map;
+	decode.page.invmap=cph->invalidation_map;
+	decode.page.index=index;
+	decode.page.first=target>>12;
+	decode.code=target;
+	decode.trace.parts++;
+	decode.trace.start[decode.trace.parts]=target;
+	return true;
+}
+
 // fetch the next byte of the instruction stream
 static Bit8u decode_fetchb(void) {
 	if (GCC_UNLIKELY(decode.page.index>=4096)) {
@@ -560,6 +624,13 @@ static DRC_PTR_SIZE_IM INLINE gen_call_function_IA(void * func,Bitu op1,DRC_PTR_
 	return gen_call_function_setup(func, 2);
 }
 
+static DRC_PTR_SIZE_IM INLINE gen_call_function_IRA(void * func,Bitu op1,Bitu op2,DRC_PTR_SIZE_IM op3) {
+	gen_load_param_addr(op3,2);
+	gen_load_param_reg(op2,1);
+	gen_load_param_imm(op1,0);
+	return gen_call_function_setup(func, 3);
+}
+
 static DRC_PTR_SIZE_IM INLINE gen_call_function_IIR(void * func,Bitu op1,Bitu op2,Bitu op3) {
 	gen_load_param_reg(op3,2);
 	gen_load_param_imm(op2,1);
@@ -668,6 +739,7 @@ static void dyn_closeblock(void) {
 	cache_block_before_close();
 	cache_closeblock();
 	cache_block_closing(decode.block->cache.start,decode.block->cache.size);
+	decode.block->prof.cycles=(Bit16u)decode.cycles;
 }
 
 
@@ -752,36 +824,69 @@ bool DRC_CALL_CONV mem_writed_checked_drc(PhysPt address,Bit32u val) {
 
 // functions that enable access to the memory
 
+#if defined(DRC_USE_TLB_FASTPATH)
+// accesses to directly mapped memory that do not cross a page are done inline,
+// everything else (memory handlers, unmapped pages, code pages) goes through
+// the checked helper functions; the returned jump skips the helper call
+static DRC_PTR_SIZE_IM dyn_tlb_read_fast(HostReg reg_dst,Bitu size) {
+	DRC_PTR_SIZE_IM miss=gen_tlb_read_fast(FC_OP1,reg_dst,size);
+	DRC_PTR_SIZE_IM done=gen_create_jump();
+	gen_fill_branch(miss);
+	return done;
+}
+static DRC_PTR_SIZE_IM dyn_tlb_write_fast(Bitu size) {
+	DRC_PTR_SIZE_IM miss=gen_tlb_write_fast(FC_OP1,FC_OP2,size);
+	DRC_PTR_SIZE_IM done=gen_create_jump();
+	gen_fill_branch(miss);
+	return done;
+}
+static void dyn_tlb_done(DRC_PTR_SIZE_IM done) {
+	gen_fill_branch(done);
+}
+#else
+static DRC_PTR_SIZE_IM dyn_tlb_read_fast(HostReg reg_dst,Bitu size) { return 0; }
+static DRC_PTR_SIZE_IM dyn_tlb_write_fast(Bitu size) { return 0; }
+static void dyn_tlb_done(DRC_PTR_SIZE_IM done) {}
+#endif
+
 // read a byte from a given address and store it in reg_dst
 static void dyn_read_byte(HostReg reg_addr,HostReg reg_dst) {
 	gen_mov_regs(FC_OP1,reg_addr);
+	DRC_PTR_SIZE_IM done=dyn_tlb_read_fast(reg_dst,1);
 	gen_call_function_raw((void *)&mem_readb_checked_drc);
 	dyn_check_exception(FC_RETOP);
 	gen_mov_byte_to_reg_low(reg_dst,&core_dynrec.readdata);
+	dyn_tlb_done(done);
 }
 static void dyn_read_byte_canuseword(HostReg reg_addr,HostReg reg_dst) {
 	gen_mov_regs(FC_OP1,reg_addr);
+	DRC_PTR_SIZE_IM done=dyn_tlb_read_fast(reg_dst,1);
 	gen_call_function_raw((void *)&mem_readb_checked_drc);
 	dyn_check_exception(FC_RETOP);
 	gen_mov_byte_to_reg_low_canuseword(reg_dst,&core_dynrec.readdata);
+	dyn_tlb_done(done);
 }
 
 // write a byte from reg_val into the memory given by the address
 static void dyn_write_byte(HostReg reg_addr,HostReg reg_val) {
 	gen_mov_regs(FC_OP2,reg_val);
 	gen_mov_regs(FC_OP1,reg_addr);
+	DRC_PTR_SIZE_IM done=dyn_tlb_write_fast(1);
 	gen_call_function_raw((void *)&mem_writeb_checked_drc);
 	dyn_check_exception(FC_RETOP);
+	dyn_tlb_done(done);
 }
 
 // read a 32bit (dword=true) or 16bit (dword=false) value
 // from a given address and store it in reg_dst
 static void dyn_read_word(HostReg reg_addr,HostReg reg_dst,bool dword) {
 	gen_mov_regs(FC_OP1,reg_addr);
+	DRC_PTR_SIZE_IM done=dyn_tlb_read_fast(reg_dst,dword?4:2);
 	if (dword) gen_call_function_raw((void *)&mem_readd_checked_drc);
 	else gen_call_function_raw((void *)&mem_readw_checked_drc);
 	dyn_check_exception(FC_RETOP);
 	gen_mov_word_to_reg(reg_dst,&core_dynrec.readdata,dword);
+	dyn_tlb_done(done);
 }
 
 // write a 32bit (dword=true) or 16bit (dword=false) value
@@ -790,9 +895,11 @@ static void dyn_write_word(HostReg reg_addr,HostReg reg_val,bool dword) {
 //	if (!dword) gen_extend_word(false,reg_val);
 	gen_mov_regs(FC_OP2,reg_val);
 	gen_mov_regs(FC_OP1,reg_addr);
+	DRC_PTR_SIZE_IM done=dyn_tlb_write_fast(dword?4:2);
 	if (dword) gen_call_function_raw((void *)&mem_writed_checked_drc);
 	else gen_call_function_raw((void *)&mem_writew_checked_drc);
 	dyn_check_exception(FC_RETOP);
+	dyn_tlb_done(done);
 }
 
 
@@ -1196,71 +1303,164 @@ static void gen_restore_reg(HostReg reg,HostReg dest_reg) {
 // they try to find out if a function can be replaced by another
 // one that does not generate any flags at all
 
+// every flag generating function that is emitted is queued together with
+// its simple variant; the queue is a forward liveness analysis: entries
+// are dropped (kept as flag generating function) as soon as one of the
+// flags they define is read, entries that survive until an instruction
+// overwrites all condition flags are replaced by their simple variant
+
+#define MF_FUNCTIONS_MAX 64
+
 static Bitu mf_functions_num=0;
 static struct {
 	Bit8u* pos;
 	void* fct_ptr;
 	Bitu ftype;
-} mf_functions[64];
+} mf_functions[MF_FUNCTIONS_MAX];
+
+// statistics of the flags optimization
+static struct {
+	Bitu block_generated;	// flag generating functions queued in the current block
+	Bitu block_removed;		// replaced by a simple variant in the current block
+	Bitu total_generated;
+	Bitu total_removed;
+	Bitu total_required;	// kept because a later instruction reads their flags
+	Bitu total_overflows;	// kept because the queue was full
+} mf_stats;
+
+// condition flags that might be modified by a flag generating function
+static Bitu mf_flags_defined(Bitu ftype) {
+	switch (ftype) {
+		case t_INCb:case t_INCw:case t_INCd:
+		case t_DECb:case t_DECw:case t_DECd:
+			return FMASK_TEST & ~FLAG_CF;
+		case t_ROLb:case t_ROLw:case t_ROLd:
+		case t_RORb:case t_RORw:case t_RORd:
+		case t_RCLb:case t_RCLw:case t_RCLd:
+		case t_RCRb:case t_RCRw:case t_RCRd:
+		case t_MUL:
+			return FLAG_CF | FLAG_OF;
+		default:
+			return FMASK_TEST;
+	}
+}
+
+// condition flags that are always overwritten by a flag generating function,
+// the function reads all other condition flags (lazy flags are materialized)
+static Bitu mf_flags_killed(Bitu ftype) {
+	switch (ftype) {
+		case t_INCb:case t_INCw:case t_INCd:
+		case t_DECb:case t_DECw:case t_DECd:
+			return FMASK_TEST & ~FLAG_CF;
+		case t_MUL:
+			return FLAG_CF | FLAG_OF;
+		// shift/rotate count may be zero, flags are unmodified then
+		case t_SHLb:case t_SHLw:case t_SHLd:
+		case t_SHRb:case t_SHRw:case t_SHRd:
+		case t_SARb:case t_SARw:case t_SARd:
+		case t_ROLb:case t_ROLw:case t_ROLd:
+		case t_RORb:case t_RORw:case t_RORd:
+		case t_RCLb:case t_RCLw:case t_RCLd:
+		case t_RCRb:case t_RCRw:case t_RCRd:
+		case t_DSHLw:case t_DSHLd:
+		case t_DSHRw:case t_DSHRd:
+			return 0;
+		default:
+			return FMASK_TEST;
+	}
+}
+
+// log the totals, functions that were neither replaced nor required
+// were still queued when their block ended
+static void LogFlagsOptimization(void) {
+	if (!mf_stats.total_generated) return;
+	LOG_MSG("DYNREC:%d of %d flag generating functions replaced, %d required, %d over the queue limit",
+		mf_stats.total_removed,mf_stats.total_generated,mf_stats.total_required,mf_stats.total_overflows);
+}
 
 static void InitFlagsOptimization(void) {
 	mf_functions_num=0;
+	mf_stats.block_generated=0;
+	mf_stats.block_removed=0;
 }
 
-// replace all queued functions with their simpler variants
-// because the current instruction destroys all condition flags and
-// the flags are not required before
-static void InvalidateFlags(void) {
+// replace all queued functions by their simple variants
+static void ReplaceQueuedFlagsFunctions(void) {
 #ifdef DRC_FLAGS_INVALIDATION
 	for (Bitu ct=0; ct<mf_functions_num; ct++) {
 		gen_fill_function_ptr(mf_functions[ct].pos,mf_functions[ct].fct_ptr,mf_functions[ct].ftype);
 	}
+	mf_stats.block_removed+=mf_functions_num;
+	mf_stats.total_removed+=mf_functions_num;
 	mf_functions_num=0;
 #endif
 }
 
+// enqueue a flag generating function
+static void QueueFlagsFunction(void* simple_function,Bit8u* cpos,Bitu flags_type) {
+#ifdef DRC_FLAGS_INVALIDATION
+	mf_stats.block_generated++;
+	mf_stats.total_generated++;
+	// queue full, the function simply keeps generating flags
+	if (GCC_UNLIKELY(mf_functions_num>=MF_FUNCTIONS_MAX)) {
+		mf_stats.total_overflows++;
+		return;
+	}
+	mf_functions[mf_functions_num].pos=cpos;
+	mf_functions[mf_functions_num].fct_ptr=simple_function;
+	mf_functions[mf_functions_num].ftype=flags_type;
+	mf_functions_num++;
+#endif
+}
+
+// replace all queued functions with their simpler variants
+// because the current instruction destroys all condition flags and
+// the flags are not required before
+static void InvalidateFlags(void) {
+	ReplaceQueuedFlagsFunctions();
+}
+
 // replace all queued functions with their simpler variants
 // because the current instruction destroys all condition flags and
 // the flags are not required before
 static void InvalidateFlags(void* current_simple_function,Bitu flags_type) {
-#ifdef DRC_FLAGS_INVALIDATION
-	for (Bitu ct=0; ct<mf_functions_num; ct++) {
-		gen_fill_function_ptr(mf_functions[ct].pos,mf_functions[ct].fct_ptr,mf_functions[ct].ftype);
-	}
-	mf_functions_num=1;
-	mf_functions[0].pos=cache.pos;
-	mf_functions[0].fct_ptr=current_simple_function;
-	mf_functions[0].ftype=flags_type;
-#endif
+	ReplaceQueuedFlagsFunctions();
+	QueueFlagsFunction(current_simple_function,cache.pos,flags_type);
 }
 
 // enqueue this instruction, if later an instruction is encountered that
 // destroys all condition flags and the flags weren't needed in-between
 // this function can be replaced by a simpler one as well
 static void InvalidateFlagsPartially(void* current_simple_function,Bitu flags_type) {
-#ifdef DRC_FLAGS_INVALIDATION
-	mf_functions[mf_functions_num].pos=cache.pos;
-	mf_functions[mf_functions_num].fct_ptr=current_simple_function;
-	mf_functions[mf_functions_num].ftype=flags_type;
-	mf_functions_num++;
-#endif
+	QueueFlagsFunction(current_simple_function,cache.pos,flags_type);
 }
 
 // enqueue this instruction, if later an instruction is encountered that
 // destroys all condition flags and the flags weren't needed in-between
 // this function can be replaced by a simpler one as well
 static void InvalidateFlagsPartially(void* current_simple_function,DRC_PTR_SIZE_IM cpos,Bitu flags_type) {
-#ifdef DRC_FLAGS_INVALIDATION
-	mf_functions[mf_functions_num].pos=(Bit8u*)cpos;
-	mf_functions[mf_functions_num].fct_ptr=current_simple_function;
-	mf_functions[mf_functions_num].ftype=flags_type;
-	mf_functions_num++;
-#endif
+	QueueFlagsFunction(current_simple_function,(Bit8u*)cpos,flags_type);
 }
 
-// the current function needs the condition flags thus reset the queue
+// the current function needs the condition flags given by flags_mask,
+// walk the queue backwards and keep every function that produces one of
+// these flags; a kept function reads the flags it doesn't overwrite
+// itself, so these become required from the older functions
 static void AcquireFlags(Bitu flags_mask) {
 #ifdef DRC_FLAGS_INVALIDATION
-	mf_functions_num=0;
+	Bitu needed=flags_mask & FMASK_TEST;
+	for (Bits ct=(Bits)mf_functions_num-1; (ct>=0) && needed; ct--) {
+		if (mf_flags_defined(mf_functions[ct].ftype) & needed) {
+			needed=FMASK_TEST & ~mf_flags_killed(mf_functions[ct].ftype);
+			mf_functions[ct].pos=NULL;		// required, remove from the queue
+			mf_stats.total_required++;
+		}
+	}
+	// compact the queue
+	Bitu kept=0;
+	for (Bitu ct=0; ct<mf_functions_num; ct++) {
+		if (mf_functions[ct].pos!=NULL) mf_functions[kept++]=mf_functions[ct];
+	}
+	mf_functions_num=kept;
 #endif
 }
@@ -529,8 +529,13 @@ static void dyn_imul_gvev(Bitu immsize) {
 			break;
 	}
 
-	if (decode.big_op) gen_call_function_raw((void*)dynrec_dimul_dword);
-	else gen_call_function_raw((void*)dynrec_dimul_word);
+	if (decode.big_op) {
+		InvalidateFlagsPartially((void*)&dynrec_dimul_dword_simple,t_MUL);
+		gen_call_function_raw((void*)dynrec_dimul_dword);
+	} else {
+		InvalidateFlagsPartially((void*)&dynrec_dimul_word_simple,t_MUL);
+		gen_call_function_raw((void*)dynrec_dimul_word);
+	}
 
 	MOV_REG_WORD_FROM_HOST_REG(FC_RETOP,decode.modrm.reg,decode.big_op);
 }
@@ -847,10 +852,10 @@ static Bitu dyn_grp4_ev(void) {
 
 		gen_restore_addr_reg();
 		gen_mov_word_from_reg(FC_ADDR,decode.big_op?(void*)(&reg_eip):(void*)(&reg_ip),decode.big_op);
-		return 1;
+		return 3;
 	case 0x4:	// JMP Ev
 		gen_mov_word_from_reg(FC_OP1,decode.big_op?(void*)(&reg_eip):(void*)(&reg_ip),decode.big_op);
-		return 1;
+		return 3;
 	case 0x3:	// CALL Ep
 	case 0x5:	// JMP Ep
 		if (!decode.big_op) gen_extend_word(false,FC_OP1);
@@ -1080,8 +1085,10 @@ static void dyn_cwd(void) {
 
 static void dyn_sahf(void) {
 	MOV_REG_WORD16_TO_HOST_REG(FC_OP1,DRC_REG_EAX);
-	gen_call_function_raw((void *)&dynrec_sahf);
+	// the overflow flag is preserved
+	AcquireFlags(FLAG_OF);
 	InvalidateFlags();
+	gen_call_function_raw((void *)&dynrec_sahf);
 }
 
 
@@ -1093,6 +1100,24 @@ static void dyn_exit_link(Bits eip_change) {
 }
 
 
+// exit through an indirect near branch, reg_eip has to contain the target already;
+// link[1] and ind_ip act as a single entry target cache for this exit
+static void dyn_exit_indirect(void) {
+	gen_mov_word_to_reg(FC_OP1,&reg_eip,true);
+	ADD_SEG_PHYS_TO_HOST_REG(FC_OP1,DRC_SEG_CS);
+	gen_add(FC_OP1,&decode.block->ind_ip);
+	DRC_PTR_SIZE_IM data=gen_create_branch_on_nonzero(FC_OP1,true);
+
+	// same target as last time, jump to the linked block
+	gen_jmp_ptr(&decode.block->link[1].to,offsetof(CacheBlockDynRec,cache.start));
+	gen_fill_branch(data);
+
+	// different target, let the core relink this exit
+	dyn_return(BR_Link2);
+	dyn_closeblock();
+}
+
+
 static void dyn_branched_exit(BranchTypes btype,Bit32s eip_add) {
 	Bitu eip_base=decode.code-decode.code_start;
 	dyn_reduce_cycles();
@@ -1182,17 +1207,25 @@ static void dyn_ret_near(Bitu bytes) {
 	gen_mov_word_from_reg(FC_RETOP,decode.big_op?(void*)(&reg_eip):(void*)(&reg_ip),true);
 
 	if (bytes) gen_add_direct_word(&reg_esp,bytes,true);
-	dyn_return(BR_Normal);
-	dyn_closeblock();
+	dyn_exit_indirect();
 }
 
-static void dyn_call_near_imm(void) {
+// returns true if the translation continues at the jump target
+static bool dyn_jmp_near(Bits eip_change) {
+	if (decode_follow(eip_change)) return true;
+	dyn_exit_link(eip_change);
+	return false;
+}
+
+// returns true if the translation continues at the call target
+static bool dyn_call_near_imm(void) {
 	Bits imm;
 	if (decode.big_op) imm=(Bit32s)decode_fetchd();
 	else imm=(Bit16s)decode_fetchw();
 	dyn_set_eip_end(FC_OP1);
 	if (decode.big_op) gen_call_function_raw((void*)&dynrec_push_dword);
 	else gen_call_function_raw((void*)&dynrec_push_word);
+	if (decode_follow(imm)) return true;
 
 	dyn_set_eip_end(FC_OP1,imm);
 	gen_mov_word_from_reg(FC_OP1,decode.big_op?(void*)(&reg_eip):(void*)(&reg_ip),decode.big_op);
@@ -1200,6 +1233,7 @@ static void dyn_call_near_imm(void) {
 	dyn_reduce_cycles();
 	gen_jmp_ptr(&decode.block->link[0].to,offsetof(CacheBlockDynRec,cache.start));
 	dyn_closeblock();
+	return false;
 }
 
 static void dyn_ret_far(Bitu bytes) {
@@ -1312,13 +1346,15 @@ static void dyn_string(StringOps op) {
 
 static void dyn_read_port_byte_direct(Bit8u port) {
 	dyn_add_iocheck_var(port,1);
-	gen_call_function_I((void*)&IO_ReadB,port);
+	// the port is known, call its handler slot directly
+	gen_call_function_IA((void*)&IO_ReadSlotB,port,(DRC_PTR_SIZE_IM)IO_GetReadSlot(port,0));
 	MOV_REG_BYTE_FROM_HOST_REG_LOW(FC_RETOP,DRC_REG_EAX,0);
 }
 
 static void dyn_read_port_word_direct(Bit8u port) {
 	dyn_add_iocheck_var(port,decode.big_op?4:2);
-	gen_call_function_I(decode.big_op?((void*)&IO_ReadD):((void*)&IO_ReadW),port);
+	gen_call_function_IA(decode.big_op?((void*)&IO_ReadSlotD):((void*)&IO_ReadSlotW),port,
+		(DRC_PTR_SIZE_IM)IO_GetReadSlot(port,decode.big_op?2:1));
 	MOV_REG_WORD_FROM_HOST_REG(FC_RETOP,DRC_REG_EAX,decode.big_op);
 }
 
@@ -1326,14 +1362,15 @@ static void dyn_write_port_byte_direct(Bit8u port) {
 	dyn_add_iocheck_var(port,1);
 	MOV_REG_BYTE_TO_HOST_REG_LOW(FC_RETOP,DRC_REG_EAX,0);
 	gen_extend_byte(false,FC_RETOP);
-	gen_call_function_IR((void*)&IO_WriteB,port,FC_RETOP);
+	gen_call_function_IRA((void*)&IO_WriteSlotB,port,FC_RETOP,(DRC_PTR_SIZE_IM)IO_GetWriteSlot(port,0));
 }
 
 static void dyn_write_port_word_direct(Bit8u port) {
 	dyn_add_iocheck_var(port,decode.big_op?4:2);
 	MOV_REG_WORD_TO_HOST_REG(FC_RETOP,DRC_REG_EAX,decode.big_op);
 	if (!decode.big_op) gen_extend_word(false,FC_RETOP);
-	gen_call_function_IR(decode.big_op?((void*)&IO_WriteD):((void*)&IO_WriteW),port,FC_RETOP);
+	gen_call_function_IRA(decode.big_op?((void*)&IO_WriteSlotD):((void*)&IO_WriteSlotW),port,FC_RETOP,
+		(DRC_PTR_SIZE_IM)IO_GetWriteSlot(port,decode.big_op?2:1));
 }
 
 
@@ -67,33 +67,90 @@ static INLINE void dyn_fpu_top_swapped() {
 	gen_mov_word_to_reg(FC_OP2,(void*)(&TOP),true);
 }
 
+#if defined(DRC_USE_FPU_NATIVE)
+#define DYN_FPU_NATIVE (core_dynrec.native_fpu)
+#else
+#define DYN_FPU_NATIVE false
+static void gen_fpu_arith(Bitu op,HostReg dst_idx,HostReg src_idx) {}
+static void gen_fpu_copy(HostReg dst_idx,HostReg src_idx) {}
+static void gen_fpu_xchg(HostReg idx1,HostReg idx2) {}
+static void gen_fpu_settag(HostReg idx,FPU_Tag tag) {}
+#endif
+
+// helpers of the arithmetic group, indexed by the esc 0 register field
+static void * const dyn_fpu_arith_funcs[8]={
+	(void*)&FPU_FADD,(void*)&FPU_FMUL,NULL,NULL,
+	(void*)&FPU_FSUB,(void*)&FPU_FSUBR,(void*)&FPU_FDIV,(void*)&FPU_FDIVR
+};
+static void * const dyn_fpu_arith_ea_funcs[8]={
+	(void*)&FPU_FADD_EA,(void*)&FPU_FMUL_EA,NULL,NULL,
+	(void*)&FPU_FSUB_EA,(void*)&FPU_FSUBR_EA,(void*)&FPU_FDIV_EA,(void*)&FPU_FDIVR_EA
+};
+
+// arithmetic operation op (esc 0 numbering) on the registers in FC_OP1 and FC_OP2,
+// the result goes to the register in FC_OP1
+static void dyn_fpu_arith(Bitu op) {
+	if (DYN_FPU_NATIVE) gen_fpu_arith(op,FC_OP1,FC_OP2);
+	else gen_call_function_RR(dyn_fpu_arith_funcs[op],FC_OP1,FC_OP2);
+}
+
+// same with the memory operand that has been loaded into register 8
+static void dyn_fpu_arith_ea(Bitu op) {
+	if (DYN_FPU_NATIVE) {
+		gen_mov_dword_to_reg_imm(FC_OP2,8);
+		gen_fpu_arith(op,FC_OP1,FC_OP2);
+	} else gen_call_function_R(dyn_fpu_arith_ea_funcs[op],FC_OP1);
+}
+
+// copy the register in FC_OP1 to the one in FC_OP2
+static void dyn_fpu_copy() {
+	if (DYN_FPU_NATIVE) gen_fpu_copy(FC_OP2,FC_OP1);
+	else gen_call_function_RR((void*)&FPU_FST,FC_OP1,FC_OP2);
+}
+
+// exchange the registers in FC_OP1 and FC_OP2
+static void dyn_fpu_xchg() {
+	if (DYN_FPU_NATIVE) gen_fpu_xchg(FC_OP1,FC_OP2);
+	else gen_call_function_RR((void*)&FPU_FXCH,FC_OP1,FC_OP2);
+}
+
+static void dyn_fpu_pop() {
+	if (DYN_FPU_NATIVE) {
+		gen_mov_word_to_reg(FC_OP1,(void*)(&TOP),true);
+		gen_fpu_settag(FC_OP1,TAG_Empty);
+		gen_add_imm(FC_OP1,1);
+		gen_and_imm(FC_OP1,7);
+		gen_mov_word_from_reg(FC_OP1,(void*)(&TOP),true);
+	} else gen_call_function_raw((void*)&FPU_FPOP);
+}
+
 static void dyn_eatree() {
 	Bitu group=(decode.modrm.val >> 3) & 7;
 	switch (group){
 	case 0x00:		// FADD ST,STi
-		gen_call_function_R((void*)&FPU_FADD_EA,FC_OP1);
+		dyn_fpu_arith_ea(0x00);
 		break;
 	case 0x01:		// FMUL  ST,STi
-		gen_call_function_R((void*)&FPU_FMUL_EA,FC_OP1);
+		dyn_fpu_arith_ea(0x01);
 		break;
 	case 0x02:		// FCOM  STi
 		gen_call_function_R((void*)&FPU_FCOM_EA,FC_OP1);
 		break;
 	case 0x03:		// FCOMP STi
 		gen_call_function_R((void*)&FPU_FCOM_EA,FC_OP1);
-		gen_call_function_raw((void*)&FPU_FPOP);
+		dyn_fpu_pop();
 		break;
 	case 0x04:		// FSUB  ST,STi
-		gen_call_function_R((void*)&FPU_FSUB_EA,FC_OP1);
+		dyn_fpu_arith_ea(0x04);
 		break;	
 	case 0x05:		// FSUBR ST,STi
-		gen_call_function_R((void*)&FPU_FSUBR_EA,FC_OP1);
+		dyn_fpu_arith_ea(0x05);
 		break;
 	case 0x06:		// FDIV  ST,STi
-		gen_call_function_R((void*)&FPU_FDIV_EA,FC_OP1);
+		dyn_fpu_arith_ea(0x06);
 		break;
 	case 0x07:		// FDIVR ST,STi
-		gen_call_function_R((void*)&FPU_FDIVR_EA,FC_OP1);
+		dyn_fpu_arith_ea(0x07);
 		break;
 	default:
 		break;
@@ -106,29 +163,29 @@ static void dyn_fpu_esc0(){
 		dyn_fpu_top();
 		switch (decode.modrm.reg){
 		case 0x00:		//FADD ST,STi
-			gen_call_function_RR((void*)&FPU_FADD,FC_OP1,FC_OP2);
+			dyn_fpu_arith(0x00);
 			break;
 		case 0x01:		// FMUL  ST,STi
-			gen_call_function_RR((void*)&FPU_FMUL,FC_OP1,FC_OP2);
+			dyn_fpu_arith(0x01);
 			break;
 		case 0x02:		// FCOM  STi
 			gen_call_function_RR((void*)&FPU_FCOM,FC_OP1,FC_OP2);
 			break;
 		case 0x03:		// FCOMP STi
 			gen_call_function_RR((void*)&FPU_FCOM,FC_OP1,FC_OP2);
-			gen_call_function_raw((void*)&FPU_FPOP);
+			dyn_fpu_pop();
 			break;
 		case 0x04:		// FSUB  ST,STi
-			gen_call_function_RR((void*)&FPU_FSUB,FC_OP1,FC_OP2);
+			dyn_fpu_arith(0x04);
 			break;	
 		case 0x05:		// FSUBR ST,STi
-			gen_call_function_RR((void*)&FPU_FSUBR,FC_OP1,FC_OP2);
+			dyn_fpu_arith(0x05);
 			break;
 		case 0x06:		// FDIV  ST,STi
-			gen_call_function_RR((void*)&FPU_FDIV,FC_OP1,FC_OP2);
+			dyn_fpu_arith(0x06);
 			break;
 		case 0x07:		// FDIVR ST,STi
-			gen_call_function_RR((void*)&FPU_FDIVR,FC_OP1,FC_OP2);
+			dyn_fpu_arith(0x07);
 			break;
 		default:
 			break;
@@ -150,23 +207,31 @@ static void dyn_fpu_esc1(){
 			gen_mov_word_to_reg(FC_OP1,(void*)(&TOP),true);
 			gen_add_imm(FC_OP1,decode.modrm.rm);
 			gen_and_imm(FC_OP1,7);
-			gen_protect_reg(FC_OP1);
-			gen_call_function_raw((void*)&FPU_PREP_PUSH); 
-			gen_mov_word_to_reg(FC_OP2,(void*)(&TOP),true);
-			gen_restore_reg(FC_OP1);
-			gen_call_function_RR((void*)&FPU_FST,FC_OP1,FC_OP2);
+			if (DYN_FPU_NATIVE) {
+				// push without the helper, the tag is copied along
+				gen_mov_word_to_reg(FC_OP2,(void*)(&TOP),true);
+				gen_add_imm(FC_OP2,7);
+				gen_and_imm(FC_OP2,7);
+				gen_mov_word_from_reg(FC_OP2,(void*)(&TOP),true);
+			} else {
+				gen_protect_reg(FC_OP1);
+				gen_call_function_raw((void*)&FPU_PREP_PUSH); 
+				gen_mov_word_to_reg(FC_OP2,(void*)(&TOP),true);
+				gen_restore_reg(FC_OP1);
+			}
+			dyn_fpu_copy();
 			break;
 		case 0x01: /* FXCH STi */
 			dyn_fpu_top();
-			gen_call_function_RR((void*)&FPU_FXCH,FC_OP1,FC_OP2);
+			dyn_fpu_xchg();
 			break;
 		case 0x02: /* FNOP */
 			gen_call_function_raw((void*)&FPU_FNOP);
 			break;
 		case 0x03: /* FSTP STi */
 			dyn_fpu_top();
-			gen_call_function_RR((void*)&FPU_FST,FC_OP1,FC_OP2);
-			gen_call_function_raw((void*)&FPU_FPOP);
+			dyn_fpu_copy();
+			dyn_fpu_pop();
 			break;   
 		case 0x04:
 			switch(decode.modrm.rm){
@@ -304,7 +369,7 @@ static void dyn_fpu_esc1(){
 		case 0x03: /* FSTP float*/
 			dyn_fill_ea(FC_ADDR);
 			gen_call_function_R((void*)&FPU_FST_F32,FC_ADDR);
-			gen_call_function_raw((void*)&FPU_FPOP);
+			dyn_fpu_pop();
 			break;
 		case 0x04: /* FLDENV */
 			dyn_fill_ea(FC_ADDR);
@@ -341,8 +406,8 @@ static void dyn_fpu_esc2(){
 				gen_and_imm(FC_OP2,7);
 				gen_mov_word_to_reg(FC_OP1,(void*)(&TOP),true);
 				gen_call_function_RR((void *)&FPU_FUCOM,FC_OP1,FC_OP2);
-				gen_call_function_raw((void *)&FPU_FPOP);
-				gen_call_function_raw((void *)&FPU_FPOP);
+				dyn_fpu_pop();
+				dyn_fpu_pop();
 				break;
 			default:
 				LOG(LOG_FPU,LOG_WARN)("ESC 2:Unhandled group %d subfunction %d",decode.modrm.reg,decode.modrm.rm); 
@@ -407,7 +472,7 @@ static void dyn_fpu_esc3(){
 		case 0x03:	/* FISTP */
 			dyn_fill_ea(FC_ADDR); 
 			gen_call_function_R((void*)&FPU_FST_I32,FC_ADDR);
-			gen_call_function_raw((void*)&FPU_FPOP);
+			dyn_fpu_pop();
 			break;
 		case 0x05:	/* FLD 80 Bits Real */
 			gen_call_function_raw((void*)&FPU_PREP_PUSH);
@@ -417,7 +482,7 @@ static void dyn_fpu_esc3(){
 		case 0x07:	/* FSTP 80 Bits Real */
 			dyn_fill_ea(FC_ADDR); 
 			gen_call_function_R((void*)&FPU_FST_F80,FC_ADDR);
-			gen_call_function_raw((void*)&FPU_FPOP);
+			dyn_fpu_pop();
 			break;
 		default:
 			LOG(LOG_FPU,LOG_WARN)("ESC 3 EA:Unhandled group %d subfunction %d",decode.modrm.reg,decode.modrm.rm);
@@ -431,11 +496,11 @@ static void dyn_fpu_esc4(){
 		switch(decode.modrm.reg){
 		case 0x00:	/* FADD STi,ST*/
 			dyn_fpu_top_swapped();
-			gen_call_function_RR((void*)&FPU_FADD,FC_OP1,FC_OP2);
+			dyn_fpu_arith(0x00);
 			break;
 		case 0x01:	/* FMUL STi,ST*/
 			dyn_fpu_top_swapped();
-			gen_call_function_RR((void*)&FPU_FMUL,FC_OP1,FC_OP2);
+			dyn_fpu_arith(0x01);
 			break;
 		case 0x02:  /* FCOM*/
 			dyn_fpu_top();
@@ -444,23 +509,23 @@ static void dyn_fpu_esc4(){
 		case 0x03:  /* FCOMP*/
 			dyn_fpu_top();
 			gen_call_function_RR((void*)&FPU_FCOM,FC_OP1,FC_OP2);
-			gen_call_function_raw((void*)&FPU_FPOP);
+			dyn_fpu_pop();
 			break;
 		case 0x04:  /* FSUBR STi,ST*/
 			dyn_fpu_top_swapped();
-			gen_call_function_RR((void*)&FPU_FSUBR,FC_OP1,FC_OP2);
+			dyn_fpu_arith(0x05);
 			break;
 		case 0x05:  /* FSUB  STi,ST*/
 			dyn_fpu_top_swapped();
-			gen_call_function_RR((void*)&FPU_FSUB,FC_OP1,FC_OP2);
+			dyn_fpu_arith(0x04);
 			break;
 		case 0x06:  /* FDIVR STi,ST*/
 			dyn_fpu_top_swapped();
-			gen_call_function_RR((void*)&FPU_FDIVR,FC_OP1,FC_OP2);
+			dyn_fpu_arith(0x07);
 			break;
 		case 0x07:  /* FDIV STi,ST*/
 			dyn_fpu_top_swapped();
-			gen_call_function_RR((void*)&FPU_FDIV,FC_OP1,FC_OP2);
+			dyn_fpu_arith(0x06);
 			break;
 		default:
 			break;
@@ -482,21 +547,21 @@ static void dyn_fpu_esc5(){
 			gen_call_function_R((void*)&FPU_FFREE,FC_OP2);
 			break;
 		case 0x01: /* FXCH STi*/
-			gen_call_function_RR((void*)&FPU_FXCH,FC_OP1,FC_OP2);
+			dyn_fpu_xchg();
 			break;
 		case 0x02: /* FST STi */
-			gen_call_function_RR((void*)&FPU_FST,FC_OP1,FC_OP2);
+			dyn_fpu_copy();
 			break;
 		case 0x03:  /* FSTP STi*/
-			gen_call_function_RR((void*)&FPU_FST,FC_OP1,FC_OP2);
-			gen_call_function_raw((void*)&FPU_FPOP);
+			dyn_fpu_copy();
+			dyn_fpu_pop();
 			break;
 		case 0x04:	/* FUCOM STi */
 			gen_call_function_RR((void*)&FPU_FUCOM,FC_OP1,FC_OP2);
 			break;
 		case 0x05:	/*FUCOMP STi */
 			gen_call_function_RR((void*)&FPU_FUCOM,FC_OP1,FC_OP2);
-			gen_call_function_raw((void*)&FPU_FPOP);
+			dyn_fpu_pop();
 			break;
 		default:
 			LOG(LOG_FPU,LOG_WARN)("ESC 5:Unhandled group %d subfunction %d",decode.modrm.reg,decode.modrm.rm);
@@ -520,7 +585,7 @@ static void dyn_fpu_esc5(){
 		case 0x03:	/* FSTP double real*/
 			dyn_fill_ea(FC_ADDR); 
 			gen_call_function_R((void*)&FPU_FST_F64,FC_ADDR);
-			gen_call_function_raw((void*)&FPU_FPOP);
+			dyn_fpu_pop();
 			break;
 		case 0x04:	/* FRSTOR */
 			dyn_fill_ea(FC_ADDR); 
@@ -549,11 +614,11 @@ static void dyn_fpu_esc6(){
 		switch(decode.modrm.reg){
 		case 0x00:	/*FADDP STi,ST*/
 			dyn_fpu_top_swapped();
-			gen_call_function_RR((void*)&FPU_FADD,FC_OP1,FC_OP2);
+			dyn_fpu_arith(0x00);
 			break;
 		case 0x01:	/* FMULP STi,ST*/
 			dyn_fpu_top_swapped();
-			gen_call_function_RR((void*)&FPU_FMUL,FC_OP1,FC_OP2);
+			dyn_fpu_arith(0x01);
 			break;
 		case 0x02:  /* FCOMP5*/
 			dyn_fpu_top();
@@ -569,28 +634,28 @@ static void dyn_fpu_esc6(){
 			gen_and_imm(FC_OP2,7);
 			gen_mov_word_to_reg(FC_OP1,(void*)(&TOP),true);
 			gen_call_function_RR((void*)&FPU_FCOM,FC_OP1,FC_OP2);
-			gen_call_function_raw((void*)&FPU_FPOP); /* extra pop at the bottom*/
+			dyn_fpu_pop(); /* extra pop at the bottom*/
 			break;
 		case 0x04:  /* FSUBRP STi,ST*/
 			dyn_fpu_top_swapped();
-			gen_call_function_RR((void*)&FPU_FSUBR,FC_OP1,FC_OP2);
+			dyn_fpu_arith(0x05);
 			break;
 		case 0x05:  /* FSUBP  STi,ST*/
 			dyn_fpu_top_swapped();
-			gen_call_function_RR((void*)&FPU_FSUB,FC_OP1,FC_OP2);
+			dyn_fpu_arith(0x04);
 			break;
 		case 0x06:	/* FDIVRP STi,ST*/
 			dyn_fpu_top_swapped();
-			gen_call_function_RR((void*)&FPU_FDIVR,FC_OP1,FC_OP2);
+			dyn_fpu_arith(0x07);
 			break;
 		case 0x07:  /* FDIVP STi,ST*/
 			dyn_fpu_top_swapped();
-			gen_call_function_RR((void*)&FPU_FDIV,FC_OP1,FC_OP2);
+			dyn_fpu_arith(0x06);
 			break;
 		default:
 			break;
 		}
-		gen_call_function_raw((void*)&FPU_FPOP);		
+		dyn_fpu_pop();		
 	} else {
 		dyn_fill_ea(FC_ADDR);
 		gen_call_function_R((void*)&FPU_FLD_I16_EA,FC_ADDR); 
@@ -606,17 +671,17 @@ static void dyn_fpu_esc7(){
 		case 0x00: /* FFREEP STi */
 			dyn_fpu_top();
 			gen_call_function_R((void*)&FPU_FFREE,FC_OP2);
-			gen_call_function_raw((void*)&FPU_FPOP);
+			dyn_fpu_pop();
 			break;
 		case 0x01: /* FXCH STi*/
 			dyn_fpu_top();
-			gen_call_function_RR((void*)&FPU_FXCH,FC_OP1,FC_OP2);
+			dyn_fpu_xchg();
 			break;
 		case 0x02:  /* FSTP STi*/
 		case 0x03:  /* FSTP STi*/
 			dyn_fpu_top();
-			gen_call_function_RR((void*)&FPU_FST,FC_OP1,FC_OP2);
-			gen_call_function_raw((void*)&FPU_FPOP);
+			dyn_fpu_copy();
+			dyn_fpu_pop();
 			break;
 		case 0x04:
 			switch(decode.modrm.rm){
@@ -653,7 +718,7 @@ static void dyn_fpu_esc7(){
 		case 0x03:	/* FISTP Bit16s */
 			dyn_fill_ea(FC_ADDR); 
 			gen_call_function_R((void*)&FPU_FST_I16,FC_ADDR);
-			gen_call_function_raw((void*)&FPU_FPOP);
+			dyn_fpu_pop();
 			break;
 		case 0x04:   /* FBLD packed BCD */
 			gen_call_function_raw((void*)&FPU_PREP_PUSH);
@@ -670,12 +735,12 @@ static void dyn_fpu_esc7(){
 		case 0x06:	/* FBSTP packed BCD */
 			dyn_fill_ea(FC_ADDR); 
 			gen_call_function_R((void*)&FPU_FBST,FC_ADDR);
-			gen_call_function_raw((void*)&FPU_FPOP);
+			dyn_fpu_pop();
 			break;
 		case 0x07:  /* FISTP Bit64s */
 			dyn_fill_ea(FC_ADDR); 
 			gen_call_function_R((void*)&FPU_FST_I64,FC_ADDR);
-			gen_call_function_raw((void*)&FPU_FPOP);
+			dyn_fpu_pop();
 			break;
 		default:
 			LOG(LOG_FPU,LOG_WARN)("ESC 7 EA:Unhandled group %d subfunction %d",decode.modrm.reg,decode.modrm.rm);
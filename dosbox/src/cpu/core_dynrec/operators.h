@@ -790,6 +790,14 @@ static Bit8u DRC_CALL_CONV dynrec_rcl_byte(Bit8u op1,Bit8u op2) {
 	} else return op1;
 }
 
+static Bit8u DRC_CALL_CONV dynrec_rcl_byte_simple(Bit8u op1,Bit8u op2) DRC_FC;
+static Bit8u DRC_CALL_CONV dynrec_rcl_byte_simple(Bit8u op1,Bit8u op2) {
+	op2%=9;
+	if (!op2) return op1;
+	Bit8u cf=(Bit8u)(get_CF()!=0);
+	return (op1 << op2) | (cf << (op2-1)) | (op1 >> (9-op2));
+}
+
 static Bit8u DRC_CALL_CONV dynrec_rcr_byte(Bit8u op1,Bit8u op2) DRC_FC;
 static Bit8u DRC_CALL_CONV dynrec_rcr_byte(Bit8u op1,Bit8u op2) {
 	if (op2%9) {
@@ -803,6 +811,14 @@ static Bit8u DRC_CALL_CONV dynrec_rcr_byte(Bit8u op1,Bit8u op2) {
 	} else return op1;
 }
 
+static Bit8u DRC_CALL_CONV dynrec_rcr_byte_simple(Bit8u op1,Bit8u op2) DRC_FC;
+static Bit8u DRC_CALL_CONV dynrec_rcr_byte_simple(Bit8u op1,Bit8u op2) {
+	op2%=9;
+	if (!op2) return op1;
+	Bit8u cf=(Bit8u)(get_CF()!=0);
+	return (op1 >> op2) | (cf << (8-op2)) | (op1 << (9-op2));
+}
+
 static Bit8u DRC_CALL_CONV dynrec_shl_byte(Bit8u op1,Bit8u op2) DRC_FC;
 static Bit8u DRC_CALL_CONV dynrec_shl_byte(Bit8u op1,Bit8u op2) {
 	if (!op2) return op1;
@@ -921,6 +937,14 @@ static Bit16u DRC_CALL_CONV dynrec_rcl_word(Bit16u op1,Bit8u op2) {
 	} else return op1;
 }
 
+static Bit16u DRC_CALL_CONV dynrec_rcl_word_simple(Bit16u op1,Bit8u op2) DRC_FC;
+static Bit16u DRC_CALL_CONV dynrec_rcl_word_simple(Bit16u op1,Bit8u op2) {
+	op2%=17;
+	if (!op2) return op1;
+	Bit16u cf=(Bit16u)(get_CF()!=0);
+	return (op1 << op2) | (cf << (op2-1)) | (op1 >> (17-op2));
+}
+
 static Bit16u DRC_CALL_CONV dynrec_rcr_word(Bit16u op1,Bit8u op2) DRC_FC;
 static Bit16u DRC_CALL_CONV dynrec_rcr_word(Bit16u op1,Bit8u op2) {
 	if (op2%17) {
@@ -934,6 +958,14 @@ static Bit16u DRC_CALL_CONV dynrec_rcr_word(Bit16u op1,Bit8u op2) {
 	} else return op1;
 }
 
+static Bit16u DRC_CALL_CONV dynrec_rcr_word_simple(Bit16u op1,Bit8u op2) DRC_FC;
+static Bit16u DRC_CALL_CONV dynrec_rcr_word_simple(Bit16u op1,Bit8u op2) {
+	op2%=17;
+	if (!op2) return op1;
+	Bit16u cf=(Bit16u)(get_CF()!=0);
+	return (op1 >> op2) | (cf << (16-op2)) | (op1 << (17-op2));
+}
+
 static Bit16u DRC_CALL_CONV dynrec_shl_word(Bit16u op1,Bit8u op2) DRC_FC;
 static Bit16u DRC_CALL_CONV dynrec_shl_word(Bit16u op1,Bit8u op2) {
 	if (!op2) return op1;
@@ -1041,6 +1073,14 @@ static Bit32u DRC_CALL_CONV dynrec_rcl_dword(Bit32u op1,Bit8u op2) {
 	return lf_resd;
 }
 
+static Bit32u DRC_CALL_CONV dynrec_rcl_dword_simple(Bit32u op1,Bit8u op2) DRC_FC;
+static Bit32u DRC_CALL_CONV dynrec_rcl_dword_simple(Bit32u op1,Bit8u op2) {
+	if (!op2) return op1;
+	Bit32u cf=(Bit32u)(get_CF()!=0);
+	if (op2==1) return (op1 << 1) | cf;
+	return (op1 << op2) | (cf << (op2-1)) | (op1 >> (33-op2));
+}
+
 static Bit32u DRC_CALL_CONV dynrec_rcr_dword(Bit32u op1,Bit8u op2) DRC_FC;
 static Bit32u DRC_CALL_CONV dynrec_rcr_dword(Bit32u op1,Bit8u op2) {
 	if (op2) {
@@ -1058,6 +1098,14 @@ static Bit32u DRC_CALL_CONV dynrec_rcr_dword(Bit32u op1,Bit8u op2) {
 	} else return op1;
 }
 
+static Bit32u DRC_CALL_CONV dynrec_rcr_dword_simple(Bit32u op1,Bit8u op2) DRC_FC;
+static Bit32u DRC_CALL_CONV dynrec_rcr_dword_simple(Bit32u op1,Bit8u op2) {
+	if (!op2) return op1;
+	Bit32u cf=(Bit32u)(get_CF()!=0);
+	if (op2==1) return (op1 >> 1) | (cf << 31);
+	return (op1 >> op2) | (cf << (32-op2)) | (op1 << (33-op2));
+}
+
 static Bit32u DRC_CALL_CONV dynrec_shl_dword(Bit32u op1,Bit8u op2) DRC_FC;
 static Bit32u DRC_CALL_CONV dynrec_shl_dword(Bit32u op1,Bit8u op2) {
 	if (!op2) return op1;
@@ -1123,10 +1171,12 @@ static void dyn_shift_byte_gencall(ShiftOps op) {
 			break;
 		case SHIFT_RCL:
 			AcquireFlags(FLAG_CF);
+			InvalidateFlagsPartially((void*)&dynrec_rcl_byte_simple,t_RCLb);
 			gen_call_function_raw((void*)&dynrec_rcl_byte);
 			break;
 		case SHIFT_RCR:
 			AcquireFlags(FLAG_CF);
+			InvalidateFlagsPartially((void*)&dynrec_rcr_byte_simple,t_RCRb);
 			gen_call_function_raw((void*)&dynrec_rcr_byte);
 			break;
 		case SHIFT_SHL:
@@ -1159,10 +1209,12 @@ static void dyn_shift_word_gencall(ShiftOps op,bool dword) {
 				break;
 			case SHIFT_RCL:
 				AcquireFlags(FLAG_CF);
+				InvalidateFlagsPartially((void*)&dynrec_rcl_dword_simple,t_RCLd);
 				gen_call_function_raw((void*)&dynrec_rcl_dword);
 				break;
 			case SHIFT_RCR:
 				AcquireFlags(FLAG_CF);
+				InvalidateFlagsPartially((void*)&dynrec_rcr_dword_simple,t_RCRd);
 				gen_call_function_raw((void*)&dynrec_rcr_dword);
 				break;
 			case SHIFT_SHL:
@@ -1192,10 +1244,12 @@ static void dyn_shift_word_gencall(ShiftOps op,bool dword) {
 				break;
 			case SHIFT_RCL:
 				AcquireFlags(FLAG_CF);
+				InvalidateFlagsPartially((void*)&dynrec_rcl_word_simple,t_RCLw);
 				gen_call_function_raw((void*)&dynrec_rcl_word);
 				break;
 			case SHIFT_RCR:
 				AcquireFlags(FLAG_CF);
+				InvalidateFlagsPartially((void*)&dynrec_rcr_word_simple,t_RCRw);
 				gen_call_function_raw((void*)&dynrec_rcr_word);
 				break;
 			case SHIFT_SHL:
@@ -1566,6 +1620,11 @@ static Bit16u DRC_CALL_CONV dynrec_dimul_word(Bit16u op1,Bit16u op2) {
 	return (Bit16u)(res & 0xffff);
 }
 
+static Bit16u DRC_CALL_CONV dynrec_dimul_word_simple(Bit16u op1,Bit16u op2) DRC_FC;
+static Bit16u DRC_CALL_CONV dynrec_dimul_word_simple(Bit16u op1,Bit16u op2) {
+	return op1*op2;
+}
+
 static Bit32u DRC_CALL_CONV dynrec_dimul_dword(Bit32u op1,Bit32u op2) DRC_FC;
 static Bit32u DRC_CALL_CONV dynrec_dimul_dword(Bit32u op1,Bit32u op2) {
 	FillFlagsNoCFOF();
@@ -1580,6 +1639,11 @@ static Bit32u DRC_CALL_CONV dynrec_dimul_dword(Bit32u op1,Bit32u op2) {
 	return (Bit32s)res;
 }
 
+static Bit32u DRC_CALL_CONV dynrec_dimul_dword_simple(Bit32u op1,Bit32u op2) DRC_FC;
+static Bit32u DRC_CALL_CONV dynrec_dimul_dword_simple(Bit32u op1,Bit32u op2) {
+	return op1*op2;
+}
+
 
 
 static Bit16u DRC_CALL_CONV dynrec_cbw(Bit8u op) DRC_FC;
@@ -33,6 +33,14 @@
 // try to replace _simple functions by code
 #define DRC_FLAGS_INVALIDATION_DCODE
 
+// access directly mapped guest memory inline through the paging tlb
+#define DRC_USE_TLB_FASTPATH
+
+#if defined(__mips_hard_float) && !C_FPU_X86
+// emit fpu code for the basic x87 operations on fpu.regs
+#define DRC_USE_FPU_NATIVE
+#endif
+
 // type with the same size as a pointer
 #define DRC_PTR_SIZE_IM Bit32u
 
@@ -41,9 +49,9 @@
 #define DRC_FC			/* nothing */
 
 // use FC_REGS_ADDR to hold the address of "cpu_regs" and to access it using FC_REGS_ADDR
-//#define DRC_USE_REGS_ADDR
+#define DRC_USE_REGS_ADDR
 // use FC_SEGS_ADDR to hold the address of "Segs" and to access it using FC_SEGS_ADDR
-//#define DRC_USE_SEGS_ADDR
+#define DRC_USE_SEGS_ADDR
 
 // register mapping
 typedef Bit8u HostReg;
@@ -58,6 +66,8 @@ typedef Bit8u HostReg;
 #define HOST_t6 14
 #define HOST_t7 15
 #define HOST_s0 16
+#define HOST_s1 17
+#define HOST_s2 18
 #define HOST_t8 24
 #define HOST_t9 25
 #define temp1 HOST_v1
@@ -87,14 +97,19 @@ typedef Bit8u HostReg;
 // temporary register for LEA
 #define TEMP_REG_DRC HOST_t7
 
+// the guest registers themselves are not cached in host registers, every
+// access is a load or store relative to FC_REGS_ADDR/FC_SEGS_ADDR: the helper
+// functions that nearly every translated instruction calls work on cpu_regs
+// and Segs directly, so cached values would have to be written back and
+// reloaded around almost all of them
 #ifdef DRC_USE_REGS_ADDR
-// used to hold the address of "cpu_regs" - preferably filled in function gen_run_code
-#define FC_REGS_ADDR HOST_???
+// used to hold the address of "cpu_regs" - filled in function gen_run_code
+#define FC_REGS_ADDR HOST_s1
 #endif
 
 #ifdef DRC_USE_SEGS_ADDR
-// used to hold the address of "Segs" - preferably filled in function gen_run_code
-#define FC_SEGS_ADDR HOST_???
+// used to hold the address of "Segs" - filled in function gen_run_code
+#define FC_SEGS_ADDR HOST_s2
 #endif
 
 // save some state to improve code gen
@@ -146,27 +161,48 @@ static Bit16s gen_addr_temp1(Bit32u addr) {
 	return lohalf;
 }
 
+// get the base register and offset that address addr, the emulated
+// registers and segments are reached through FC_REGS_ADDR/FC_SEGS_ADDR
+// without loading temp1, anything else goes through temp1
+static Bit16s gen_addr_base(Bit32u addr,HostReg &base) {
+#ifdef DRC_USE_REGS_ADDR
+	if ((addr>=(Bit32u)&cpu_regs) && (addr<(Bit32u)&cpu_regs+sizeof(cpu_regs))) {
+		base=FC_REGS_ADDR;
+		return (Bit16s)(addr-(Bit32u)&cpu_regs);
+	}
+#endif
+#ifdef DRC_USE_SEGS_ADDR
+	if ((addr>=(Bit32u)&Segs) && (addr<(Bit32u)&Segs+sizeof(Segs))) {
+		base=FC_SEGS_ADDR;
+		return (Bit16s)(addr-(Bit32u)&Segs);
+	}
+#endif
+	base=temp1;
+	return gen_addr_temp1(addr);
+}
+
 // move a 32bit (dword==true) or 16bit (dword==false) value from memory into dest_reg
 // 16bit moves may destroy the upper 16bit of the destination register
 static void gen_mov_word_to_reg(HostReg dest_reg,void* data,bool dword) {
-	Bit16s lohalf = gen_addr_temp1((Bit32u)data);
+	HostReg base;
+	Bit16s lohalf = gen_addr_base((Bit32u)data,base);
 	// alignment....
 	if (dword) {
 		if ((Bit32u)data & 3) {
-			cache_addw(lohalf+3);		// lwl dest_reg, 3(temp1)
-			cache_addw(0x8800+(temp1<<5)+dest_reg);
-			cache_addw(lohalf);		// lwr dest_reg, 0(temp1)
-			cache_addw(0x9800+(temp1<<5)+dest_reg);
+			cache_addw(lohalf+3);		// lwl dest_reg, 3(base)
+			cache_addw(0x8800+(base<<5)+dest_reg);
+			cache_addw(lohalf);		// lwr dest_reg, 0(base)
+			cache_addw(0x9800+(base<<5)+dest_reg);
 		} else {
-			cache_addw(lohalf);		// lw dest_reg, 0(temp1)
-			cache_addw(0x8C00+(temp1<<5)+dest_reg);
+			cache_addw(lohalf);		// lw dest_reg, 0(base)
+			cache_addw(0x8C00+(base<<5)+dest_reg);
 		}
 	} else {
 		if ((Bit32u)data & 1) {
-			cache_addw(lohalf);		// lbu dest_reg, 0(temp1)
-			cache_addw(0x9000+(temp1<<5)+dest_reg);
-			cache_addw(lohalf+1);		// lbu temp2, 1(temp1)
-			cache_addw(0x9000+(temp1<<5)+temp2);
+			cache_addw(lohalf);		// lbu dest_reg, 0(base)
+			cache_addw(0x9000+(base<<5)+dest_reg);
+			cache_addw(lohalf+1);		// lbu temp2, 1(base)
+			cache_addw(0x9000+(base<<5)+temp2);
 #ifdef PSP // i.e. MIPS32R2
 			cache_addw(0x7a04);		// ins dest_reg, temp2, 8, 8
 			cache_addw(0x7c00+(temp2<<5)+dest_reg);
@@ -177,8 +213,8 @@ static void gen_mov_word_to_reg(HostReg dest_reg,void* data,bool dword) {
 			cache_addw((temp2<<5)+dest_reg);
 #endif
 		} else {
-			cache_addw(lohalf);		// lhu dest_reg, 0(temp1);
-			cache_addw(0x9400+(temp1<<5)+dest_reg);
+			cache_addw(lohalf);		// lhu dest_reg, 0(base);
+			cache_addw(0x9400+(base<<5)+dest_reg);
 		}
 	}
 }
@@ -192,29 +228,30 @@ static void gen_mov_word_to_reg_imm(HostReg dest_reg,Bit16u imm) {
 
 // move 32bit (dword==true) or 16bit (dword==false) of a register into memory
 static void gen_mov_word_from_reg(HostReg src_reg,void* dest,bool dword) {
-	Bit16s lohalf = gen_addr_temp1((Bit32u)dest);
+	HostReg base;
+	Bit16s lohalf = gen_addr_base((Bit32u)dest,base);
 	// alignment....
 	if (dword) {
 		if ((Bit32u)dest & 3) {
-			cache_addw(lohalf+3);		// swl src_reg, 3(temp1)
-			cache_addw(0xA800+(temp1<<5)+src_reg);
-			cache_addw(lohalf);		// swr src_reg, 0(temp1)
-			cache_addw(0xB800+(temp1<<5)+src_reg);
+			cache_addw(lohalf+3);		// swl src_reg, 3(base)
+			cache_addw(0xA800+(base<<5)+src_reg);
+			cache_addw(lohalf);		// swr src_reg, 0(base)
+			cache_addw(0xB800+(base<<5)+src_reg);
 		} else {
-			cache_addw(lohalf);		// sw src_reg, 0(temp1)
-			cache_addw(0xAC00+(temp1<<5)+src_reg);
+			cache_addw(lohalf);		// sw src_reg, 0(base)
+			cache_addw(0xAC00+(base<<5)+src_reg);
 		}
 	} else {
 		if((Bit32u)dest & 1) {
-			cache_addw(lohalf);		// sb src_reg, 0(temp1)
-			cache_addw(0xA000+(temp1<<5)+src_reg);
+			cache_addw(lohalf);		// sb src_reg, 0(base)
+			cache_addw(0xA000+(base<<5)+src_reg);
 			cache_addw((temp2<<11)+0x202);		// srl temp2, src_reg, 8
 			cache_addw(src_reg);
-			cache_addw(lohalf+1);		// sb temp2, 1(temp1)
-			cache_addw(0xA000+(temp1<<5)+temp2);
+			cache_addw(lohalf+1);		// sb temp2, 1(base)
+			cache_addw(0xA000+(base<<5)+temp2);
 		} else {
-			cache_addw(lohalf);		// sh src_reg, 0(temp1);
-			cache_addw(0xA400+(temp1<<5)+src_reg);
+			cache_addw(lohalf);		// sh src_reg, 0(base);
+			cache_addw(0xA400+(base<<5)+src_reg);
 		}
 	}
 }
@@ -224,9 +261,10 @@ static void gen_mov_word_from_reg(HostReg src_reg,void* dest,bool dword) {
 // this function does not use FC_OP1/FC_OP2 as dest_reg as these
 // registers might not be directly byte-accessible on some architectures
 static void gen_mov_byte_to_reg_low(HostReg dest_reg,void* data) {
-	Bit16s lohalf = gen_addr_temp1((Bit32u)data);
-	cache_addw(lohalf);			// lbu dest_reg, 0(temp1)
-	cache_addw(0x9000+(temp1<<5)+dest_reg);
+	HostReg base;
+	Bit16s lohalf = gen_addr_base((Bit32u)data,base);
+	cache_addw(lohalf);			// lbu dest_reg, 0(base)
+	cache_addw(0x9000+(base<<5)+dest_reg);
 }
 
 // move an 8bit value from memory into dest_reg
@@ -255,9 +293,10 @@ static void INLINE gen_mov_byte_to_reg_low_imm_canuseword(HostReg dest_reg,Bit8u
 
 // move the lowest 8bit of a register into memory
 static void gen_mov_byte_from_reg_low(HostReg src_reg,void* dest) {
-	Bit16s lohalf = gen_addr_temp1((Bit32u)dest);
-	cache_addw(lohalf);			// sb src_reg, 0(temp1)
-	cache_addw(0xA000+(temp1<<5)+src_reg);
+	HostReg base;
+	Bit16s lohalf = gen_addr_base((Bit32u)dest,base);
+	cache_addw(lohalf);			// sb src_reg, 0(base)
+	cache_addw(0xA000+(base<<5)+src_reg);
 }
 
 
@@ -560,10 +599,228 @@ static void INLINE gen_fill_branch_long(Bit32u data) {
 }
 #endif
 
+#if defined(DRC_USE_TLB_FASTPATH)
+// inline lookup of the paging tlb entry for an access of size bytes at the
+// address in addr_reg; afterwards temp1 holds the host address, the returned
+// branch is taken if there is no direct host memory for the page or
+// the access crosses the page boundary, set it by gen_fill_branch() later
+static Bit32u gen_tlb_lookup(HostReg addr_reg,bool write,Bitu size) {
+#if defined(USE_FULL_TLB)
+	Bit32u tlb=(Bit32u)(write ? paging.tlb.write : paging.tlb.read);
+	temp1_valid = false;
+	cache_addw((temp1<<11)+(12<<6)+2);	// srl temp1, addr_reg, 12
+	cache_addw(addr_reg);
+#else
+	Bit32u tlb=(Bit32u)paging.tlb_dir;
+	temp1_valid = false;
+	cache_addw((temp1<<11)+(TLB_DIR_SHIFT<<6)+2);	// srl temp1, addr_reg, 22
+	cache_addw(addr_reg);
+#endif
+	cache_addw((temp1<<11)+(2<<6));		// sll temp1, temp1, 2
+	cache_addw(temp1);
+	cache_addw((tlb+0x8000)>>16);		// lui temp2, %hi(tlb)
+	cache_addw(0x3c00+temp2);
+	cache_addw((temp1<<11)+0x21);		// addu temp1, temp1, temp2
+	cache_addw((temp1<<5)+temp2);
+	cache_addw((Bit16u)tlb);			// lw temp1, %lo(tlb)(temp1)
+	cache_addw(0x8c00+(temp1<<5)+temp1);
+#if !defined(USE_FULL_TLB)
+	// temp1 holds the table of the 4MB region, index it by the page
+	cache_addw((temp2<<11)+(10<<6)+2);	// srl temp2, addr_reg, 10
+	cache_addw(addr_reg);
+	cache_addw((TLB_TABLE_SIZE-1)<<2);	// andi temp2, temp2, 0xffc
+	cache_addw(0x3000+(temp2<<5)+temp2);
+	cache_addw((temp1<<11)+0x21);		// addu temp1, temp1, temp2
+	cache_addw((temp1<<5)+temp2);
+	cache_addw(write ? offsetof(tlb_table,write) : offsetof(tlb_table,read));	// lw temp1, offset(temp1)
+	cache_addw(0x8c00+(temp1<<5)+temp1);
+#endif
+	if (size>1) {
+		cache_addw(0xfff);				// andi temp2, addr_reg, 0xfff
+		cache_addw(0x3000+(addr_reg<<5)+temp2);
+		cache_addw(0x1001-size);		// sltiu temp2, temp2, 0x1001-size
+		cache_addw(0x2c00+(temp2<<5)+temp2);
+		cache_addw((temp1<<11)+0x0a);	// movz temp1, $0, temp2
+		cache_addw(temp2);
+	}
+	cache_addw(0);						// beq $0, temp1, 0
+	cache_addw(0x1000+temp1);
+	cache_addw((temp1<<11)+0x21);		// addu temp1, temp1, addr_reg (delay slot)
+	cache_addw((temp1<<5)+addr_reg);
+	return ((Bit32u)cache.pos-8);
+}
+
+// read size bytes from the address in addr_reg into dest_reg if the page
+// is directly accessible; returns the branch that is taken otherwise
+static Bit32u gen_tlb_read_fast(HostReg addr_reg,HostReg dest_reg,Bitu size) {
+	Bit32u miss=gen_tlb_lookup(addr_reg,false,size);
+	switch (size) {
+		case 1:
+			cache_addw(0);				// lbu dest_reg, 0(temp1)
+			cache_addw(0x9000+(temp1<<5)+dest_reg);
+			break;
+		case 2:
+			cache_addw(0);				// lbu dest_reg, 0(temp1)
+			cache_addw(0x9000+(temp1<<5)+dest_reg);
+			cache_addw(1);				// lbu temp2, 1(temp1)
+			cache_addw(0x9000+(temp1<<5)+temp2);
+			cache_addw((temp2<<11)+(8<<6));	// sll temp2, temp2, 8
+			cache_addw(temp2);
+			cache_addw((dest_reg<<11)+0x25);	// or dest_reg, dest_reg, temp2
+			cache_addw((dest_reg<<5)+temp2);
+			break;
+		case 4:
+			cache_addw(3);				// lwl dest_reg, 3(temp1)
+			cache_addw(0x8800+(temp1<<5)+dest_reg);
+			cache_addw(0);				// lwr dest_reg, 0(temp1)
+			cache_addw(0x9800+(temp1<<5)+dest_reg);
+			break;
+	}
+	return miss;
+}
+
+// write size bytes of val_reg to the address in addr_reg if the page
+// is directly accessible; returns the branch that is taken otherwise
+static Bit32u gen_tlb_write_fast(HostReg addr_reg,HostReg val_reg,Bitu size) {
+	Bit32u miss=gen_tlb_lookup(addr_reg,true,size);
+	switch (size) {
+		case 1:
+			cache_addw(0);				// sb val_reg, 0(temp1)
+			cache_addw(0xa000+(temp1<<5)+val_reg);
+			break;
+		case 2:
+			cache_addw(0);				// sb val_reg, 0(temp1)
+			cache_addw(0xa000+(temp1<<5)+val_reg);
+			cache_addw((temp2<<11)+(8<<6)+2);	// srl temp2, val_reg, 8
+			cache_addw(val_reg);
+			cache_addw(1);				// sb temp2, 1(temp1)
+			cache_addw(0xa000+(temp1<<5)+temp2);
+			break;
+		case 4:
+			cache_addw(3);				// swl val_reg, 3(temp1)
+			cache_addw(0xa800+(temp1<<5)+val_reg);
+			cache_addw(0);				// swr val_reg, 0(temp1)
+			cache_addw(0xb800+(temp1<<5)+val_reg);
+			break;
+	}
+	return miss;
+}
+
+// short unconditional jump (+-127 bytes)
+// the destination is set by gen_fill_branch() later
+static Bit32u INLINE gen_create_jump(void) {
+	temp1_valid = false;
+	cache_addw(0);			// beq $0, $0, 0
+	cache_addw(0x1000);
+	DELAY;
+	return ((Bit32u)cache.pos-8);
+}
+#endif
+
+#if defined(DRC_USE_FPU_NATIVE)
+// load the address of an fpu array into temp2
+static void gen_fpu_base(void * ptr) {
+	temp1_valid = false;
+	cache_addw(((Bit32u)ptr+0x8000)>>16);	// lui temp2, %hi(ptr)
+	cache_addw(0x3c00+temp2);
+	cache_addw((Bit16u)(Bit32u)ptr);		// addiu temp2, temp2, %lo(ptr)
+	cache_addw(0x2400+(temp2<<5)+temp2);
+}
+
+// dest_reg = temp2 + (idx<<shift)
+static void gen_fpu_index(HostReg dest_reg,HostReg idx,Bitu shift) {
+	cache_addw((dest_reg<<11)+(shift<<6));	// sll dest_reg, idx, shift
+	cache_addw(idx);
+	cache_addw((dest_reg<<11)+0x21);		// addu dest_reg, dest_reg, temp2
+	cache_addw((dest_reg<<5)+temp2);
+}
+
+// ldc1 (op=0xd400) or sdc1 (op=0xf400) of fpr to/from 0(base)
+static void gen_fpu_ldst(Bit16u op,Bitu fpr,HostReg base) {
+	cache_addw(0);
+	cache_addw(op+(base<<5)+fpr);
+}
+
+// fpu.regs[dst_idx]=fpu.regs[dst_idx] op fpu.regs[src_idx] with op being
+// the x87 arithmetic group (0:add 1:mul 4:sub 5:subr 6:div 7:divr)
+static void gen_fpu_arith(Bitu op,HostReg dst_idx,HostReg src_idx) {
+	static const Bit8u fpu_ops[8]={0x00,0x02,0,0,0x01,0x01,0x03,0x03};
+	gen_fpu_base(&fpu.regs[0]);
+	gen_fpu_index(temp1,dst_idx,3);
+	gen_fpu_index(FC_RETOP,src_idx,3);
+	gen_fpu_ldst(0xd400,0,temp1);			// ldc1 $f0, 0(temp1)
+	gen_fpu_ldst(0xd400,2,FC_RETOP);		// ldc1 $f2, 0($v0)
+	if ((op==5) || (op==7)) {
+		cache_addw((2<<11)+fpu_ops[op]);	// op.d $f0, $f2, $f0
+		cache_addw(0x4620);
+	} else {
+		cache_addw(fpu_ops[op]);			// op.d $f0, $f0, $f2
+		cache_addw(0x4622);
+	}
+	gen_fpu_ldst(0xf400,0,temp1);			// sdc1 $f0, 0(temp1)
+}
+
+// copy register and tag src_idx to dst_idx
+static void gen_fpu_copy(HostReg dst_idx,HostReg src_idx) {
+	gen_fpu_base(&fpu.regs[0]);
+	gen_fpu_index(temp1,dst_idx,3);
+	gen_fpu_index(FC_RETOP,src_idx,3);
+	gen_fpu_ldst(0xd400,0,FC_RETOP);		// ldc1 $f0, 0($v0)
+	gen_fpu_ldst(0xf400,0,temp1);			// sdc1 $f0, 0(temp1)
+	gen_fpu_base(&fpu.tags[0]);
+	gen_fpu_index(temp1,dst_idx,2);
+	gen_fpu_index(FC_RETOP,src_idx,2);
+	cache_addw(0);							// lw temp2, 0($v0)
+	cache_addw(0x8c00+(FC_RETOP<<5)+temp2);
+	cache_addw(0);							// sw temp2, 0(temp1)
+	cache_addw(0xac00+(temp1<<5)+temp2);
+}
+
+// exchange registers and tags idx1 and idx2
+static void gen_fpu_xchg(HostReg idx1,HostReg idx2) {
+	gen_fpu_base(&fpu.regs[0]);
+	gen_fpu_index(temp1,idx1,3);
+	gen_fpu_index(FC_RETOP,idx2,3);
+	gen_fpu_ldst(0xd400,0,temp1);			// ldc1 $f0, 0(temp1)
+	gen_fpu_ldst(0xd400,2,FC_RETOP);		// ldc1 $f2, 0($v0)
+	gen_fpu_ldst(0xf400,2,temp1);			// sdc1 $f2, 0(temp1)
+	gen_fpu_ldst(0xf400,0,FC_RETOP);		// sdc1 $f0, 0($v0)
+	gen_fpu_base(&fpu.tags[0]);
+	gen_fpu_index(temp1,idx1,2);
+	gen_fpu_index(FC_RETOP,idx2,2);
+	cache_addw(0);							// lw temp2, 0(temp1)
+	cache_addw(0x8c00+(temp1<<5)+temp2);
+	cache_addw(0);							// lw a2, 0($v0)
+	cache_addw(0x8c00+(FC_RETOP<<5)+FC_OP3);
+	cache_addw(0);							// sw a2, 0(temp1)
+	cache_addw(0xac00+(temp1<<5)+FC_OP3);
+	cache_addw(0);							// sw temp2, 0($v0)
+	cache_addw(0xac00+(FC_RETOP<<5)+temp2);
+}
+
+// set the tag of register idx
+static void gen_fpu_settag(HostReg idx,FPU_Tag tag) {
+	gen_fpu_base(&fpu.tags[0]);
+	gen_fpu_index(temp1,idx,2);
+	cache_addw((Bit16u)tag);				// addiu $v0, $0, tag
+	cache_addw(0x2400+FC_RETOP);
+	cache_addw(0);							// sw $v0, 0(temp1)
+	cache_addw(0xac00+(temp1<<5)+FC_RETOP);
+}
+#endif
+
 static void gen_run_code(void) {
 	temp1_valid = false;
 	cache_addd(0x27bdffe0);			// addiu $sp, $sp, -32
+	cache_addd(0xafb20010);			// sw $s2, 16($sp)
+	cache_addd(0xafb10014);			// sw $s1, 20($sp)
 	cache_addd(0xafb00018);			// sw $s0, 24($sp)
+#ifdef DRC_USE_REGS_ADDR
+	gen_mov_dword_to_reg_imm(FC_REGS_ADDR, (Bit32u)&cpu_regs);
+#endif
+#ifdef DRC_USE_SEGS_ADDR
+	gen_mov_dword_to_reg_imm(FC_SEGS_ADDR, (Bit32u)&Segs);
+#endif
 	cache_addd(0x00800008);			// jr $a0
 	cache_addd(0xafbf001c);			// sw $ra, 28($sp)
 }
@@ -572,6 +829,8 @@ static void gen_run_code(void) {
 static void gen_return_function(void) {
 	temp1_valid = false;
 	cache_addd(0x8fbf001c);			// lw $ra, 28($sp)
+	cache_addd(0x8fb20010);			// lw $s2, 16($sp)
+	cache_addd(0x8fb10014);			// lw $s1, 20($sp)
 	cache_addd(0x8fb00018);			// lw $s0, 24($sp)
 	cache_addd(0x03e00008);			// jr $ra
 	cache_addd(0x27bd0020);			// addiu $sp, $sp, 32
@@ -699,17 +958,22 @@ static void cache_block_before_close(void) { }
 // mov 16bit value from Segs[index] into dest_reg using FC_SEGS_ADDR (index modulo 2 must be zero)
 // 16bit moves may destroy the upper 16bit of the destination register
 static void gen_mov_seg16_to_reg(HostReg dest_reg,Bitu index) {
-// stub
+	cache_addw((Bit16u)index);		// lhu dest_reg, index(FC_SEGS_ADDR)
+	cache_addw(0x9400+(FC_SEGS_ADDR<<5)+dest_reg);
 }
 
 // mov 32bit value from Segs[index] into dest_reg using FC_SEGS_ADDR (index modulo 4 must be zero)
 static void gen_mov_seg32_to_reg(HostReg dest_reg,Bitu index) {
-// stub
+	cache_addw((Bit16u)index);		// lw dest_reg, index(FC_SEGS_ADDR)
+	cache_addw(0x8C00+(FC_SEGS_ADDR<<5)+dest_reg);
 }
 
 // add a 32bit value from Segs[index] to a full register using FC_SEGS_ADDR (index modulo 4 must be zero)
 static void gen_add_seg32_to_reg(HostReg reg,Bitu index) {
-// stub
+	cache_addw((Bit16u)index);		// lw temp2, index(FC_SEGS_ADDR)
+	cache_addw(0x8C00+(FC_SEGS_ADDR<<5)+temp2);
+	cache_addw((reg<<11)+0x21);		// addu reg, reg, temp2
+	cache_addw((reg<<5)+temp2);
 }
 
 #endif
@@ -719,18 +983,21 @@ static void gen_add_seg32_to_reg(HostReg reg,Bitu index) {
 // mov 16bit value from cpu_regs[index] into dest_reg using FC_REGS_ADDR (index modulo 2 must be zero)
 // 16bit moves may destroy the upper 16bit of the destination register
 static void gen_mov_regval16_to_reg(HostReg dest_reg,Bitu index) {
-// stub
+	cache_addw((Bit16u)index);		// lhu dest_reg, index(FC_REGS_ADDR)
+	cache_addw(0x9400+(FC_REGS_ADDR<<5)+dest_reg);
 }
 
 // mov 32bit value from cpu_regs[index] into dest_reg using FC_REGS_ADDR (index modulo 4 must be zero)
 static void gen_mov_regval32_to_reg(HostReg dest_reg,Bitu index) {
-// stub
+	cache_addw((Bit16u)index);		// lw dest_reg, index(FC_REGS_ADDR)
+	cache_addw(0x8C00+(FC_REGS_ADDR<<5)+dest_reg);
 }
 
 // move a 32bit (dword==true) or 16bit (dword==false) value from cpu_regs[index] into dest_reg using FC_REGS_ADDR (if dword==true index modulo 4 must be zero) (if dword==false index modulo 2 must be zero)
 // 16bit moves may destroy the upper 16bit of the destination register
 static void gen_mov_regword_to_reg(HostReg dest_reg,Bitu index,bool dword) {
-// stub
+	if (dword) gen_mov_regval32_to_reg(dest_reg,index);
+	else gen_mov_regval16_to_reg(dest_reg,index);
 }
 
 // move an 8bit value from cpu_regs[index]  into dest_reg using FC_REGS_ADDR
@@ -738,7 +1005,8 @@ static void gen_mov_regword_to_reg(HostReg dest_reg,Bitu index,bool dword) {
 // this function does not use FC_OP1/FC_OP2 as dest_reg as these
 // registers might not be directly byte-accessible on some architectures
 static void gen_mov_regbyte_to_reg_low(HostReg dest_reg,Bitu index) {
-// stub
+	cache_addw((Bit16u)index);		// lbu dest_reg, index(FC_REGS_ADDR)
+	cache_addw(0x9000+(FC_REGS_ADDR<<5)+dest_reg);
 }
 
 // move an 8bit value from cpu_regs[index]  into dest_reg using FC_REGS_ADDR
@@ -746,34 +1014,41 @@ static void gen_mov_regbyte_to_reg_low(HostReg dest_reg,Bitu index) {
 // this function can use FC_OP1/FC_OP2 as dest_reg which are
 // not directly byte-accessible on some architectures
 static void INLINE gen_mov_regbyte_to_reg_low_canuseword(HostReg dest_reg,Bitu index) {
-// stub
+	gen_mov_regbyte_to_reg_low(dest_reg,index);
 }
 
 
 // add a 32bit value from cpu_regs[index] to a full register using FC_REGS_ADDR (index modulo 4 must be zero)
 static void gen_add_regval32_to_reg(HostReg reg,Bitu index) {
-// stub
+	cache_addw((Bit16u)index);		// lw temp2, index(FC_REGS_ADDR)
+	cache_addw(0x8C00+(FC_REGS_ADDR<<5)+temp2);
+	cache_addw((reg<<11)+0x21);		// addu reg, reg, temp2
+	cache_addw((reg<<5)+temp2);
 }
 
 
 // move 16bit of register into cpu_regs[index] using FC_REGS_ADDR (index modulo 2 must be zero)
 static void gen_mov_regval16_from_reg(HostReg src_reg,Bitu index) {
-// stub
+	cache_addw((Bit16u)index);		// sh src_reg, index(FC_REGS_ADDR)
+	cache_addw(0xA400+(FC_REGS_ADDR<<5)+src_reg);
 }
 
 // move 32bit of register into cpu_regs[index] using FC_REGS_ADDR (index modulo 4 must be zero)
 static void gen_mov_regval32_from_reg(HostReg src_reg,Bitu index) {
-// stub
+	cache_addw((Bit16u)index);		// sw src_reg, index(FC_REGS_ADDR)
+	cache_addw(0xAC00+(FC_REGS_ADDR<<5)+src_reg);
 }
 
 // move 32bit (dword==true) or 16bit (dword==false) of a register into cpu_regs[index] using FC_REGS_ADDR (if dword==true index modulo 4 must be zero) (if dword==false index modulo 2 must be zero)
 static void gen_mov_regword_from_reg(HostReg src_reg,Bitu index,bool dword) {
-// stub
+	if (dword) gen_mov_regval32_from_reg(src_reg,index);
+	else gen_mov_regval16_from_reg(src_reg,index);
 }
 
 // move the lowest 8bit of a register into cpu_regs[index] using FC_REGS_ADDR
 static void gen_mov_regbyte_from_reg_low(HostReg src_reg,Bitu index) {
-// stub
+	cache_addw((Bit16u)index);		// sb src_reg, index(FC_REGS_ADDR)
+	cache_addw(0xA000+(FC_REGS_ADDR<<5)+src_reg);
 }
 
 #endif
@@ -29,6 +29,14 @@
 // try to replace _simple functions by code
 #define DRC_FLAGS_INVALIDATION_DCODE
 
+// access directly mapped guest memory inline through the paging tlb
+#define DRC_USE_TLB_FASTPATH
+
+#if !C_FPU_X86
+// emit sse2 code for the basic x87 operations on fpu.regs
+#define DRC_USE_FPU_NATIVE
+#endif
+
 // type with the same size as a pointer
 #define DRC_PTR_SIZE_IM Bit64u
 
@@ -610,6 +618,160 @@ static void gen_fill_branch_long(Bit64u data) {
 	*(Bit32u*)data=(Bit32u)((Bit64u)cache.pos-data-4);
 }
 
+#if defined(DRC_USE_TLB_FASTPATH)
+// inline lookup of the paging tlb entry for an access of size bytes at the
+// address in addr_reg; afterwards r10 holds the host base and r11 the address,
+// the returned branch is taken if there is no direct host memory for the page
+// or the access crosses the page boundary, set it by gen_fill_branch() later
+static Bit64u gen_tlb_lookup(HostReg addr_reg,bool write,Bitu size) {
+#if defined(USE_FULL_TLB)
+	cache_addb(0x41);
+	cache_addw(0xc289+(addr_reg<<11));	// mov r10d,addr_reg
+	cache_addb(0x41);
+	cache_addw(0xeac1);
+	cache_addb(0x0c);					// shr r10d,12
+	cache_addw(0xbb49);
+	cache_addq((Bit64u)(write ? paging.tlb.write : paging.tlb.read));	// mov r11,tlb table
+	cache_addd(0xd3148b4f);				// mov r10,[r11+r10*8]
+#else
+	cache_addb(0x41);
+	cache_addw(0xc289+(addr_reg<<11));	// mov r10d,addr_reg
+	cache_addb(0x41);
+	cache_addw(0xeac1);
+	cache_addb(TLB_DIR_SHIFT);			// shr r10d,22
+	cache_addw(0xbb49);
+	cache_addq((Bit64u)paging.tlb_dir);	// mov r11,tlb directory
+	cache_addd(0xd31c8b4f);				// mov r11,[r11+r10*8]
+	cache_addb(0x41);
+	cache_addw(0xc289+(addr_reg<<11));	// mov r10d,addr_reg
+	cache_addb(0x41);
+	cache_addw(0xeac1);
+	cache_addb(0x0c);					// shr r10d,12
+	cache_addb(0x41);
+	cache_addw(0xe281);
+	cache_addd(TLB_TABLE_SIZE-1);		// and r10d,0x3ff
+	cache_addd(0xd3948b4f);				// mov r10,[r11+r10*8+offset]
+	cache_addd(write ? offsetof(tlb_table,write) : offsetof(tlb_table,read));
+#endif
+	if (size>1) {
+		cache_addb(0x41);
+		cache_addw(0xc389+(addr_reg<<11));	// mov r11d,addr_reg
+		cache_addb(0x41);
+		cache_addw(0xe381);
+		cache_addd(0xfff);				// and r11d,0xfff
+		cache_addb(0x41);
+		cache_addw(0xfb81);
+		cache_addd(0x1000-size);		// cmp r11d,0x1000-size
+		cache_addw(0xbb41);
+		cache_addd(0);					// mov r11d,0
+		cache_addd(0xd3470f4d);			// cmova r10,r11
+	}
+	cache_addb(0x41);
+	cache_addw(0xc389+(addr_reg<<11));	// mov r11d,addr_reg
+	cache_addw(0x854d);
+	cache_addb(0xd2);					// test r10,r10
+	cache_addw(0x0074);					// jz addr
+	return ((Bit64u)cache.pos-1);
+}
+
+// read size bytes from the address in addr_reg into dest_reg if the page
+// is directly accessible; returns the branch that is taken otherwise
+static Bit64u gen_tlb_read_fast(HostReg addr_reg,HostReg dest_reg,Bitu size) {
+	Bit64u miss=gen_tlb_lookup(addr_reg,false,size);
+	cache_addb(0x43);
+	switch (size) {
+		case 1: cache_addw(0xb60f); break;	// movzx dest_reg,byte[r10+r11]
+		case 2: cache_addw(0xb70f); break;	// movzx dest_reg,word[r10+r11]
+		case 4: cache_addb(0x8b); break;	// mov dest_reg,[r10+r11]
+	}
+	cache_addw(0x1a04+(dest_reg<<3));
+	return miss;
+}
+
+// write size bytes of val_reg to the address in addr_reg if the page
+// is directly accessible; returns the branch that is taken otherwise
+static Bit64u gen_tlb_write_fast(HostReg addr_reg,HostReg val_reg,Bitu size) {
+	Bit64u miss=gen_tlb_lookup(addr_reg,true,size);
+	switch (size) {
+		case 1: cache_addw(0x8843); break;	// mov [r10+r11],val_reg8
+		case 2: cache_addb(0x66);			// mov [r10+r11],val_reg16 (fall through)
+		case 4: cache_addw(0x8943); break;	// mov [r10+r11],val_reg
+	}
+	cache_addw(0x1a04+(val_reg<<3));
+	return miss;
+}
+
+// short unconditional jump (+-127 bytes)
+// the destination is set by gen_fill_branch() later
+static Bit64u gen_create_jump(void) {
+	cache_addw(0x00eb);					// jmp addr
+	return ((Bit64u)cache.pos-1);
+}
+#endif
+
+#if defined(DRC_USE_FPU_NATIVE)
+// sse2 scalar double operation between xmm and [rax+idx*8]
+static void gen_fpu_sse(Bit8u op,Bitu xmm,HostReg idx) {
+	cache_addd(0x04000ff2+(op<<16)+(xmm<<27));
+	cache_addb(0xc0+(idx<<3));
+}
+
+// move between r10d (tmp=0)/r11d (tmp=1) and the tag [rax+idx*4]
+static void gen_fpu_tag(Bit8u op,Bitu tmp,HostReg idx) {
+	cache_addw(0x0044+(op<<8));
+	cache_addw(0x8014+(tmp<<3)+(idx<<11));
+}
+
+// fpu.regs[dst_idx]=fpu.regs[dst_idx] op fpu.regs[src_idx] with op being
+// the x87 arithmetic group (0:add 1:mul 4:sub 5:subr 6:div 7:divr)
+static void gen_fpu_arith(Bitu op,HostReg dst_idx,HostReg src_idx) {
+	static const Bit8u sse_ops[8]={0x58,0x59,0,0,0x5c,0x5c,0x5e,0x5e};
+	bool reverse=(op==5) || (op==7);
+	cache_addw(0xb848);
+	cache_addq((Bit64u)&fpu.regs[0]);						// mov rax,fpu.regs
+	gen_fpu_sse(0x10,0,reverse ? src_idx : dst_idx);		// movsd xmm0,[first]
+	gen_fpu_sse(sse_ops[op],0,reverse ? dst_idx : src_idx);	// op xmm0,[second]
+	gen_fpu_sse(0x11,0,dst_idx);							// movsd [dst],xmm0
+}
+
+// copy register and tag src_idx to dst_idx
+static void gen_fpu_copy(HostReg dst_idx,HostReg src_idx) {
+	cache_addw(0xb848);
+	cache_addq((Bit64u)&fpu.regs[0]);		// mov rax,fpu.regs
+	gen_fpu_sse(0x10,0,src_idx);			// movsd xmm0,[src]
+	gen_fpu_sse(0x11,0,dst_idx);			// movsd [dst],xmm0
+	cache_addw(0xb848);
+	cache_addq((Bit64u)&fpu.tags[0]);		// mov rax,fpu.tags
+	gen_fpu_tag(0x8b,0,src_idx);			// mov r10d,[src]
+	gen_fpu_tag(0x89,0,dst_idx);			// mov [dst],r10d
+}
+
+// exchange registers and tags idx1 and idx2
+static void gen_fpu_xchg(HostReg idx1,HostReg idx2) {
+	cache_addw(0xb848);
+	cache_addq((Bit64u)&fpu.regs[0]);		// mov rax,fpu.regs
+	gen_fpu_sse(0x10,0,idx1);				// movsd xmm0,[idx1]
+	gen_fpu_sse(0x10,1,idx2);				// movsd xmm1,[idx2]
+	gen_fpu_sse(0x11,1,idx1);				// movsd [idx1],xmm1
+	gen_fpu_sse(0x11,0,idx2);				// movsd [idx2],xmm0
+	cache_addw(0xb848);
+	cache_addq((Bit64u)&fpu.tags[0]);		// mov rax,fpu.tags
+	gen_fpu_tag(0x8b,0,idx1);				// mov r10d,[idx1]
+	gen_fpu_tag(0x8b,1,idx2);				// mov r11d,[idx2]
+	gen_fpu_tag(0x89,1,idx1);				// mov [idx1],r11d
+	gen_fpu_tag(0x89,0,idx2);				// mov [idx2],r10d
+}
+
+// set the tag of register idx
+static void gen_fpu_settag(HostReg idx,FPU_Tag tag) {
+	cache_addw(0xb848);
+	cache_addq((Bit64u)&fpu.tags[0]);		// mov rax,fpu.tags
+	cache_addw(0x04c7);
+	cache_addb(0x80+(idx<<3));
+	cache_addd((Bit32u)tag);				// mov dword [rax+idx*4],tag
+}
+#endif
+
 
 static void gen_run_code(void) {
 	cache_addb(0x53);					// push rbx
@@ -97,6 +97,10 @@ static struct {
 	bool rep_zero;
 	Bitu prefixes;
 	GetEAHandler * ea_table;
+	struct {
+		Bitu eip,esp,flags;
+		LazyFlags lflags;
+	} restart;			// state to restart an instruction after a page fault
 } core;
 
 #define GETIP		(core.cseip-SegBase(cs))
@@ -137,48 +141,67 @@ static INLINE Bit32u Fetchd() {
 #define EALookupTable (core.ea_table)
 
 Bits CPU_Core_Normal_Run(void) {
-	while (CPU_Cycles-->0) {
-		LOADIP;
-		core.opcode_index=cpu.code.big*0x200;
-		core.prefixes=cpu.code.big;
-		core.ea_table=&EATable[cpu.code.big*256];
-		BaseDS=SegBase(ds);
-		BaseSS=SegBase(ss);
-		core.base_val_ds=ds;
+	PAGING_FaultScope fault_scope(true);
+restart_core:
+	try {
+		while (CPU_Cycles-->0) {
+			LOADIP;
+			core.opcode_index=cpu.code.big*0x200;
+			core.prefixes=cpu.code.big;
+			core.ea_table=&EATable[cpu.code.big*256];
+			BaseDS=SegBase(ds);
+			BaseSS=SegBase(ss);
+			core.base_val_ds=ds;
+			if (paging.enabled) {
+				core.restart.eip=reg_eip;
+				core.restart.esp=reg_esp;
+				core.restart.flags=reg_flags;
+				core.restart.lflags=lflags;
+			}
 #if C_DEBUG
 #if C_HEAVY_DEBUG
-		if (DEBUG_HeavyIsBreakpoint()) {
-			FillFlags();
-			return debugCallback;
-		};
+			if (DEBUG_HeavyIsBreakpoint()) {
+				FillFlags();
+				return debugCallback;
+			};
 #endif
-		cycle_count++;
+			cycle_count++;
 #endif
 restart_opcode:
-		switch (core.opcode_index+Fetchb()) {
-		#include "core_normal/prefix_none.h"
-		#include "core_normal/prefix_0f.h"
-		#include "core_normal/prefix_66.h"
-		#include "core_normal/prefix_66_0f.h"
-		default:
-		illegal_opcode:
+			switch (core.opcode_index+Fetchb()) {
+			#include "core_normal/prefix_none.h"
+			#include "core_normal/prefix_0f.h"
+			#include "core_normal/prefix_66.h"
+			#include "core_normal/prefix_66_0f.h"
+			default:
+			illegal_opcode:
 #if C_DEBUG	
-			{
-				Bitu len=(GETIP-reg_eip);
-				LOADIP;
-				if (len>16) len=16;
-				char tempcode[16*2+1];char * writecode=tempcode;
-				for (;len>0;len--) {
-					sprintf(writecode,"%02X",mem_readb(core.cseip++));
-					writecode+=2;
+				{
+					Bitu len=(GETIP-reg_eip);
+					LOADIP;
+					if (len>16) len=16;
+					char tempcode[16*2+1];char * writecode=tempcode;
+					for (;len>0;len--) {
+						sprintf(writecode,"%02X",mem_readb(core.cseip++));
+						writecode+=2;
+					}
+					LOG(LOG_CPU,LOG_NORMAL)("Illegal/Unhandled opcode %s",tempcode);
 				}
-				LOG(LOG_CPU,LOG_NORMAL)("Illegal/Unhandled opcode %s",tempcode);
-			}
 #endif
-			CPU_Exception(6,0);
-			continue;
+				CPU_Exception(6,0);
+				continue;
+			}
+			SAVEIP;
 		}
-		SAVEIP;
+	} catch (GuestPageFault & fault) {
+		/* Undo the partly executed instruction and enter the fault handler */
+		reg_eip=core.restart.eip;
+		reg_esp=core.restart.esp;
+		reg_flags=core.restart.flags;
+		lflags=core.restart.lflags;
+		cpu.trap_skip=true;
+		CPU_Exception(EXCEPTION_PF,fault.faultcode);
+		goto restart_core;
 	}
 	FillFlags();
 	return CBRET_NONE;
@@ -137,7 +137,8 @@
 	if (rm >= 0xc0) {															\
 		FPU_ESC ## code ## _Normal(rm);										\
 	} else {																\
-		GetEAa;FPU_ESC ## code ## _EA(rm,eaa);								\
+		GetEAa;PAGING_FaultScope fault_scope(false);						\
+		FPU_ESC ## code ## _EA(rm,eaa);										\
 	}																		\
 }
 
@@ -419,8 +419,9 @@
 			GetRMrw;
 			if (rm >= 0xc0) goto illegal_opcode;
 			GetEAa;
+			Bit16u val=LoadMw(eaa);
 			if (CPU_SetSegGeneral(ss,LoadMw(eaa+2))) RUNEXCEPTION();
-			*rmrw=LoadMw(eaa);
+			*rmrw=val;
 			break;
 		}
 	CASE_0F_W(0xb3)												/* BTR Ew,Gw */
@@ -444,8 +445,9 @@
 			GetRMrw;
 			if (rm >= 0xc0) goto illegal_opcode;
 			GetEAa;
+			Bit16u val=LoadMw(eaa);
 			if (CPU_SetSegGeneral(fs,LoadMw(eaa+2))) RUNEXCEPTION();
-			*rmrw=LoadMw(eaa);
+			*rmrw=val;
 			break;
 		}
 	CASE_0F_W(0xb5)												/* LGS Ew */
@@ -453,8 +455,9 @@
 			GetRMrw;
 			if (rm >= 0xc0) goto illegal_opcode;
 			GetEAa;
+			Bit16u val=LoadMw(eaa);
 			if (CPU_SetSegGeneral(gs,LoadMw(eaa+2))) RUNEXCEPTION();
-			*rmrw=LoadMw(eaa);
+			*rmrw=val;
 			break;
 		}
 	CASE_0F_W(0xb6)												/* MOVZX Gw,Eb */
@@ -578,7 +581,7 @@
 			if (CPU_ArchitectureType<CPU_ARCHTYPE_486OLDSLOW) goto illegal_opcode;
 			GetRMrb;Bit8u oldrmrb=*rmrb;
 			if (rm >= 0xc0 ) {GetEArb;*rmrb=*earb;*earb+=oldrmrb;}
-			else {GetEAa;*rmrb=LoadMb(eaa);SaveMb(eaa,LoadMb(eaa)+oldrmrb);}
+			else {GetEAa;Bit8u val=LoadMb(eaa);SaveMb(eaa,val+oldrmrb);*rmrb=val;}
 			break;
 		}
 	CASE_0F_W(0xc1)												/* XADD Gw,Ew */
@@ -586,7 +589,7 @@
 			if (CPU_ArchitectureType<CPU_ARCHTYPE_486OLDSLOW) goto illegal_opcode;
 			GetRMrw;Bit16u oldrmrw=*rmrw;
 			if (rm >= 0xc0 ) {GetEArw;*rmrw=*earw;*earw+=oldrmrw;}
-			else {GetEAa;*rmrw=LoadMw(eaa);SaveMw(eaa,LoadMw(eaa)+oldrmrw);}
+			else {GetEAa;Bit16u val=LoadMw(eaa);SaveMw(eaa,val+oldrmrw);*rmrw=val;}
 			break;
 		}
 	CASE_0F_W(0xc8)												/* BSWAP AX */
@@ -296,7 +296,7 @@
 		{	
 			GetRMrd;Bit32u oldrmrd=*rmrd;
 			if (rm >= 0xc0 ) {GetEArd;*rmrd=*eard;*eard=oldrmrd;}
-			else {GetEAa;*rmrd=LoadMd(eaa);SaveMd(eaa,oldrmrd);}
+			else {GetEAa;Bit32u val=LoadMd(eaa);SaveMd(eaa,oldrmrd);*rmrd=val;}
 			break;
 		}
 	CASE_D(0x89)												/* MOV Ed,Gd */
@@ -465,8 +465,9 @@
 			GetRMrd;
 			if (rm >= 0xc0) goto illegal_opcode;
 			GetEAa;
+			Bit32u val=LoadMd(eaa);
 			if (CPU_SetSegGeneral(es,LoadMw(eaa+4))) RUNEXCEPTION();
-			*rmrd=LoadMd(eaa);
+			*rmrd=val;
 			break;
 		}
 	CASE_D(0xc5)												/* LDS */
@@ -474,8 +475,9 @@
 			GetRMrd;
 			if (rm >= 0xc0) goto illegal_opcode;
 			GetEAa;
+			Bit32u val=LoadMd(eaa);
 			if (CPU_SetSegGeneral(ds,LoadMw(eaa+4))) RUNEXCEPTION();
-			*rmrd=LoadMd(eaa);
+			*rmrd=val;
 			break;
 		}
 	CASE_D(0xc7)												/* MOV Ed,Id */
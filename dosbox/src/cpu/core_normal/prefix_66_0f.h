@@ -268,8 +268,9 @@
 			GetRMrd;
 			if (rm >= 0xc0) goto illegal_opcode;
 			GetEAa;
+			Bit32u val=LoadMd(eaa);
 			if (CPU_SetSegGeneral(ss,LoadMw(eaa+4))) RUNEXCEPTION();
-			*rmrd=LoadMd(eaa);
+			*rmrd=val;
 			break;
 		}
 	CASE_0F_D(0xb3)												/* BTR Ed,Gd */
@@ -293,8 +294,9 @@
 			GetRMrd;
 			if (rm >= 0xc0) goto illegal_opcode;
 			GetEAa;
+			Bit32u val=LoadMd(eaa);
 			if (CPU_SetSegGeneral(fs,LoadMw(eaa+4))) RUNEXCEPTION();
-			*rmrd=LoadMd(eaa);
+			*rmrd=val;
 			break;
 		}
 	CASE_0F_D(0xb5)												/* LGS Ed */
@@ -302,8 +304,9 @@
 			GetRMrd;
 			if (rm >= 0xc0) goto illegal_opcode;
 			GetEAa;
+			Bit32u val=LoadMd(eaa);
 			if (CPU_SetSegGeneral(gs,LoadMw(eaa+4))) RUNEXCEPTION();
-			*rmrd=LoadMd(eaa);
+			*rmrd=val;
 			break;
 		}
 	CASE_0F_D(0xb6)												/* MOVZX Gd,Eb */
@@ -436,7 +439,7 @@
 			if (CPU_ArchitectureType<CPU_ARCHTYPE_486OLDSLOW) goto illegal_opcode;
 			GetRMrd;Bit32u oldrmrd=*rmrd;
 			if (rm >= 0xc0 ) {GetEArd;*rmrd=*eard;*eard+=oldrmrd;}
-			else {GetEAa;*rmrd=LoadMd(eaa);SaveMd(eaa,LoadMd(eaa)+oldrmrd);}
+			else {GetEAa;Bit32u val=LoadMd(eaa);SaveMd(eaa,val+oldrmrd);*rmrd=val;}
 			break;
 		}
 	CASE_0F_D(0xc8)												/* BSWAP EAX */
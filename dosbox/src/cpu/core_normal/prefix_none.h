@@ -416,14 +416,14 @@
 		{	
 			GetRMrb;Bit8u oldrmrb=*rmrb;
 			if (rm >= 0xc0 ) {GetEArb;*rmrb=*earb;*earb=oldrmrb;}
-			else {GetEAa;*rmrb=LoadMb(eaa);SaveMb(eaa,oldrmrb);}
+			else {GetEAa;Bit8u val=LoadMb(eaa);SaveMb(eaa,oldrmrb);*rmrb=val;}
 			break;
 		}
 	CASE_W(0x87)												/* XCHG Ew,Gw */
 		{	
 			GetRMrw;Bit16u oldrmrw=*rmrw;
 			if (rm >= 0xc0 ) {GetEArw;*rmrw=*earw;*earw=oldrmrw;}
-			else {GetEAa;*rmrw=LoadMw(eaa);SaveMw(eaa,oldrmrw);}
+			else {GetEAa;Bit16u val=LoadMw(eaa);SaveMw(eaa,oldrmrw);*rmrw=val;}
 			break;
 		}
 	CASE_B(0x88)												/* MOV Eb,Gb */
@@ -690,8 +690,9 @@
 			GetRMrw;
 			if (rm >= 0xc0) goto illegal_opcode;
 			GetEAa;
+			Bit16u val=LoadMw(eaa);
 			if (CPU_SetSegGeneral(es,LoadMw(eaa+2))) RUNEXCEPTION();
-			*rmrw=LoadMw(eaa);
+			*rmrw=val;
 			break;
 		}
 	CASE_W(0xc5)												/* LDS */
@@ -699,8 +700,9 @@
 			GetRMrw;
 			if (rm >= 0xc0) goto illegal_opcode;
 			GetEAa;
+			Bit16u val=LoadMw(eaa);
 			if (CPU_SetSegGeneral(ds,LoadMw(eaa+2))) RUNEXCEPTION();
-			*rmrw=LoadMw(eaa);
+			*rmrw=val;
 			break;
 		}
 	CASE_B(0xc6)												/* MOV Eb,Ib */
@@ -35,6 +35,11 @@ static void DoString(STRING_OP type) {
 	Bitu	count,count_left;
 	Bits	add_index;
 	
+	/* port accesses can not be repeated when a page fault restarts the instruction,
+	   repeated ops only update si/di/cx after the loop, so they would restart from
+	   the first element with part of the memory already written */
+	PAGING_FaultScope fault_scope(paging.pf_unwind && (type>R_INSD) && !TEST_PREFIX_REP);
+
 	si_base=BaseDS;
 	di_base=SegBase(es);
 	add_mask=AddrMaskTable[core.prefixes & PREFIX_ADDR];
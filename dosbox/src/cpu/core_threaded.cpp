@@ -0,0 +1,998 @@
+/*
+ *  Copyright (C) 2002-2013  The DOSBox Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+	Threaded interpreter core.
+
+	Runs of instructions are decoded once into blocks of pre-decoded
+	operations (register pointers, effective address description, immediates)
+	that are kept in a direct mapped cache indexed by the linear address.
+	Every operation carries the address of its handler, so dispatching
+	is a single indirect jump (computed goto) instead of the prefix
+	and opcode switches of the normal core.
+	Only common integer instructions are pre-decoded, everything else is
+	handed to the normal core one instruction at a time.
+	Blocks in RAM are registered with a code page handler that takes over
+	the writes to their physical page, like the dynamic core does, so
+	writes to the code (from any linear alias, the stack or the normal
+	core) invalidate the blocks. A block that invalidates itself is left
+	after the writing instruction.
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "dosbox.h"
+#include "mem.h"
+#include "cpu.h"
+#include "lazyflags.h"
+#include "inout.h"
+#include "callback.h"
+#include "pic.h"
+#include "fpu.h"
+#include "paging.h"
+#include "modrm.h"
+
+#if C_DEBUG
+#include "debug.h"
+#endif
+
+#if (!C_CORE_INLINE)
+#define LoadMb(off) mem_readb(off)
+#define LoadMw(off) mem_readw(off)
+#define LoadMd(off) mem_readd(off)
+#define SaveMb(off,val)	mem_writeb(off,val)
+#define SaveMw(off,val)	mem_writew(off,val)
+#define SaveMd(off,val)	mem_writed(off,val)
+#else
+#define LoadMb(off) mem_readb_inline(off)
+#define LoadMw(off) mem_readw_inline(off)
+#define LoadMd(off) mem_readd_inline(off)
+#define SaveMb(off,val)	mem_writeb_inline(off,val)
+#define SaveMw(off,val)	mem_writew_inline(off,val)
+#define SaveMd(off,val)	mem_writed_inline(off,val)
+#endif
+
+#define LoadRb(reg) reg
+#define LoadRw(reg) reg
+#define LoadRd(reg) reg
+#define SaveRb(reg,val)	reg=val
+#define SaveRw(reg,val)	reg=val
+#define SaveRd(reg,val)	reg=val
+
+#define Push_16 CPU_Push16
+#define Push_32 CPU_Push32
+#define Pop_16 CPU_Pop16
+#define Pop_32 CPU_Pop32
+
+#include "instructions.h"
+
+// moves fit into the same handler templates as the alu instructions
+#define MOVB(op1,op2,load,save) save(op1,op2);
+#define MOVW(op1,op2,load,save) save(op1,op2);
+#define MOVD(op1,op2,load,save) save(op1,op2);
+
+// dispatch through the handler addresses if the compiler supports it
+#if defined(__GNUC__)
+#define THREADED_GOTO 1
+#else
+#define THREADED_GOTO 0
+#endif
+
+#define THREADED_CACHE_BLOCKS	512		// must be a power of 2
+#define THREADED_BLOCK_OPS		16		// maximal number of instructions per block
+#define THREADED_BLOCK_BYTES	96		// maximal size of the guest code of a block
+#define THREADED_PAGE_RELEASE	16		// writes outside of code before an empty code page is given up
+
+// operand forms of the alu/mov handlers
+enum {
+	T_FORM_RR,		// register,register
+	T_FORM_RI,		// register,immediate
+	T_FORM_MR,		// memory,register
+	T_FORM_RM,		// register,memory
+	T_FORM_MI,		// memory,immediate
+	T_FORMS
+};
+
+// instruction order of the alu group (0x00-0x3f, 0x80-0x83) followed by test and mov
+enum {
+	T_INST_ADD,T_INST_OR,T_INST_ADC,T_INST_SBB,T_INST_AND,T_INST_SUB,T_INST_XOR,T_INST_CMP,
+	T_INST_TEST,T_INST_MOV
+};
+
+#define THREADED_ALU_KINDS(INST)											\
+	T_##INST##_RR_B,T_##INST##_RR_W,T_##INST##_RR_D,						\
+	T_##INST##_RI_B,T_##INST##_RI_W,T_##INST##_RI_D,						\
+	T_##INST##_MR_B,T_##INST##_MR_W,T_##INST##_MR_D,						\
+	T_##INST##_RM_B,T_##INST##_RM_W,T_##INST##_RM_D,						\
+	T_##INST##_MI_B,T_##INST##_MI_W,T_##INST##_MI_D
+
+enum ThreadedKind {
+	THREADED_ALU_KINDS(ADD),THREADED_ALU_KINDS(OR),THREADED_ALU_KINDS(ADC),
+	THREADED_ALU_KINDS(SBB),THREADED_ALU_KINDS(AND),THREADED_ALU_KINDS(SUB),
+	THREADED_ALU_KINDS(XOR),THREADED_ALU_KINDS(CMP),THREADED_ALU_KINDS(TEST),
+	THREADED_ALU_KINDS(MOV),
+	T_INC_W,T_INC_D,T_DEC_W,T_DEC_D,
+	T_PUSH_W,T_PUSH_D,T_POP_W,T_POP_D,
+	T_LEA_W,T_LEA_D,T_NOP,
+	T_JO,T_JNO,T_JB,T_JNB,T_JZ,T_JNZ,T_JBE,T_JNBE,
+	T_JS,T_JNS,T_JP,T_JNP,T_JL,T_JNL,T_JLE,T_JNLE,
+	T_JMP,T_CALL_W,T_CALL_D,T_RET_W,T_RET_D,
+	T_END,			// end of the block, continue at the next instruction
+	T_FALLBACK,		// let the normal core execute the instruction
+	T_KINDS
+};
+
+struct ThreadedOp {
+	const void * handler;	// address of the handler code (computed goto)
+	Bit16u kind;
+	Bit16u ip_off;			// offset of the instruction from the start of the block
+	Bit8u len;				// length of the instruction in bytes
+	Bit8u ea_seg;			// segment of the memory operand
+	Bit8u ea_scale;
+	Bit32u mask;			// address size mask for memory operands, ip mask for branches
+	Bit32u * ea_base;
+	Bit32u * ea_index;
+	Bit32u ea_disp;
+	void * dst;				// register operands
+	void * src;
+	Bit32u imm;				// immediate value or branch displacement
+};
+
+class ThreadedCodePage;
+
+struct ThreadedBlock {
+	PhysPt lin;				// linear address of the first instruction
+	HostPt host;			// host address of the first instruction
+	Bit32u eip;
+	Bitu bytes;				// size of the guest code covered by the block
+	bool big;
+	bool valid;
+	ThreadedCodePage * page;	// code page handler watching the block, if any
+	ThreadedBlock * page_next;	// next block in the same code page
+	ThreadedOp ops[THREADED_BLOCK_OPS+1];
+};
+
+static struct {
+	ThreadedBlock blocks[THREADED_CACHE_BLOCKS];
+	ThreadedCodePage * used_pages;
+	ThreadedCodePage * free_pages;
+	Bitu pages;				// code page handlers allocated
+} threaded;
+
+// the ThreadedCodePage class intercepts the writes to a physical page of RAM
+// that holds blocks and invalidates the blocks whose code is written to
+class ThreadedCodePage : public PageHandler {
+public:
+	void SetupAt(Bitu _phys_page,PageHandler * _old_pagehandler) {
+		phys_page=_phys_page;
+		old_pagehandler=_old_pagehandler;
+		flags=(old_pagehandler->flags|PFLAG_HASCODE)&~PFLAG_WRITEABLE;
+		hostmem=old_pagehandler->GetHostReadPt(phys_page);
+		blocks=NULL;
+		release_count=THREADED_PAGE_RELEASE;
+		memset(code_map,0,sizeof(code_map));
+		MEM_SetPageHandler(phys_page,1,this);
+		// every linear page mapped to this one has to write through the handler
+		PAGING_ClearTLB();
+	}
+	void Release(void) {
+		MEM_SetPageHandler(phys_page,1,old_pagehandler);
+		PAGING_ClearTLB();
+		if (prev) prev->next=next;
+		else threaded.used_pages=next;
+		if (next) next->prev=prev;
+		next=threaded.free_pages;
+		prev=NULL;
+		threaded.free_pages=this;
+	}
+	void AddBlock(ThreadedBlock * block) {
+		block->page=this;
+		block->page_next=blocks;
+		blocks=block;
+		MarkCode(block);
+	}
+	void RemoveBlock(ThreadedBlock * block) {
+		for (ThreadedBlock * * link=&blocks;*link;link=&(*link)->page_next) {
+			if (*link==block) {
+				*link=block->page_next;
+				break;
+			}
+		}
+		block->page=NULL;
+		// the code map keeps the bytes of the block, that only costs a useless invalidation
+	}
+	bool HasBlocks(void) {
+		return blocks!=NULL;
+	}
+	void writeb(PhysPt addr,Bitu val) {
+		addr&=4095;
+		if (host_readb(hostmem+addr)==(Bit8u)val) return;
+		host_writeb(hostmem+addr,val);
+		Written(addr,1);
+	}
+	void writew(PhysPt addr,Bitu val) {
+		addr&=4095;
+		if (host_readw(hostmem+addr)==(Bit16u)val) return;
+		host_writew(hostmem+addr,val);
+		Written(addr,2);
+	}
+	void writed(PhysPt addr,Bitu val) {
+		addr&=4095;
+		if (host_readd(hostmem+addr)==(Bit32u)val) return;
+		host_writed(hostmem+addr,val);
+		Written(addr,4);
+	}
+	HostPt GetHostReadPt(Bitu phys_page) {
+		return old_pagehandler->GetHostReadPt(phys_page);
+	}
+	HostPt GetHostWritePt(Bitu phys_page) {
+		return GetHostReadPt(phys_page);
+	}
+public:
+	ThreadedCodePage * next, * prev;	// page linking
+private:
+	void MarkCode(ThreadedBlock * block) {
+		Bitu start=(Bitu)(block->host-hostmem);
+		for (Bitu i=start;i<start+block->bytes;i++) code_map[i>>3]|=1<<(i&7);
+	}
+	// invalidate the blocks that cover the written bytes
+	void Written(Bitu addr,Bitu len) {
+		bool code=false;
+		for (Bitu i=addr;i<addr+len;i++) code|=(code_map[i>>3]>>(i&7))&1;
+		if (!code) {
+			// give the page up after a while if it holds no blocks anymore
+			if (!blocks && !--release_count) Release();
+			return;
+		}
+		memset(code_map,0,sizeof(code_map));
+		for (ThreadedBlock * * link=&blocks;*link;) {
+			ThreadedBlock * block=*link;
+			Bitu start=(Bitu)(block->host-hostmem);
+			if ((addr<start+block->bytes) && (addr+len>start)) {
+				block->valid=false;
+				block->page=NULL;
+				*link=block->page_next;
+			} else {
+				MarkCode(block);
+				link=&block->page_next;
+			}
+		}
+	}
+
+	PageHandler * old_pagehandler;
+	HostPt hostmem;
+	Bitu phys_page;
+	ThreadedBlock * blocks;			// blocks with code in this page
+	Bitu release_count;
+	Bit8u code_map[4096/8];			// bytes of the page that are covered by blocks
+};
+
+// watch the code of a freshly translated block if it lies in RAM; rom is
+// only written through phys_writeb which no handler sees, blocks in other
+// writeable memory (video memory) are not found again by the lookup
+static void ThreadedWatchBlock(ThreadedBlock * block,PhysPt ip_point) {
+	if (!block->bytes) return;
+	PageHandler * handler=get_tlb_readhandler(ip_point);
+	if (!(handler->flags & PFLAG_HASCODE)) {
+		Bitu phys_page=PAGING_GetPhysicalPage(ip_point)>>12;
+		if (((handler->flags & (PFLAG_READABLE|PFLAG_WRITEABLE|PFLAG_NOCODE))!=(PFLAG_READABLE|PFLAG_WRITEABLE)) ||
+			(MEM_GetPageHandler(phys_page)!=handler)) {
+			if (handler->flags & PFLAG_WRITEABLE) block->host=NULL;
+			return;
+		}
+		if (!threaded.free_pages) {
+			if (threaded.pages<THREADED_CACHE_BLOCKS) {
+				threaded.free_pages=new ThreadedCodePage();
+				threaded.free_pages->next=NULL;
+				threaded.pages++;
+			} else {
+				// there are no more pages with blocks than other blocks,
+				// so at least one of the pages is empty
+				ThreadedCodePage * empty=threaded.used_pages;
+				while (empty->HasBlocks()) empty=empty->next;
+				empty->Release();
+			}
+		}
+		ThreadedCodePage * page=threaded.free_pages;
+		threaded.free_pages=page->next;
+		page->prev=NULL;
+		page->next=threaded.used_pages;
+		if (page->next) page->next->prev=page;
+		threaded.used_pages=page;
+		page->SetupAt(phys_page,handler);
+		handler=page;
+	}
+	((ThreadedCodePage *)handler)->AddBlock(block);
+}
+
+// register operand for absent base/index registers, always zero
+static Bit32u threaded_zero=0;
+
+static struct {
+	const Bit8u * code;
+	Bitu pos;
+	Bitu limit;
+	bool overrun;
+} tdecode;
+
+static INLINE Bit8u ThreadedFetchb(void) {
+	if (GCC_UNLIKELY(tdecode.pos>=tdecode.limit)) {
+		tdecode.overrun=true;
+		return 0;
+	}
+	return tdecode.code[tdecode.pos++];
+}
+
+static INLINE Bit16u ThreadedFetchw(void) {
+	Bit16u val=ThreadedFetchb();
+	return val|(ThreadedFetchb()<<8);
+}
+
+static INLINE Bit32u ThreadedFetchd(void) {
+	Bit32u val=ThreadedFetchw();
+	return val|(ThreadedFetchw()<<16);
+}
+
+static INLINE Bit32u * ThreadedRegd(Bitu reg) {
+	return lookupRMEAregd[0xc0+reg];
+}
+
+// register selected by the reg field of the modrm byte
+static void * ThreadedReg(Bitu size,Bit8u rm) {
+	switch (size) {
+	case 0:return lookupRMregb[rm];
+	case 1:return lookupRMregw[rm];
+	default:return lookupRMregd[rm];
+	}
+}
+
+// register selected by the rm field of the modrm byte (or by the opcode)
+static void * ThreadedEAReg(Bitu size,Bit8u rm) {
+	switch (size) {
+	case 0:return lookupRMEAregb[rm|0xc0];
+	case 1:return lookupRMEAregw[rm|0xc0];
+	default:return lookupRMEAregd[rm|0xc0];
+	}
+}
+
+static Bit32u ThreadedFetchImm(Bitu size) {
+	switch (size) {
+	case 0:return ThreadedFetchb();
+	case 1:return ThreadedFetchw();
+	default:return ThreadedFetchd();
+	}
+}
+
+static INLINE Bit16u ThreadedAluKind(Bitu inst,Bitu form,Bitu size) {
+	return (Bit16u)((inst*T_FORMS+form)*3+size);
+}
+
+// decode the memory operand described by a modrm byte with mod!=3
+static void ThreadedDecodeEA(ThreadedOp * op,Bit8u rm,bool big_addr,Bits seg) {
+	static const Bit8u base16[8]={3,3,5,5,6,7,5,3};		// bx,bx,bp,bp,si,di,bp,bx
+	static const Bit8u index16[8]={6,7,6,7,8,8,8,8};	// si,di,si,di,-,-,-,-
+	Bitu mod=rm>>6;
+	Bitu reg=rm&7;
+	SegNames def_seg=ds;
+	op->ea_base=&threaded_zero;
+	op->ea_index=&threaded_zero;
+	op->ea_scale=0;
+	op->ea_disp=0;
+	if (!big_addr) {
+		op->mask=0xffff;
+		if ((mod==0) && (reg==6)) op->ea_disp=ThreadedFetchw();
+		else {
+			op->ea_base=ThreadedRegd(base16[reg]);
+			if (index16[reg]<8) op->ea_index=ThreadedRegd(index16[reg]);
+			if ((reg==2) || (reg==3) || (reg==6)) def_seg=ss;
+		}
+		if (mod==1) op->ea_disp=(Bit32u)(Bit32s)(Bit8s)ThreadedFetchb();
+		else if (mod==2) op->ea_disp=ThreadedFetchw();
+	} else {
+		op->mask=0xffffffff;
+		if (reg==4) {
+			Bit8u sib=ThreadedFetchb();
+			Bitu base=sib&7;
+			Bitu index=(sib>>3)&7;
+			op->ea_scale=sib>>6;
+			if (index!=4) op->ea_index=ThreadedRegd(index);
+			if ((base==5) && (mod==0)) op->ea_disp=ThreadedFetchd();
+			else {
+				op->ea_base=ThreadedRegd(base);
+				if ((base==4) || (base==5)) def_seg=ss;
+			}
+		} else if ((reg==5) && (mod==0)) op->ea_disp=ThreadedFetchd();
+		else {
+			op->ea_base=ThreadedRegd(reg);
+			if (reg==5) def_seg=ss;
+		}
+		if (mod==1) op->ea_disp+=(Bit32u)(Bit32s)(Bit8s)ThreadedFetchb();
+		else if (mod==2) op->ea_disp+=ThreadedFetchd();
+	}
+	op->ea_seg=(Bit8u)((seg>=0) ? seg : def_seg);
+}
+
+// decode an alu/mov/test instruction with a modrm byte,
+// reg_dst is set if the register operand is the destination
+static void ThreadedDecodeRM(ThreadedOp * op,Bitu inst,Bitu size,bool reg_dst,bool big_addr,Bits seg) {
+	Bit8u rm=ThreadedFetchb();
+	void * reg=ThreadedReg(size,rm);
+	if (rm>=0xc0) {
+		void * ea=ThreadedEAReg(size,rm);
+		op->kind=ThreadedAluKind(inst,T_FORM_RR,size);
+		op->dst=reg_dst ? reg : ea;
+		op->src=reg_dst ? ea : reg;
+	} else {
+		ThreadedDecodeEA(op,rm,big_addr,seg);
+		op->kind=ThreadedAluKind(inst,reg_dst ? T_FORM_RM : T_FORM_MR,size);
+		op->dst=op->src=reg;
+	}
+}
+
+// decode an instruction with an immediate operand and a modrm byte
+static void ThreadedDecodeRMImm(ThreadedOp * op,Bit8u rm,Bitu inst,Bitu size,bool sign_byte,bool big_addr,Bits seg) {
+	if (rm>=0xc0) {
+		op->kind=ThreadedAluKind(inst,T_FORM_RI,size);
+		op->dst=ThreadedEAReg(size,rm);
+	} else {
+		ThreadedDecodeEA(op,rm,big_addr,seg);
+		op->kind=ThreadedAluKind(inst,T_FORM_MI,size);
+	}
+	if (sign_byte) op->imm=(Bit32u)(Bit32s)(Bit8s)ThreadedFetchb();
+	else op->imm=ThreadedFetchImm(size);
+}
+
+enum ThreadedDecodeResult {
+	TD_OK,			// the instruction continues the block
+	TD_BRANCH,		// the instruction ends the block
+	TD_UNHANDLED	// the instruction has to be run by the normal core
+};
+
+static ThreadedDecodeResult ThreadedDecodeOp(ThreadedOp * op,bool big) {
+	bool big_op=big;
+	bool big_addr=big;
+	Bits seg=-1;
+	Bit8u opcode;
+	for (;;) {
+		opcode=ThreadedFetchb();
+		switch (opcode) {
+		case 0x26:seg=es;continue;
+		case 0x2e:seg=cs;continue;
+		case 0x36:seg=ss;continue;
+		case 0x3e:seg=ds;continue;
+		case 0x64:seg=fs;continue;
+		case 0x65:seg=gs;continue;
+		case 0x66:big_op=!big_op;continue;
+		case 0x67:big_addr=!big_addr;continue;
+		}
+		if (tdecode.overrun) return TD_UNHANDLED;
+		break;
+	}
+	Bitu vsize=big_op ? 2 : 1;
+	op->mask=big_op ? 0xffffffff : 0xffff;
+	if ((opcode<0x40) && ((opcode&7)<6)) {
+		Bitu inst=opcode>>3;
+		switch (opcode&7) {
+		case 0:ThreadedDecodeRM(op,inst,0,false,big_addr,seg);break;		/* Eb,Gb */
+		case 1:ThreadedDecodeRM(op,inst,vsize,false,big_addr,seg);break;	/* Ev,Gv */
+		case 2:ThreadedDecodeRM(op,inst,0,true,big_addr,seg);break;			/* Gb,Eb */
+		case 3:ThreadedDecodeRM(op,inst,vsize,true,big_addr,seg);break;		/* Gv,Ev */
+		case 4:																/* AL,Ib */
+			op->kind=ThreadedAluKind(inst,T_FORM_RI,0);
+			op->dst=&reg_al;
+			op->imm=ThreadedFetchb();
+			break;
+		case 5:																/* eAX,Iv */
+			op->kind=ThreadedAluKind(inst,T_FORM_RI,vsize);
+			op->dst=ThreadedEAReg(vsize,0);
+			op->imm=ThreadedFetchImm(vsize);
+			break;
+		}
+		return TD_OK;
+	}
+	switch (opcode) {
+	case 0x0f:
+		opcode=ThreadedFetchb();
+		if ((opcode<0x80) || (opcode>0x8f)) return TD_UNHANDLED;
+		op->kind=(Bit16u)(T_JO+(opcode&0xf));								/* Jcc Jv */
+		op->imm=big_op ? ThreadedFetchd() : (Bit32u)(Bit32s)(Bit16s)ThreadedFetchw();
+		return TD_BRANCH;
+	case 0x40:case 0x41:case 0x42:case 0x43:case 0x44:case 0x45:case 0x46:case 0x47:
+		op->kind=big_op ? T_INC_D : T_INC_W;								/* INC reg */
+		op->dst=ThreadedEAReg(vsize,opcode&7);
+		return TD_OK;
+	case 0x48:case 0x49:case 0x4a:case 0x4b:case 0x4c:case 0x4d:case 0x4e:case 0x4f:
+		op->kind=big_op ? T_DEC_D : T_DEC_W;								/* DEC reg */
+		op->dst=ThreadedEAReg(vsize,opcode&7);
+		return TD_OK;
+	case 0x50:case 0x51:case 0x52:case 0x53:case 0x54:case 0x55:case 0x56:case 0x57:
+		op->kind=big_op ? T_PUSH_D : T_PUSH_W;								/* PUSH reg */
+		op->src=ThreadedEAReg(vsize,opcode&7);
+		return TD_OK;
+	case 0x58:case 0x59:case 0x5a:case 0x5b:case 0x5c:case 0x5d:case 0x5e:case 0x5f:
+		op->kind=big_op ? T_POP_D : T_POP_W;								/* POP reg */
+		op->dst=ThreadedEAReg(vsize,opcode&7);
+		return TD_OK;
+	case 0x70:case 0x71:case 0x72:case 0x73:case 0x74:case 0x75:case 0x76:case 0x77:
+	case 0x78:case 0x79:case 0x7a:case 0x7b:case 0x7c:case 0x7d:case 0x7e:case 0x7f:
+		op->kind=(Bit16u)(T_JO+(opcode&0xf));								/* Jcc Jb */
+		op->imm=(Bit32u)(Bit32s)(Bit8s)ThreadedFetchb();
+		return TD_BRANCH;
+	case 0x80:case 0x82:													/* Grpl Eb,Ib */
+	case 0x81:																/* Grpl Ev,Iv */
+	case 0x83:																/* Grpl Ev,Ix */
+		{
+			Bit8u rm=ThreadedFetchb();
+			Bitu size=(opcode&1) ? vsize : 0;
+			ThreadedDecodeRMImm(op,rm,(rm>>3)&7,size,opcode==0x83,big_addr,seg);
+			return TD_OK;
+		}
+	case 0x84:ThreadedDecodeRM(op,T_INST_TEST,0,false,big_addr,seg);return TD_OK;	/* TEST Eb,Gb */
+	case 0x85:ThreadedDecodeRM(op,T_INST_TEST,vsize,false,big_addr,seg);return TD_OK;	/* TEST Ev,Gv */
+	case 0x88:																/* MOV Eb,Gb */
+		// the normal core checks for writes through code segments here
+		if (!big && (tdecode.pos<tdecode.limit) && (tdecode.code[tdecode.pos]==0x05)) return TD_UNHANDLED;
+		ThreadedDecodeRM(op,T_INST_MOV,0,false,big_addr,seg);
+		return TD_OK;
+	case 0x89:ThreadedDecodeRM(op,T_INST_MOV,vsize,false,big_addr,seg);return TD_OK;	/* MOV Ev,Gv */
+	case 0x8a:ThreadedDecodeRM(op,T_INST_MOV,0,true,big_addr,seg);return TD_OK;		/* MOV Gb,Eb */
+	case 0x8b:ThreadedDecodeRM(op,T_INST_MOV,vsize,true,big_addr,seg);return TD_OK;	/* MOV Gv,Ev */
+	case 0x8d:																/* LEA Gv */
+		{
+			Bit8u rm=ThreadedFetchb();
+			if (rm>=0xc0) return TD_UNHANDLED;
+			ThreadedDecodeEA(op,rm,big_addr,seg);
+			op->kind=big_op ? T_LEA_D : T_LEA_W;
+			op->dst=ThreadedReg(vsize,rm);
+			return TD_OK;
+		}
+	case 0x90:																/* NOP */
+		op->kind=T_NOP;
+		return TD_OK;
+	case 0xa0:case 0xa1:case 0xa2:case 0xa3:								/* MOV AL/eAX,Ov and back */
+		{
+			Bitu size=(opcode&1) ? vsize : 0;
+			op->ea_base=&threaded_zero;
+			op->ea_index=&threaded_zero;
+			op->ea_scale=0;
+			op->ea_disp=big_addr ? ThreadedFetchd() : ThreadedFetchw();
+			op->mask=big_addr ? 0xffffffff : 0xffff;
+			op->ea_seg=(Bit8u)((seg>=0) ? seg : ds);
+			op->kind=ThreadedAluKind(T_INST_MOV,(opcode&2) ? T_FORM_MR : T_FORM_RM,size);
+			op->dst=op->src=ThreadedEAReg(size,0);
+			return TD_OK;
+		}
+	case 0xa8:																/* TEST AL,Ib */
+		op->kind=ThreadedAluKind(T_INST_TEST,T_FORM_RI,0);
+		op->dst=&reg_al;
+		op->imm=ThreadedFetchb();
+		return TD_OK;
+	case 0xa9:																/* TEST eAX,Iv */
+		op->kind=ThreadedAluKind(T_INST_TEST,T_FORM_RI,vsize);
+		op->dst=ThreadedEAReg(vsize,0);
+		op->imm=ThreadedFetchImm(vsize);
+		return TD_OK;
+	case 0xb0:case 0xb1:case 0xb2:case 0xb3:case 0xb4:case 0xb5:case 0xb6:case 0xb7:
+		op->kind=ThreadedAluKind(T_INST_MOV,T_FORM_RI,0);					/* MOV reg8,Ib */
+		op->dst=ThreadedEAReg(0,opcode&7);
+		op->imm=ThreadedFetchb();
+		return TD_OK;
+	case 0xb8:case 0xb9:case 0xba:case 0xbb:case 0xbc:case 0xbd:case 0xbe:case 0xbf:
+		op->kind=ThreadedAluKind(T_INST_MOV,T_FORM_RI,vsize);				/* MOV reg,Iv */
+		op->dst=ThreadedEAReg(vsize,opcode&7);
+		op->imm=ThreadedFetchImm(vsize);
+		return TD_OK;
+	case 0xc3:																/* RETN */
+		op->kind=big_op ? T_RET_D : T_RET_W;
+		return TD_BRANCH;
+	case 0xc6:case 0xc7:													/* MOV Ev,Iv */
+		{
+			Bit8u rm=ThreadedFetchb();
+			if (rm&0x38) return TD_UNHANDLED;
+			ThreadedDecodeRMImm(op,rm,T_INST_MOV,(opcode&1) ? vsize : 0,false,big_addr,seg);
+			return TD_OK;
+		}
+	case 0xe8:																/* CALL Jv */
+		op->kind=big_op ? T_CALL_D : T_CALL_W;
+		op->imm=big_op ? ThreadedFetchd() : (Bit32u)(Bit32s)(Bit16s)ThreadedFetchw();
+		return TD_BRANCH;
+	case 0xe9:																/* JMP Jv */
+		op->kind=T_JMP;
+		op->imm=big_op ? ThreadedFetchd() : (Bit32u)(Bit32s)(Bit16s)ThreadedFetchw();
+		return TD_BRANCH;
+	case 0xeb:																/* JMP Jb */
+		op->kind=T_JMP;
+		op->imm=(Bit32u)(Bit32s)(Bit8s)ThreadedFetchb();
+		return TD_BRANCH;
+	case 0xf6:case 0xf7:													/* TEST Ev,Iv */
+		{
+			Bit8u rm=ThreadedFetchb();
+			if (rm&0x30) return TD_UNHANDLED;
+			ThreadedDecodeRMImm(op,rm,T_INST_TEST,(opcode&1) ? vsize : 0,false,big_addr,seg);
+			return TD_OK;
+		}
+	}
+	return TD_UNHANDLED;
+}
+
+// decode the instructions starting at the linear address ip_point into a block,
+// returns the number of operations
+static Bitu ThreadedTranslate(ThreadedBlock * block,HostPt code,PhysPt ip_point,bool big) {
+	tdecode.code=code;
+	tdecode.pos=0;
+	tdecode.limit=4096-(ip_point&4095);
+	if (tdecode.limit>THREADED_BLOCK_BYTES) tdecode.limit=THREADED_BLOCK_BYTES;
+	// keep the instruction pointer from wrapping inside the block
+	if (!big) {
+		if (reg_eip>0xffff) tdecode.limit=0;
+		else if (tdecode.limit>0x10000-reg_eip) tdecode.limit=0x10000-reg_eip;
+	}
+	tdecode.overrun=false;
+
+	Bitu count=0;
+	for (;;) {
+		ThreadedOp * op=&block->ops[count];
+		Bitu start=tdecode.pos;
+		if (count>=THREADED_BLOCK_OPS) {
+			op->kind=T_END;
+		} else {
+			ThreadedDecodeResult res=ThreadedDecodeOp(op,big);
+			if (tdecode.overrun) {
+				// the instruction exceeds the block, end it before the instruction
+				// unless it is the first one
+				res=TD_UNHANDLED;
+				op->kind=start ? T_END : T_FALLBACK;
+			} else if (res==TD_UNHANDLED) op->kind=T_FALLBACK;
+			if (res!=TD_UNHANDLED) {
+				op->ip_off=(Bit16u)start;
+				op->len=(Bit8u)(tdecode.pos-start);
+				count++;
+				if (res==TD_BRANCH) break;
+				continue;
+			}
+		}
+		tdecode.pos=start;
+		op->ip_off=(Bit16u)start;
+		op->len=0;
+		count++;
+		break;
+	}
+
+	block->lin=ip_point;
+	block->host=code;
+	block->eip=reg_eip;
+	block->big=big;
+	block->bytes=tdecode.pos;
+	block->valid=true;
+	ThreadedWatchBlock(block,ip_point);
+	return count;
+}
+
+// check if the block was made for the current position, writes to its code
+// have invalidated it and a different mapping of the linear page shows up
+// as a different host address
+static INLINE bool ThreadedBlockValid(ThreadedBlock * block,PhysPt ip_point,HostPt code) {
+	return block->valid && (block->host==code) && (block->lin==ip_point) &&
+		(block->eip==reg_eip) && (block->big==cpu.code.big);
+}
+
+#if THREADED_GOTO
+#define OP(KIND) op_##KIND:
+#define THREADED_DISPATCH													\
+	if (GCC_UNLIKELY(CPU_Cycles<=0)) goto cycles_done;						\
+	CPU_Cycles--;															\
+	goto *op->handler;
+#define THREADED_NEXT { op++; THREADED_DISPATCH }
+#else
+#define OP(KIND) case T_##KIND:
+#define THREADED_NEXT { op++; goto dispatch; }
+#endif
+
+// memory operand of the current instruction, the instruction pointer has
+// to be correct in case the access causes a pagefault
+#define THREADED_OFFSET ((*op->ea_base+(*op->ea_index<<op->ea_scale)+op->ea_disp)&op->mask)
+#define THREADED_EA															\
+	reg_eip=start_eip+op->ip_off;											\
+	PhysPt eaa=SegPhys((SegNames)op->ea_seg)+THREADED_OFFSET;
+
+// end the block if the instruction has written to the code of the block
+#define THREADED_SMC														\
+	if (GCC_UNLIKELY(!block->valid)) {										\
+		reg_eip=start_eip+op->ip_off+op->len;								\
+		continue;															\
+	}
+
+// loops in the block are run again without looking the block up
+#define THREADED_BRANCH														\
+	if ((reg_eip==start_eip) && GCC_LIKELY(block->valid)) goto run_block;	\
+	continue;
+
+#define THREADED_JCC(COND)													\
+	{																		\
+		Bit32u next=start_eip+op->ip_off+op->len;							\
+		if (COND) reg_eip=(next & ~op->mask) | ((next+op->imm) & op->mask);	\
+		else reg_eip=next;													\
+		THREADED_BRANCH;													\
+	}
+
+#define THREADED_ALU_SIZE(INST,S,T,LR,SR,LM,SM)								\
+	OP(INST##_RR_##S) {														\
+		INST##S(*(T*)op->dst,*(T*)op->src,LR,SR);							\
+		THREADED_NEXT;														\
+	}																		\
+	OP(INST##_RI_##S) {														\
+		INST##S(*(T*)op->dst,(T)op->imm,LR,SR);								\
+		THREADED_NEXT;														\
+	}																		\
+	OP(INST##_MR_##S) {														\
+		THREADED_EA;														\
+		INST##S(eaa,*(T*)op->src,LM,SM);									\
+		THREADED_SMC;														\
+		THREADED_NEXT;														\
+	}																		\
+	OP(INST##_RM_##S) {														\
+		THREADED_EA;														\
+		INST##S(*(T*)op->dst,LM(eaa),LR,SR);								\
+		THREADED_NEXT;														\
+	}																		\
+	OP(INST##_MI_##S) {														\
+		THREADED_EA;														\
+		INST##S(eaa,(T)op->imm,LM,SM);										\
+		THREADED_SMC;														\
+		THREADED_NEXT;														\
+	}
+
+#define THREADED_ALU(INST)													\
+	THREADED_ALU_SIZE(INST,B,Bit8u,LoadRb,SaveRb,LoadMb,SaveMb)				\
+	THREADED_ALU_SIZE(INST,W,Bit16u,LoadRw,SaveRw,LoadMw,SaveMw)			\
+	THREADED_ALU_SIZE(INST,D,Bit32u,LoadRd,SaveRd,LoadMd,SaveMd)
+
+#define THREADED_ALU_LABELS(INST)											\
+	&&op_##INST##_RR_B,&&op_##INST##_RR_W,&&op_##INST##_RR_D,				\
+	&&op_##INST##_RI_B,&&op_##INST##_RI_W,&&op_##INST##_RI_D,				\
+	&&op_##INST##_MR_B,&&op_##INST##_MR_W,&&op_##INST##_MR_D,				\
+	&&op_##INST##_RM_B,&&op_##INST##_RM_W,&&op_##INST##_RM_D,				\
+	&&op_##INST##_MI_B,&&op_##INST##_MI_W,&&op_##INST##_MI_D
+
+Bits CPU_Core_Threaded_Trap_Run(void);
+
+Bits CPU_Core_Threaded_Run(void) {
+#if THREADED_GOTO
+	// handler addresses in the order of ThreadedKind
+	static const void * const handlers[T_KINDS]={
+		THREADED_ALU_LABELS(ADD),THREADED_ALU_LABELS(OR),THREADED_ALU_LABELS(ADC),
+		THREADED_ALU_LABELS(SBB),THREADED_ALU_LABELS(AND),THREADED_ALU_LABELS(SUB),
+		THREADED_ALU_LABELS(XOR),THREADED_ALU_LABELS(CMP),THREADED_ALU_LABELS(TEST),
+		THREADED_ALU_LABELS(MOV),
+		&&op_INC_W,&&op_INC_D,&&op_DEC_W,&&op_DEC_D,
+		&&op_PUSH_W,&&op_PUSH_D,&&op_POP_W,&&op_POP_D,
+		&&op_LEA_W,&&op_LEA_D,&&op_NOP,
+		&&op_JO,&&op_JNO,&&op_JB,&&op_JNB,&&op_JZ,&&op_JNZ,&&op_JBE,&&op_JNBE,
+		&&op_JS,&&op_JNS,&&op_JP,&&op_JNP,&&op_JL,&&op_JNL,&&op_JLE,&&op_JNLE,
+		&&op_JMP,&&op_CALL_W,&&op_CALL_D,&&op_RET_W,&&op_RET_D,
+		&&op_END,&&op_FALLBACK
+	};
+#endif
+	ThreadedBlock * block;
+	const ThreadedOp * op;
+	Bit32u start_eip;
+	for (;;) {
+		if (GCC_UNLIKELY(CPU_Cycles<=0)) break;
+#if C_HEAVY_DEBUG
+		if (DEBUG_HeavyIsBreakpoint()) return debugCallback;
+#endif
+		PhysPt ip_point=SegPhys(cs)+reg_eip;
+		// blocks are only built from memory that is directly readable
+		HostPt code=get_tlb_read(ip_point);
+		if (GCC_UNLIKELY(!code)) goto fallback;
+		code+=ip_point;
+
+		block=&threaded.blocks[(ip_point^(ip_point>>9))&(THREADED_CACHE_BLOCKS-1)];
+		if (GCC_UNLIKELY(!ThreadedBlockValid(block,ip_point,code))) {
+			if (block->page) block->page->RemoveBlock(block);
+#if THREADED_GOTO
+			Bitu count=ThreadedTranslate(block,code,ip_point,cpu.code.big);
+			for (Bitu i=0;i<count;i++) block->ops[i].handler=handlers[block->ops[i].kind];
+#else
+			ThreadedTranslate(block,code,ip_point,cpu.code.big);
+#endif
+		}
+		start_eip=reg_eip;
+run_block:
+		op=block->ops;
+#if THREADED_GOTO
+		THREADED_DISPATCH;
+#else
+dispatch:
+		if (GCC_UNLIKELY(CPU_Cycles<=0)) goto cycles_done;
+		CPU_Cycles--;
+		switch (op->kind) {
+#endif
+		THREADED_ALU(ADD)
+		THREADED_ALU(OR)
+		THREADED_ALU(ADC)
+		THREADED_ALU(SBB)
+		THREADED_ALU(AND)
+		THREADED_ALU(SUB)
+		THREADED_ALU(XOR)
+		THREADED_ALU(CMP)
+		THREADED_ALU(TEST)
+		THREADED_ALU(MOV)
+
+		OP(INC_W) { INCW(*(Bit16u*)op->dst,LoadRw,SaveRw); THREADED_NEXT; }
+		OP(INC_D) { INCD(*(Bit32u*)op->dst,LoadRd,SaveRd); THREADED_NEXT; }
+		OP(DEC_W) { DECW(*(Bit16u*)op->dst,LoadRw,SaveRw); THREADED_NEXT; }
+		OP(DEC_D) { DECD(*(Bit32u*)op->dst,LoadRd,SaveRd); THREADED_NEXT; }
+		OP(PUSH_W) {
+			reg_eip=start_eip+op->ip_off;
+			Push_16(*(Bit16u*)op->src);
+			THREADED_SMC;
+			THREADED_NEXT;
+		}
+		OP(PUSH_D) {
+			reg_eip=start_eip+op->ip_off;
+			Push_32(*(Bit32u*)op->src);
+			THREADED_SMC;
+			THREADED_NEXT;
+		}
+		OP(POP_W) {
+			reg_eip=start_eip+op->ip_off;
+			*(Bit16u*)op->dst=Pop_16();
+			THREADED_NEXT;
+		}
+		OP(POP_D) {
+			reg_eip=start_eip+op->ip_off;
+			*(Bit32u*)op->dst=Pop_32();
+			THREADED_NEXT;
+		}
+		OP(LEA_W) { *(Bit16u*)op->dst=(Bit16u)THREADED_OFFSET; THREADED_NEXT; }
+		OP(LEA_D) { *(Bit32u*)op->dst=THREADED_OFFSET; THREADED_NEXT; }
+		OP(NOP) THREADED_NEXT;
+
+		OP(JO) THREADED_JCC(TFLG_O);
+		OP(JNO) THREADED_JCC(TFLG_NO);
+		OP(JB) THREADED_JCC(TFLG_B);
+		OP(JNB) THREADED_JCC(TFLG_NB);
+		OP(JZ) THREADED_JCC(TFLG_Z);
+		OP(JNZ) THREADED_JCC(TFLG_NZ);
+		OP(JBE) THREADED_JCC(TFLG_BE);
+		OP(JNBE) THREADED_JCC(TFLG_NBE);
+		OP(JS) THREADED_JCC(TFLG_S);
+		OP(JNS) THREADED_JCC(TFLG_NS);
+		OP(JP) THREADED_JCC(TFLG_P);
+		OP(JNP) THREADED_JCC(TFLG_NP);
+		OP(JL) THREADED_JCC(TFLG_L);
+		OP(JNL) THREADED_JCC(TFLG_NL);
+		OP(JLE) THREADED_JCC(TFLG_LE);
+		OP(JNLE) THREADED_JCC(TFLG_NLE);
+		OP(JMP) {
+			reg_eip=(start_eip+op->ip_off+op->len+op->imm)&op->mask;
+			THREADED_BRANCH;
+		}
+		OP(CALL_W) {
+			reg_eip=start_eip+op->ip_off+op->len;
+			Push_16((Bit16u)reg_eip);
+			reg_eip=(Bit16u)(reg_eip+op->imm);
+			THREADED_BRANCH;
+		}
+		OP(CALL_D) {
+			reg_eip=start_eip+op->ip_off+op->len;
+			Push_32(reg_eip);
+			reg_eip+=op->imm;
+			THREADED_BRANCH;
+		}
+		OP(RET_W) {
+			reg_eip=start_eip+op->ip_off;
+			reg_eip=Pop_16();
+			continue;
+		}
+		OP(RET_D) {
+			reg_eip=start_eip+op->ip_off;
+			reg_eip=Pop_32();
+			continue;
+		}
+		OP(END) {
+			// not an instruction, give back the cycle
+			CPU_Cycles++;
+			reg_eip=start_eip+op->ip_off;
+			continue;
+		}
+		OP(FALLBACK) {
+			CPU_Cycles++;
+			reg_eip=start_eip+op->ip_off;
+			goto fallback;
+		}
+#if !THREADED_GOTO
+		default:
+			E_Exit("Invalid threaded operation %d",op->kind);
+		}
+#endif
+
+fallback:
+		{
+			// let the normal core execute a single instruction, the remaining
+			// cycles are parked in case the instruction leaves the core
+			Bits old_cycles=CPU_Cycles;
+			CPU_CycleLeft+=old_cycles-1;
+			CPU_Cycles=1;
+			Bits nc_retcode=CPU_Core_Normal_Run();
+			if (cpudecoder==&CPU_Core_Normal_Trap_Run) cpudecoder=&CPU_Core_Threaded_Trap_Run;
+			// the normal core runs out of cycles after an ordinary instruction,
+			// otherwise it wants the pic or a different decoder to take over
+			if (GCC_LIKELY(!nc_retcode) && (CPU_Cycles<0) && (cpudecoder==&CPU_Core_Threaded_Run)) {
+				CPU_CycleLeft-=old_cycles-1;
+				CPU_Cycles+=old_cycles;
+				continue;
+			}
+			return nc_retcode;
+		}
+
+cycles_done:
+		reg_eip=start_eip+op->ip_off;
+		break;
+	}
+	FillFlags();
+	return CBRET_NONE;
+}
+
+Bits CPU_Core_Threaded_Trap_Run(void) {
+	Bits oldCycles = CPU_Cycles;
+	CPU_Cycles = 1;
+	cpu.trap_skip = false;
+
+	// let the normal core execute the next (only one!) instruction
+	Bits ret=CPU_Core_Normal_Run();
+
+	// trap to int1 unless the last instruction deferred this
+	if (!cpu.trap_skip) CPU_HW_Interrupt(1);
+
+	CPU_Cycles = oldCycles-1;
+	cpudecoder = &CPU_Core_Threaded_Run;
+
+	return ret;
+}
+
+void CPU_Core_Threaded_Init(void) {
+	for (Bitu i=0;i<THREADED_CACHE_BLOCKS;i++) {
+		threaded.blocks[i].valid=false;
+		threaded.blocks[i].page=NULL;
+	}
+}
+
+// give the written pages back when another core takes over, the dynamic
+// core takes every page flagged with PFLAG_HASCODE for one of its own
+void CPU_Core_Threaded_Cache_Init(bool enable_cache) {
+	if (enable_cache) return;
+	for (Bitu i=0;i<THREADED_CACHE_BLOCKS;i++) {
+		ThreadedBlock * block=&threaded.blocks[i];
+		if (block->page) block->page->RemoveBlock(block);
+		block->valid=false;
+	}
+	while (threaded.used_pages) threaded.used_pages->Release();
+}
+
+void CPU_Core_Threaded_Cache_Close(void) {
+	CPU_Core_Threaded_Cache_Init(false);
+	while (threaded.free_pages) {
+		ThreadedCodePage * page=threaded.free_pages->next;
+		delete threaded.free_pages;
+		threaded.free_pages=page;
+	}
+	threaded.pages=0;
+}
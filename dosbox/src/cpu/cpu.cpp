@@ -71,6 +71,9 @@ Bitu CPU_PrefetchQueueSize=0;
 void CPU_Core_Full_Init(void);
 void CPU_Core_Normal_Init(void);
 void CPU_Core_Simple_Init(void);
+void CPU_Core_Threaded_Init(void);
+void CPU_Core_Threaded_Cache_Init(bool enable_cache);
+void CPU_Core_Threaded_Cache_Close(void);
 #if (C_DYNAMIC_X86)
 void CPU_Core_Dyn_X86_Init(void);
 void CPU_Core_Dyn_X86_Cache_Init(bool enable_cache);
@@ -79,6 +82,10 @@ void CPU_Core_Dyn_X86_SetFPUMode(bool dh_fpu);
 #elif (C_DYNREC)
 void CPU_Core_Dynrec_Init(void);
 void CPU_Core_Dynrec_Cache_Init(bool enable_cache);
+void CPU_Core_Dynrec_Cache_SetSize(Bitu size_kb);
+void CPU_Core_Dynrec_SetNativeFPU(bool native);
+void CPU_Core_Dynrec_SetProfiling(bool enable);
+void CPU_Core_Dynrec_SetTiered(bool tiered);
 void CPU_Core_Dynrec_Cache_Close(void);
 #endif
 
@@ -342,6 +349,7 @@ enum TSwitchType {
 };
 
 bool CPU_SwitchTask(Bitu new_tss_selector,TSwitchType tstype,Bitu old_eip) {
+	PAGING_FaultScope fault_scope(false);
 	FillFlags();
 	TaskStateSegment new_tss;
 	if (!new_tss.SetSelector(new_tss_selector)) 
@@ -544,6 +552,7 @@ void CPU_Exception(Bitu which,Bitu error ) {
 
 Bit8u lastint;
 void CPU_Interrupt(Bitu num,Bitu type,Bitu oldeip) {
+	PAGING_FaultScope fault_scope(false);
 	lastint=num;
 	FillFlags();
 #if C_DEBUG
@@ -760,6 +769,7 @@ do_interrupt:
 
 
 void CPU_IRET(bool use32,Bitu oldeip) {
+	PAGING_FaultScope fault_scope(false);
 	if (!cpu.pmode) {					/* RealMode IRET */
 		if (use32) {
 			reg_eip=CPU_Pop32();
@@ -996,6 +1006,7 @@ void CPU_IRET(bool use32,Bitu oldeip) {
 
 
 void CPU_JMP(bool use32,Bitu selector,Bitu offset,Bitu oldeip) {
+	PAGING_FaultScope fault_scope(false);
 	if (!cpu.pmode || (reg_flags & FLAG_VM)) {
 		if (!use32) {
 			reg_eip=offset&0xffff;
@@ -1063,6 +1074,7 @@ CODE_jmp:
 
 
 void CPU_CALL(bool use32,Bitu selector,Bitu offset,Bitu oldeip) {
+	PAGING_FaultScope fault_scope(false);
 	if (!cpu.pmode || (reg_flags & FLAG_VM)) {
 		if (!use32) {
 			CPU_Push16(SegValue(cs));
@@ -1299,6 +1311,7 @@ call_code:
 
 
 void CPU_RET(bool use32,Bitu bytes,Bitu oldeip) {
+	PAGING_FaultScope fault_scope(false);
 	if (!cpu.pmode || (reg_flags & FLAG_VM)) {
 		Bitu new_ip,new_cs;
 		if (!use32) {
@@ -2066,6 +2079,7 @@ void CPU_HLT(Bitu oldeip) {
 }
 
 void CPU_ENTER(bool use32,Bitu bytes,Bitu level) {
+	PAGING_FaultScope fault_scope(false);
 	level&=0x1f;
 	Bitu sp_index=reg_esp&cpu.stack.mask;
 	Bitu bp_index=reg_ebp&cpu.stack.mask;
@@ -2221,6 +2235,7 @@ public:
 		/* Init the cpu cores */
 		CPU_Core_Normal_Init();
 		CPU_Core_Simple_Init();
+		CPU_Core_Threaded_Init();
 		CPU_Core_Full_Init();
 #if (C_DYNAMIC_X86)
 		CPU_Core_Dyn_X86_Init();
@@ -2325,6 +2340,8 @@ public:
 			cpudecoder=&CPU_Core_Simple_Run;
 		} else if (core == "full") {
 			cpudecoder=&CPU_Core_Full_Run;
+		} else if (core == "threaded") {
+			cpudecoder=&CPU_Core_Threaded_Run;
 		} else if (core == "auto") {
 			cpudecoder=&CPU_Core_Normal_Run;
 #if (C_DYNAMIC_X86)
@@ -2341,15 +2358,22 @@ public:
 		}
 		else if (core == "dynamic") {
 			cpudecoder=&CPU_Core_Dynrec_Run;
+		} else if (core == "tiered") {
+			cpudecoder=&CPU_Core_Dynrec_Run;
 #else
 
 #endif
 		}
 
+		CPU_Core_Threaded_Cache_Init(core == "threaded");
 #if (C_DYNAMIC_X86)
 		CPU_Core_Dyn_X86_Cache_Init((core == "dynamic") || (core == "dynamic_nodhfpu"));
 #elif (C_DYNREC)
-		CPU_Core_Dynrec_Cache_Init( core == "dynamic" );
+		CPU_Core_Dynrec_Cache_SetSize(section->Get_int("dynamic_cachesize"));
+		CPU_Core_Dynrec_SetNativeFPU(section->Get_bool("dynamic_fpu"));
+		CPU_Core_Dynrec_SetProfiling(section->Get_bool("dynamic_blockprofile"));
+		CPU_Core_Dynrec_SetTiered(core == "tiered");
+		CPU_Core_Dynrec_Cache_Init( (core == "dynamic") || (core == "tiered") );
 #endif
 
 		CPU_ArchitectureType = CPU_ARCHTYPE_MIXED;
@@ -2408,6 +2432,7 @@ public:
 static CPU * test;
 
 void CPU_ShutDown(Section* sec) {
+	CPU_Core_Threaded_Cache_Close();
 #if (C_DYNAMIC_X86)
 	CPU_Core_Dyn_X86_Cache_Close();
 #elif (C_DYNREC)
@@ -460,6 +460,104 @@ Bit32u get_PF(void) {
 	return 0;
 }
 
+/*
+	Conditions of jcc/setcc/cmovcc. The common flag changing instructions
+	get routines that evaluate each condition straight from the operands,
+	the others combine the get_* functions above.
+*/
+#define LAZY_CONDITIONS(NAME,O,B,Z,BE,S,P,L,LE)									\
+	static bool NAME##_o(void) { return (O); }									\
+	static bool NAME##_no(void) { return !(O); }								\
+	static bool NAME##_b(void) { return (B); }									\
+	static bool NAME##_nb(void) { return !(B); }								\
+	static bool NAME##_z(void) { return (Z); }									\
+	static bool NAME##_nz(void) { return !(Z); }								\
+	static bool NAME##_be(void) { return (BE); }								\
+	static bool NAME##_nbe(void) { return !(BE); }								\
+	static bool NAME##_s(void) { return (S); }									\
+	static bool NAME##_ns(void) { return !(S); }								\
+	static bool NAME##_p(void) { return (P); }									\
+	static bool NAME##_np(void) { return !(P); }								\
+	static bool NAME##_l(void) { return (L); }									\
+	static bool NAME##_nl(void) { return !(L); }								\
+	static bool NAME##_le(void) { return (LE); }								\
+	static bool NAME##_nle(void) { return !(LE); }								\
+	static const LazyCondition NAME[16]={										\
+		NAME##_o,NAME##_no,NAME##_b,NAME##_nb,NAME##_z,NAME##_nz,NAME##_be,NAME##_nbe,	\
+		NAME##_s,NAME##_ns,NAME##_p,NAME##_np,NAME##_l,NAME##_nl,NAME##_le,NAME##_nle	\
+	};
+
+LAZY_CONDITIONS(cond_generic,get_OF()!=0,get_CF()!=0,get_ZF()!=0,get_CF() || get_ZF(),get_SF()!=0,
+	get_PF()!=0,(get_SF()!=0) != (get_OF()!=0),get_ZF() || ((get_SF()!=0) != (get_OF()!=0)))
+
+LAZY_CONDITIONS(cond_flags,GETFLAG(OF)!=0,GETFLAG(CF)!=0,GETFLAG(ZF)!=0,GETFLAG(CF) || GETFLAG(ZF),
+	GETFLAG(SF)!=0,GETFLAG(PF)!=0,(GETFLAG(SF)!=0) != (GETFLAG(OF)!=0),
+	GETFLAG(ZF) || ((GETFLAG(SF)!=0) != (GETFLAG(OF)!=0)))
+
+#define LAZY_SUB_CONDITIONS(NAME,VAR1,VAR2,RES,SIGN,STYPE)						\
+	LAZY_CONDITIONS(NAME,((VAR1 ^ VAR2) & (VAR1 ^ RES) & SIGN)!=0,VAR1<VAR2,RES==0,VAR1<=VAR2,	\
+		(RES & SIGN)!=0,parity_lookup[lf_resb]!=0,(STYPE)VAR1<(STYPE)VAR2,(STYPE)VAR1<=(STYPE)VAR2)
+
+#define LAZY_ADD_CONDITIONS(NAME,VAR1,VAR2,RES,SIGN)								\
+	LAZY_CONDITIONS(NAME,((VAR1 ^ VAR2 ^ SIGN) & (RES ^ VAR2) & SIGN)!=0,RES<VAR1,RES==0,		\
+		(RES<VAR1) || (RES==0),(RES & SIGN)!=0,parity_lookup[lf_resb]!=0,						\
+		((RES & SIGN)!=0) != (((VAR1 ^ VAR2 ^ SIGN) & (RES ^ VAR2) & SIGN)!=0),				\
+		(RES==0) || (((RES & SIGN)!=0) != (((VAR1 ^ VAR2 ^ SIGN) & (RES ^ VAR2) & SIGN)!=0)))
+
+// and/or/xor/test clear CF and OF
+#define LAZY_LOGIC_CONDITIONS(NAME,RES,SIGN)										\
+	LAZY_CONDITIONS(NAME,false,false,RES==0,RES==0,(RES & SIGN)!=0,parity_lookup[lf_resb]!=0,	\
+		(RES & SIGN)!=0,(RES==0) || ((RES & SIGN)!=0))
+
+// inc/dec leave CF alone, OF is set when the result crosses the sign boundary
+#define LAZY_INCDEC_CONDITIONS(NAME,RES,SIGN,OFRES)								\
+	LAZY_CONDITIONS(NAME,RES==OFRES,GETFLAG(CF)!=0,RES==0,GETFLAG(CF) || (RES==0),			\
+		(RES & SIGN)!=0,parity_lookup[lf_resb]!=0,((RES & SIGN)!=0) != (RES==OFRES),			\
+		(RES==0) || (((RES & SIGN)!=0) != (RES==OFRES)))
+
+LAZY_SUB_CONDITIONS(cond_subb,lf_var1b,lf_var2b,lf_resb,0x80,Bit8s)
+LAZY_SUB_CONDITIONS(cond_subw,lf_var1w,lf_var2w,lf_resw,0x8000,Bit16s)
+LAZY_SUB_CONDITIONS(cond_subd,lf_var1d,lf_var2d,lf_resd,0x80000000,Bit32s)
+LAZY_ADD_CONDITIONS(cond_addb,lf_var1b,lf_var2b,lf_resb,0x80)
+LAZY_ADD_CONDITIONS(cond_addw,lf_var1w,lf_var2w,lf_resw,0x8000)
+LAZY_ADD_CONDITIONS(cond_addd,lf_var1d,lf_var2d,lf_resd,0x80000000)
+LAZY_LOGIC_CONDITIONS(cond_logicb,lf_resb,0x80)
+LAZY_LOGIC_CONDITIONS(cond_logicw,lf_resw,0x8000)
+LAZY_LOGIC_CONDITIONS(cond_logicd,lf_resd,0x80000000)
+LAZY_INCDEC_CONDITIONS(cond_incb,lf_resb,0x80,0x80)
+LAZY_INCDEC_CONDITIONS(cond_incw,lf_resw,0x8000,0x8000)
+LAZY_INCDEC_CONDITIONS(cond_incd,lf_resd,0x80000000,0x80000000)
+LAZY_INCDEC_CONDITIONS(cond_decb,lf_resb,0x80,0x7f)
+LAZY_INCDEC_CONDITIONS(cond_decw,lf_resw,0x8000,0x7fff)
+LAZY_INCDEC_CONDITIONS(cond_decd,lf_resd,0x80000000,0x7fffffff)
+
+const LazyCondition * const lazy_conditions[t_LASTFLAG]={
+	cond_flags,												// t_UNKNOWN
+	cond_addb,cond_addw,cond_addd,							// t_ADD
+	cond_logicb,cond_logicw,cond_logicd,					// t_OR
+	cond_generic,cond_generic,cond_generic,					// t_ADC
+	cond_generic,cond_generic,cond_generic,					// t_SBB
+	cond_logicb,cond_logicw,cond_logicd,					// t_AND
+	cond_subb,cond_subw,cond_subd,							// t_SUB
+	cond_logicb,cond_logicw,cond_logicd,					// t_XOR
+	cond_subb,cond_subw,cond_subd,							// t_CMP
+	cond_incb,cond_incw,cond_incd,							// t_INC
+	cond_decb,cond_decw,cond_decd,							// t_DEC
+	cond_logicb,cond_logicw,cond_logicd,					// t_TEST
+	cond_generic,cond_generic,cond_generic,					// t_SHL
+	cond_generic,cond_generic,cond_generic,					// t_SHR
+	cond_generic,cond_generic,cond_generic,					// t_SAR
+	cond_generic,cond_generic,cond_generic,					// t_ROL
+	cond_generic,cond_generic,cond_generic,					// t_ROR
+	cond_generic,cond_generic,cond_generic,					// t_RCL
+	cond_generic,cond_generic,cond_generic,					// t_RCR
+	cond_generic,cond_generic,cond_generic,					// t_NEG
+	cond_generic,cond_generic,								// t_DSHL
+	cond_generic,cond_generic,								// t_DSHR
+	cond_generic,cond_generic,								// t_MUL,t_DIV
+	cond_generic											// t_NOTDONE
+};
+
 
 #if 0
 
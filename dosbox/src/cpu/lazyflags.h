@@ -82,22 +82,25 @@ extern LazyFlags lflags;
 #define LoadOF SETFLAGBIT(OF,get_OF());
 #define LoadAF SETFLAGBIT(AF,get_AF());
 
-#define TFLG_O		(get_OF())
-#define TFLG_NO		(!get_OF())
-#define TFLG_B		(get_CF())
-#define TFLG_NB		(!get_CF())
-#define TFLG_Z		(get_ZF())
-#define TFLG_NZ		(!get_ZF())
-#define TFLG_BE		(get_CF() || get_ZF())
-#define TFLG_NBE	(!get_CF() && !get_ZF())
-#define TFLG_S		(get_SF())
-#define TFLG_NS		(!get_SF())
-#define TFLG_P		(get_PF())
-#define TFLG_NP		(!get_PF())
-#define TFLG_L		((get_SF()!=0) != (get_OF()!=0))
-#define TFLG_NL		((get_SF()!=0) == (get_OF()!=0))
-#define TFLG_LE		(get_ZF()  || ((get_SF()!=0) != (get_OF()!=0)))
-#define TFLG_NLE	(!get_ZF() && ((get_SF()!=0) == (get_OF()!=0)))
+//Conditions are evaluated by a routine specialized for the last flag changing instruction
+#define TFLG_COND(COND)	(lazy_conditions[lflags.type][COND]())
+
+#define TFLG_O		TFLG_COND(0x0)
+#define TFLG_NO		TFLG_COND(0x1)
+#define TFLG_B		TFLG_COND(0x2)
+#define TFLG_NB		TFLG_COND(0x3)
+#define TFLG_Z		TFLG_COND(0x4)
+#define TFLG_NZ		TFLG_COND(0x5)
+#define TFLG_BE		TFLG_COND(0x6)
+#define TFLG_NBE	TFLG_COND(0x7)
+#define TFLG_S		TFLG_COND(0x8)
+#define TFLG_NS		TFLG_COND(0x9)
+#define TFLG_P		TFLG_COND(0xa)
+#define TFLG_NP		TFLG_COND(0xb)
+#define TFLG_L		TFLG_COND(0xc)
+#define TFLG_NL		TFLG_COND(0xd)
+#define TFLG_LE		TFLG_COND(0xe)
+#define TFLG_NLE	TFLG_COND(0xf)
 
 //Types of Flag changing instructions
 enum {
@@ -129,4 +132,8 @@ enum {
 	t_LASTFLAG
 };
 
+//Per instruction type a table of the 16 conditions in the order of the jcc opcodes
+typedef bool (*LazyCondition)(void);
+extern const LazyCondition * const lazy_conditions[t_LASTFLAG];
+
 #endif
@@ -29,6 +29,7 @@
 #include "cpu.h"
 #include "debug.h"
 #include "setup.h"
+#include "timer.h"
 
 #define LINK_TOTAL		(64*1024)
 
@@ -136,14 +137,53 @@ Bitu DEBUG_EnableDebugger(void);
 
 bool first=false;
 
+static struct {
+	Bitu faults;			// all page faults
+	Bitu unwound;			// page faults restarted by the core
+	Bitu nested_ticks;		// time spent in nested fault handlers
+	Bitu second;			// page faults during the current second
+	Bitu second_ticks;
+	Bitu peak;				// most page faults during one second
+} pf_stats;
+
+static void PAGING_PageFaultTick(void) {
+	if (++pf_stats.second_ticks<1000) return;
+	if (pf_stats.second) {
+		LOG(LOG_PAGING,LOG_NORMAL)("%d page faults/s",pf_stats.second);
+		if (pf_stats.second>pf_stats.peak) pf_stats.peak=pf_stats.second;
+	}
+	pf_stats.second=0;
+	pf_stats.second_ticks=0;
+}
+
+static void PAGING_LogPageFaults(void) {
+	if (!pf_stats.faults) return;
+	Bitu nested=pf_stats.faults-pf_stats.unwound;
+	LOG_MSG("PAGING:%d page faults, at most %d/s, %d restarted by the core",
+		pf_stats.faults,pf_stats.peak,pf_stats.unwound);
+	if (nested) LOG_MSG("PAGING:%d nested page faults took %dms, %dus per fault",
+		nested,pf_stats.nested_ticks,(pf_stats.nested_ticks*1000)/nested);
+}
+
 void PAGING_PageFault(PhysPt lin_addr,Bitu page_addr,Bitu faultcode) {
+	paging.cr2=lin_addr;
+	pf_stats.faults++;
+	pf_stats.second++;
+	if (paging.pf_unwind) {
+		/* Leave the instruction, the core restarts it in the fault handler */
+		LOG(LOG_PAGING,LOG_NORMAL)("PageFault at %X type [%x] restarted",lin_addr,faultcode);
+		pf_stats.unwound++;
+		GuestPageFault fault;
+		fault.faultcode=faultcode;
+		throw fault;
+	}
+	Bitu start_ticks=GetTicks();
 	/* Save the state of the cpu cores */
 	LazyFlags old_lflags;
 	memcpy(&old_lflags,&lflags,sizeof(LazyFlags));
 	CPU_Decoder * old_cpudecoder;
 	old_cpudecoder=cpudecoder;
 	cpudecoder=&PageFaultCore;
-	paging.cr2=lin_addr;
 	PF_Entry * entry=&pf_queue.entries[pf_queue.used++];
 	LOG(LOG_PAGING,LOG_NORMAL)("PageFault at %X type [%x] queue %d",lin_addr,faultcode,pf_queue.used);
 //	LOG_MSG("EAX:%04X ECX:%04X EDX:%04X EBX:%04X",reg_eax,reg_ecx,reg_edx,reg_ebx);
@@ -163,6 +203,7 @@ void PAGING_PageFault(PhysPt lin_addr,Bitu page_addr,Bitu faultcode) {
 	LOG(LOG_PAGING,LOG_NORMAL)("Left PageFault for %x queue %d",lin_addr,pf_queue.used);
 	memcpy(&lflags,&old_lflags,sizeof(LazyFlags));
 	cpudecoder=old_cpudecoder;
+	pf_stats.nested_ticks+=GetTicks()-start_ticks;
 //	LOG_MSG("SS:%04x SP:%08X",SegValue(ss),reg_esp);
 }
 
@@ -733,46 +774,59 @@ void PAGING_LinkPage_ReadOnly(Bitu lin_page,Bitu phys_page) {
 
 #else
 
-static INLINE void InitTLBInt(tlb_entry *bank) {
- 	for (Bitu i=0;i<TLB_SIZE;i++) {
-		bank[i].read=0;
-		bank[i].write=0;
-		bank[i].readhandler=&init_page_handler;
-		bank[i].writehandler=&init_page_handler;
- 	}
+static void InitTLBTable(tlb_table *table) {
+	for (Bitu i=0;i<TLB_TABLE_SIZE;i++) {
+		table->read[i]=0;
+		table->write[i]=0;
+		table->readhandler[i]=&init_page_handler;
+		table->writehandler[i]=&init_page_handler;
+		table->phys_page[i]=0;
+	}
+}
+
+/* Get the table for lin_page to change its entries, allocate it if the
+   region still uses the shared empty table */
+static tlb_table * GetTLBTable(Bitu lin_page) {
+	tlb_table * & table=paging.tlb_dir[lin_page>>(TLB_DIR_SHIFT-12)];
+	if (GCC_UNLIKELY(table==&paging.tlb_empty)) {
+		table=(tlb_table *)malloc(sizeof(tlb_table));
+		if (!table) E_Exit("Out of Memory");
+		InitTLBTable(table);
+		paging.tlb_tables++;
+	}
+	return table;
 }
 
-void PAGING_InitTLBBank(tlb_entry **bank) {
-	*bank = (tlb_entry *)malloc(sizeof(tlb_entry)*TLB_SIZE);
-	if(!*bank) E_Exit("Out of Memory");
-	InitTLBInt(*bank);
+static void ResetTLBEntry(tlb_table *table,Bitu index) {
+	table->read[index]=0;
+	table->write[index]=0;
+	table->readhandler[index]=&init_page_handler;
+	table->writehandler[index]=&init_page_handler;
 }
 
 void PAGING_InitTLB(void) {
-	InitTLBInt(paging.tlbh);
- 	paging.links.used=0;
+	InitTLBTable(&paging.tlb_empty);
+	for (Bitu i=0;i<TLB_DIR_SIZE;i++) {
+		if (paging.tlb_dir[i] && paging.tlb_dir[i]!=&paging.tlb_empty) free(paging.tlb_dir[i]);
+		paging.tlb_dir[i]=&paging.tlb_empty;
+	}
+	paging.tlb_tables=0;
+	paging.links.used=0;
 }
 
 void PAGING_ClearTLB(void) {
 	Bit32u * entries=&paging.links.entries[0];
 	for (;paging.links.used>0;paging.links.used--) {
 		Bitu page=*entries++;
-		tlb_entry *entry = get_tlb_entry(page<<12);
-		entry->read=0;
-		entry->write=0;
-		entry->readhandler=&init_page_handler;
-		entry->writehandler=&init_page_handler;
+		ResetTLBEntry(get_tlb_table(page<<12),TLB_INDEX(page<<12));
 	}
 	paging.links.used=0;
 }
 
 void PAGING_UnlinkPages(Bitu lin_page,Bitu pages) {
 	for (;pages>0;pages--) {
-		tlb_entry *entry = get_tlb_entry(lin_page<<12);
-		entry->read=0;
-		entry->write=0;
-		entry->readhandler=&init_page_handler;
-		entry->writehandler=&init_page_handler;
+		tlb_table * table=get_tlb_table(lin_page<<12);
+		if (table!=&paging.tlb_empty) ResetTLBEntry(table,TLB_INDEX(lin_page<<12));
 		lin_page++;
 	}
 }
@@ -780,10 +834,8 @@ void PAGING_UnlinkPages(Bitu lin_page,Bitu pages) {
 void PAGING_MapPage(Bitu lin_page,Bitu phys_page) {
 	if (lin_page<LINK_START) {
 		paging.firstmb[lin_page]=phys_page;
-		paging.tlbh[lin_page].read=0;
-		paging.tlbh[lin_page].write=0;
-		paging.tlbh[lin_page].readhandler=&init_page_handler;
-		paging.tlbh[lin_page].writehandler=&init_page_handler;
+		tlb_table * table=get_tlb_table(lin_page<<12);
+		if (table!=&paging.tlb_empty) ResetTLBEntry(table,TLB_INDEX(lin_page<<12));
 	} else {
 		PAGING_LinkPage(lin_page,phys_page);
 	}
@@ -792,7 +844,7 @@ void PAGING_MapPage(Bitu lin_page,Bitu phys_page) {
 void PAGING_LinkPage(Bitu lin_page,Bitu phys_page) {
 	PageHandler * handler=MEM_GetPageHandler(phys_page);
 	Bitu lin_base=lin_page << 12;
-	if (lin_page>=(TLB_SIZE*(TLB_BANKS+1)) || phys_page>=(TLB_SIZE*(TLB_BANKS+1))) 
+	if (lin_page>=TLB_SIZE || phys_page>=TLB_SIZE) 
 		E_Exit("Illegal page");
 
 	if (paging.links.used>=PAGING_LINKS) {
@@ -800,22 +852,23 @@ void PAGING_LinkPage(Bitu lin_page,Bitu phys_page) {
 		PAGING_ClearTLB();
 	}
 
-	tlb_entry *entry = get_tlb_entry(lin_base);
-	entry->phys_page=phys_page;
-	if (handler->flags & PFLAG_READABLE) entry->read=handler->GetHostReadPt(phys_page)-lin_base;
-	else entry->read=0;
-	if (handler->flags & PFLAG_WRITEABLE) entry->write=handler->GetHostWritePt(phys_page)-lin_base;
-	else entry->write=0;
+	tlb_table * table=GetTLBTable(lin_page);
+	Bitu index=TLB_INDEX(lin_base);
+	table->phys_page[index]=phys_page;
+	if (handler->flags & PFLAG_READABLE) table->read[index]=handler->GetHostReadPt(phys_page)-lin_base;
+	else table->read[index]=0;
+	if (handler->flags & PFLAG_WRITEABLE) table->write[index]=handler->GetHostWritePt(phys_page)-lin_base;
+	else table->write[index]=0;
 
- 	paging.links.entries[paging.links.used++]=lin_page;
-	entry->readhandler=handler;
-	entry->writehandler=handler;
+	paging.links.entries[paging.links.used++]=lin_page;
+	table->readhandler[index]=handler;
+	table->writehandler[index]=handler;
 }
 
 void PAGING_LinkPage_ReadOnly(Bitu lin_page,Bitu phys_page) {
 	PageHandler * handler=MEM_GetPageHandler(phys_page);
 	Bitu lin_base=lin_page << 12;
-	if (lin_page>=(TLB_SIZE*(TLB_BANKS+1)) || phys_page>=(TLB_SIZE*(TLB_BANKS+1))) 
+	if (lin_page>=TLB_SIZE || phys_page>=TLB_SIZE) 
 		E_Exit("Illegal page");
 
 	if (paging.links.used>=PAGING_LINKS) {
@@ -823,15 +876,23 @@ void PAGING_LinkPage_ReadOnly(Bitu lin_page,Bitu phys_page) {
 		PAGING_ClearTLB();
 	}
 
-	tlb_entry *entry = get_tlb_entry(lin_base);
-	entry->phys_page=phys_page;
-	if (handler->flags & PFLAG_READABLE) entry->read=handler->GetHostReadPt(phys_page)-lin_base;
-	else entry->read=0;
-	entry->write=0;
+	tlb_table * table=GetTLBTable(lin_page);
+	Bitu index=TLB_INDEX(lin_base);
+	table->phys_page[index]=phys_page;
+	if (handler->flags & PFLAG_READABLE) table->read[index]=handler->GetHostReadPt(phys_page)-lin_base;
+	else table->read[index]=0;
+	table->write[index]=0;
 
- 	paging.links.entries[paging.links.used++]=lin_page;
-	entry->readhandler=handler;
-	entry->writehandler=&init_page_handler_userro;
+	paging.links.entries[paging.links.used++]=lin_page;
+	table->readhandler[index]=handler;
+	table->writehandler[index]=&init_page_handler_userro;
+}
+
+static void PAGING_LogTLBUsage(void) {
+	LOG_MSG("PAGING:TLB uses %d of %d tables, %dKB instead of %dKB for a full TLB",
+		paging.tlb_tables,TLB_DIR_SIZE,
+		(Bitu)(sizeof(paging.tlb_dir)+sizeof(tlb_table)*(paging.tlb_tables+1))>>10,
+		(Bitu)(sizeof(tlb_table)*TLB_DIR_SIZE)>>10);
 }
 
 #endif
@@ -874,14 +935,23 @@ public:
 	PAGING(Section* configuration):Module_base(configuration){
 		/* Setup default Page Directory, force it to update */
 		paging.enabled=false;
+		paging.pf_unwind=false;
 		PAGING_InitTLB();
 		Bitu i;
 		for (i=0;i<LINK_START;i++) {
 			paging.firstmb[i]=i;
 		}
 		pf_queue.used=0;
+		memset(&pf_stats,0,sizeof(pf_stats));
+		TIMER_AddTickHandler(PAGING_PageFaultTick);
+	}
+	~PAGING(){
+		TIMER_DelTickHandler(PAGING_PageFaultTick);
+		PAGING_LogPageFaults();
+#if !defined(USE_FULL_TLB)
+		PAGING_LogTLBUsage();
+#endif
 	}
-	~PAGING(){}
 };
 
 static PAGING* test;
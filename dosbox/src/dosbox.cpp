@@ -22,9 +22,12 @@
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
+#include <vector>
+#include <algorithm>
 #include "dosbox.h"
 #include "debug.h"
 #include "cpu.h"
+#include "paging.h"
 #include "video.h"
 #include "pic.h"
 #include "cpu.h"
@@ -42,6 +45,7 @@
 #include "ints/int10.h"
 #include "render.h"
 #include "pci_bus.h"
+#include "vga.h"
 
 Config * control;
 MachineType machine;
@@ -129,6 +133,133 @@ Bit32s ticksDone;
 Bit32u ticksScheduled;
 bool ticksLocked;
 
+/* Adapt the cycles to the host time the scheduled ticks took,
+ * lagged is the number of ticks the host fell behind */
+static void DOSBOX_AdjustCycles(Bit32u lagged) {
+	if (CPU_CycleAutoAdjust && !CPU_SkipCycleAutoAdjust) {
+		if (ticksScheduled >= 250 || ticksDone >= 250 || (lagged > 15 && ticksScheduled >= 5) ) {
+			if(ticksDone < 1) ticksDone = 1; // Protect against div by zero
+			/* ratio we are aiming for is around 90% usage*/
+			Bit32s ratio = (ticksScheduled * (CPU_CyclePercUsed*90*1024/100/100)) / ticksDone;
+			Bit32s new_cmax = CPU_CycleMax;
+			Bit64s cproc = (Bit64s)CPU_CycleMax * (Bit64s)ticksScheduled;
+			if (cproc > 0) {
+				/* ignore the cycles added due to the IO delay code in order
+				   to have smoother auto cycle adjustments */
+				double ratioremoved = (double) CPU_IODelayRemoved / (double) cproc;
+				if (ratioremoved < 1.0) {
+					ratio = (Bit32s)((double)ratio * (1 - ratioremoved));
+					/* Don't allow very high ratio which can cause us to lock as we don't scale down
+					 * for very low ratios. High ratio might result because of timing resolution */
+					if (ticksScheduled >= 250 && ticksDone < 10 && ratio > 20480) 
+						ratio = 20480;
+					Bit64s cmax_scaled = (Bit64s)CPU_CycleMax * (Bit64s)ratio;
+					/* The auto cycle code seems reliable enough to disable the fast cut back code.
+					 * This should improve the fluency of complex games.
+					if (ratio <= 1024) 
+						new_cmax = (Bit32s)(cmax_scaled / (Bit64s)1024);
+					else 
+					 */
+					new_cmax = (Bit32s)(1 + (CPU_CycleMax >> 1) + cmax_scaled / (Bit64s)2048);
+				}
+			}
+
+			if (new_cmax<CPU_CYCLES_LOWER_LIMIT)
+				new_cmax=CPU_CYCLES_LOWER_LIMIT;
+
+			/* ratios below 1% are considered to be dropouts due to
+			   temporary load imbalance, the cycles adjusting is skipped */
+			if (ratio>10) {
+				/* ratios below 12% along with a large time since the last update
+				   has taken place are most likely caused by heavy load through a
+				   different application, the cycles adjusting is skipped as well */
+				if ((ratio>120) || (ticksDone<700)) {
+					CPU_CycleMax = new_cmax;
+					if (CPU_CycleLimit > 0) {
+						if (CPU_CycleMax>CPU_CycleLimit) CPU_CycleMax = CPU_CycleLimit;
+					}
+				}
+			}
+			CPU_IODelayRemoved = 0;
+			ticksDone = 0;
+			ticksScheduled = 0;
+		} else if (lagged > 15) {
+			/* lagged > 15 but ticksScheduled < 5, lower the cycles
+			   but do not reset the scheduled/done ticks to take them into
+			   account during the next auto cycle adjustment */
+			CPU_CycleMax /= 3;
+			if (CPU_CycleMax < CPU_CYCLES_LOWER_LIMIT)
+				CPU_CycleMax = CPU_CYCLES_LOWER_LIMIT;
+		}
+	}
+}
+
+/* Frame pacing runs the machine in bursts of one guest frame and then waits
+ * until the frame is due, so frames reach the host at an even rate instead
+ * of whenever enough 1 ms ticks were caught up */
+static struct {
+	bool enabled;
+	double owed;				// emulated milliseconds not scheduled yet
+	double due;					// host time the next burst is due
+	Bit32u start;				// host time the last burst started
+	Bit32u stats_start;
+	std::vector<Bit32u> times;	// host frame times since stats_start
+} framepace;
+
+extern void GFX_SetTitleInfo(const char * info);
+
+static void FramePace_Stats(Bit32u now) {
+	std::vector<Bit32u> & times=framepace.times;
+	if ((now-framepace.stats_start<1000) || times.empty()) return;
+	Bit64u sum=0;
+	Bit32u min=times[0];
+	for (Bitu i=0;i<times.size();i++) {
+		sum+=times[i];
+		if (times[i]<min) min=times[i];
+	}
+	Bitu p99=(times.size()*99)/100;
+	if (p99>=times.size()) p99=times.size()-1;
+	std::nth_element(times.begin(),times.begin()+p99,times.end());
+	char info[64];
+	sprintf(info,"Frame min %d avg %.1f p99 %d ms",(int)min,(double)sum/times.size(),(int)times[p99]);
+	GFX_SetTitleInfo(info);
+	times.clear();
+	framepace.stats_start=now;
+}
+
+static void FramePace_NextFrame(void) {
+	double period=vga.draw.delay.vtotal;
+	// no video timing set up yet or nothing that looks like a refresh rate
+	if (period<5.0 || period>50.0) period=1000.0/60.0;
+	Bit32u now=GetTicks();
+	Bit32u busy=now-framepace.start;
+	if (now<framepace.due) {
+		SDL_Delay((Bit32u)(framepace.due-now));
+		now=GetTicks();
+	}
+	framepace.times.push_back(now-framepace.start);
+	framepace.start=now;
+	FramePace_Stats(now);
+
+	Bit32u lagged=0;
+	if (now>framepace.due) {
+		lagged=(Bit32u)(now-framepace.due);
+		// more than a couple of frames behind, don't try to catch up
+		if (lagged>2*period) framepace.due=now;
+	}
+	framepace.due+=period;
+	framepace.owed+=period;
+	ticksRemain=(Bit32u)framepace.owed;
+	framepace.owed-=ticksRemain;
+
+	ticksScheduled+=ticksAdded;
+	ticksDone+=busy;
+	ticksAdded=ticksRemain;
+	DOSBOX_AdjustCycles(lagged);
+	// keep the normal pacing from seeing a gap when it takes over again
+	ticksLast=now;
+}
+
 static Bitu Normal_Loop(void) {
 	Bits ret;
 	while (1) {
@@ -159,6 +290,8 @@ increaseticks:
 		ticksAdded = 0;
 		ticksDone = 0;
 		ticksScheduled = 0;
+	} else if (framepace.enabled) {
+		FramePace_NextFrame();
 	} else {
 		Bit32u ticksNew;
 		ticksNew=GetTicks();
@@ -171,62 +304,7 @@ increaseticks:
 				ticksRemain = 20;
 			}
 			ticksAdded = ticksRemain;
-			if (CPU_CycleAutoAdjust && !CPU_SkipCycleAutoAdjust) {
-				if (ticksScheduled >= 250 || ticksDone >= 250 || (ticksAdded > 15 && ticksScheduled >= 5) ) {
-					if(ticksDone < 1) ticksDone = 1; // Protect against div by zero
-					/* ratio we are aiming for is around 90% usage*/
-					Bit32s ratio = (ticksScheduled * (CPU_CyclePercUsed*90*1024/100/100)) / ticksDone;
-					Bit32s new_cmax = CPU_CycleMax;
-					Bit64s cproc = (Bit64s)CPU_CycleMax * (Bit64s)ticksScheduled;
-					if (cproc > 0) {
-						/* ignore the cycles added due to the IO delay code in order
-						   to have smoother auto cycle adjustments */
-						double ratioremoved = (double) CPU_IODelayRemoved / (double) cproc;
-						if (ratioremoved < 1.0) {
-							ratio = (Bit32s)((double)ratio * (1 - ratioremoved));
-							/* Don't allow very high ratio which can cause us to lock as we don't scale down
-							 * for very low ratios. High ratio might result because of timing resolution */
-							if (ticksScheduled >= 250 && ticksDone < 10 && ratio > 20480) 
-								ratio = 20480;
-							Bit64s cmax_scaled = (Bit64s)CPU_CycleMax * (Bit64s)ratio;
-							/* The auto cycle code seems reliable enough to disable the fast cut back code.
-							 * This should improve the fluency of complex games.
-							if (ratio <= 1024) 
-								new_cmax = (Bit32s)(cmax_scaled / (Bit64s)1024);
-							else 
-							 */
-							new_cmax = (Bit32s)(1 + (CPU_CycleMax >> 1) + cmax_scaled / (Bit64s)2048);
-						}
-					}
-
-					if (new_cmax<CPU_CYCLES_LOWER_LIMIT)
-						new_cmax=CPU_CYCLES_LOWER_LIMIT;
-
-					/* ratios below 1% are considered to be dropouts due to
-					   temporary load imbalance, the cycles adjusting is skipped */
-					if (ratio>10) {
-						/* ratios below 12% along with a large time since the last update
-						   has taken place are most likely caused by heavy load through a
-						   different application, the cycles adjusting is skipped as well */
-						if ((ratio>120) || (ticksDone<700)) {
-							CPU_CycleMax = new_cmax;
-							if (CPU_CycleLimit > 0) {
-								if (CPU_CycleMax>CPU_CycleLimit) CPU_CycleMax = CPU_CycleLimit;
-							}
-						}
-					}
-					CPU_IODelayRemoved = 0;
-					ticksDone = 0;
-					ticksScheduled = 0;
-				} else if (ticksAdded > 15) {
-					/* ticksAdded > 15 but ticksScheduled < 5, lower the cycles
-					   but do not reset the scheduled/done ticks to take them into
-					   account during the next auto cycle adjustment */
-					CPU_CycleMax /= 3;
-					if (CPU_CycleMax < CPU_CYCLES_LOWER_LIMIT)
-						CPU_CycleMax = CPU_CYCLES_LOWER_LIMIT;
-				}
-			}
+			DOSBOX_AdjustCycles(ticksAdded);
 		} else {
 			ticksAdded = 0;
 			SDL_Delay(1);
@@ -247,6 +325,7 @@ void DOSBOX_SetNormalLoop() {
 }
 
 void DOSBOX_RunMachine(void){
+	PAGING_FaultScope fault_scope(false);
 	Bitu ret;
 	do {
 		ret=(*loop)();
@@ -281,6 +360,11 @@ static void DOSBOX_RealInit(Section * sec) {
 	ticksRemain=0;
 	ticksLast=GetTicks();
 	ticksLocked = false;
+	framepace.enabled = section->Get_bool("framepacing");
+	framepace.owed = 0;
+	framepace.start = framepace.stats_start = ticksLast;
+	framepace.due = ticksLast;
+	framepace.times.clear();
 	DOSBOX_SetLoop(&Normal_Loop);
 	MSG_Init(section);
 
@@ -369,6 +453,17 @@ void DOSBOX_Init(void)
 		"  This value is best left at its default to avoid problems with some games,\n"
 		"  though few games might require a higher value.\n"
 		"  There is generally no speed advantage when raising this value.");
+	Pstring = secprop->Add_path("memfile",Property::Changeable::OnlyAtStart,"");
+	Pstring->Set_help(
+		"File to back the emulated memory with, instead of anonymous host memory.\n"
+		"  Leave empty unless the host is short on memory and has no swap.");
+	Pbool = secprop->Add_bool("iohistogram",Property::Changeable::WhenIdle,false);
+	Pbool->Set_help("Count the accesses to each io port. The mapper event 'IO Histogram'\n"
+		"  writes the most accessed ports to io_histogram.txt.");
+	Pbool = secprop->Add_bool("framepacing",Property::Changeable::OnlyAtStart,false);
+	Pbool->Set_help("Run the emulation in steps of one frame of the emulated video card and wait\n"
+		"  for the frame to be due, instead of catching up in steps of 1 ms.\n"
+		"  Gives a more even frame rate, the frame times are shown in the title bar.");
 	secprop->AddInitFunction(&CALLBACK_Init);
 	secprop->AddInitFunction(&PIC_Init);//done
 	secprop->AddInitFunction(&PROGRAMS_Init);
@@ -409,17 +504,37 @@ void DOSBOX_Init(void)
 #if (C_DYNAMIC_X86) || (C_DYNREC)
 		"dynamic",
 #endif
-		"normal", "simple",0 };
+#if (C_DYNREC)
+		"tiered",
+#endif
+		"normal", "simple", "threaded",0 };
 	Pstring = secprop->Add_string("core",Property::Changeable::WhenIdle,"dynamic");
 	Pstring->Set_values(cores);
 	Pstring->Set_help("CPU Core used in emulation. auto will switch to dynamic if available and\n"
-		"appropriate.");
+		"appropriate. threaded runs blocks of pre-decoded instructions, the other\n"
+		"instructions are handled like with normal. tiered interprets code and only\n"
+		"translates the pages that are run often with the dynamic core.");
 
 	const char* cputype_values[] = { "auto", "386", "386_slow", "486_slow", "pentium_slow", "386_prefetch", 0};
 	Pstring = secprop->Add_string("cputype",Property::Changeable::Always,"auto");
 	Pstring->Set_values(cputype_values);
 	Pstring->Set_help("CPU Type used in emulation. auto is the fastest choice.");
 
+#if (C_DYNREC)
+	Pint = secprop->Add_int("dynamic_cachesize",Property::Changeable::WhenIdle,8192);
+	Pint->SetMinMax(256,131072);
+	Pint->Set_help("Size of the code cache of the dynamic core in kilobytes. Lower it to save memory,\n"
+		"raise it if big programs (Windows 3.x) keep retranslating code.");
+
+	Pbool = secprop->Add_bool("dynamic_fpu",Property::Changeable::WhenIdle,true);
+	Pbool->Set_help("Translate basic floating point instructions of the dynamic core to host fpu code.\n"
+		"Disable for software that depends on the exact results of the fpu emulation.");
+
+	Pbool = secprop->Add_bool("dynamic_blockprofile",Property::Changeable::WhenIdle,false);
+	Pbool->Set_help("Count how often the blocks translated by the dynamic core are run. The hottest\n"
+		"blocks are written to dynrec_profile.txt with the Dyn Profile mapper event (ctrl-alt-f6).");
+#endif
+
 
 	Pmulti_remain = secprop->Add_multiremain("cycles",Property::Changeable::Always," ");
 	Pmulti_remain->Set_help(
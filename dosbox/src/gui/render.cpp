@@ -156,6 +156,51 @@ static void RENDER_FinishLineHandler(const void * source)
 }
 
 
+/* The display surface may be double or triple buffered, so a changed line
+ * has to go into each of the buffers before it can be skipped again */
+#define RENDER_DIRECT_BUFFERS 3
+static Bit8u render_direct_left[SCALER_MAXHEIGHT];
+
+/* 8bpp source converted through the palette straight into a 16bpp display
+ * surface. The source cache is still compared and kept up to date, a line is
+ * redrawn from it until every buffer of the surface has the new contents */
+static void RENDER_DirectLineHandler(const void * s) 
+{
+    Bit8u *left = &render_direct_left[render.scale.inLine];
+    
+    if (GCC_LIKELY(s != NULL) && memcmp(s, render.scale.cacheRead, render.src.start * sizeof(Bitu))) 
+    {
+        memcpy(render.scale.cacheRead, s, render.scale.cachePitch);
+        *left = RENDER_DIRECT_BUFFERS;
+    }
+    
+    if (*left) 
+    {
+        const Bit8u *src = render.scale.cacheRead;
+        Bit32u *dst = (Bit32u *)render.scale.outWrite;
+        const Bit16u *lut = render.pal.lut.b16;
+        Bitu x = render.src.width;
+        
+        for (; x >= 4; x -= 4, src += 4, dst += 2) 
+        {
+#if defined(WORDS_BIGENDIAN)
+            dst[0] = (lut[src[0]] << 16) | lut[src[1]];
+            dst[1] = (lut[src[2]] << 16) | lut[src[3]];
+#else
+            dst[0] = lut[src[0]] | (lut[src[1]] << 16);
+            dst[1] = lut[src[2]] | (lut[src[3]] << 16);
+#endif
+        }
+        for (Bit16u *dst16 = (Bit16u *)dst; x > 0; x--) *dst16++ = lut[*src++];
+        (*left)--;
+    }
+    
+    render.scale.inLine++;
+    render.scale.cacheRead += render.scale.cachePitch;
+    Scaler_ChangedLines[Scaler_ChangedLineIndex]++;
+    render.scale.outWrite += render.scale.outPitch;
+}
+
 static void RENDER_ClearCacheHandler(const void * src) 
 {
     Bitu width;
@@ -194,8 +239,29 @@ bool RENDER_StartUpdate(void)
     Scaler_ChangedLines[0] = 0;
     Scaler_ChangedLineIndex = 0;
     
+    if(render.scale.direct) 
+    {
+        if(GCC_UNLIKELY(!GFX_StartUpdate(render.scale.outWrite, render.scale.outPitch))) return false;
+        
+        Scaler_ChangedLineIndex = 1;
+        Scaler_ChangedLines[1] = 0;
+        
+        /* Stale cache, new colours or overlays drawn over the last frame,
+         * every line has to go into every buffer again */
+        const bool capture = (CaptureState & (CAPTURE_IMAGE|CAPTURE_VIDEO)) != 0;
+        if(render.scale.clearCache || render.pal.changed || capture || GFX_DirectOverlaid()) 
+        {
+            memset(render_direct_left, RENDER_DIRECT_BUFFERS, sizeof(render_direct_left));
+            render.scale.clearCache = false;
+        }
+        
+        /* A capture needs the whole frame in the cache, the scaler does that */
+        render.fullFrame = capture;
+        if(GCC_UNLIKELY(capture)) RENDER_DrawLine = RENDER_ClearCacheHandler;
+        else RENDER_DrawLine = RENDER_DirectLineHandler;
+    }
     /* Clearing the cache will first process the line to make sure it's never the same */
-    if(GCC_UNLIKELY(render.scale.clearCache)) 
+    else if(GCC_UNLIKELY(render.scale.clearCache)) 
     {
 //        LOG_MSG("Clearing cache");
         //Will always have to update the screen with this one anyway, so let's update already
@@ -212,8 +278,11 @@ bool RENDER_StartUpdate(void)
             /* Assume pal changes always do a full screen update anyway */
             if(GCC_UNLIKELY(!GFX_StartUpdate(render.scale.outWrite, render.scale.outPitch))) return false;
             
+            /* The cache holds palette indices, the palette handler compares those
+             * and redraws unchanged lines from it, so lines can still be skipped */
             RENDER_DrawLine = render.scale.linePalHandler;
-            render.fullFrame = true;
+            if(GCC_UNLIKELY(CaptureState & (CAPTURE_IMAGE|CAPTURE_VIDEO))) render.fullFrame = true;
+            else render.fullFrame = false;
         } 
         else 
         {
@@ -259,6 +328,8 @@ void RENDER_EndUpdate( bool abort ) {
             flags, fps, (Bit8u *)&scalerSourceCache, (Bit8u*)&render.pal.rgb );
     }
     if ( render.scale.outWrite ) {
+        /* The direct handler counted lines into buffers that won't be shown */
+        if (abort && render.scale.direct) render.scale.clearCache = true;
         GFX_EndUpdate( abort? NULL : Scaler_ChangedLines );
         render.frameskip.hadSkip[render.frameskip.index] = 0;
     } else {
@@ -447,6 +518,9 @@ forcenormal:
             gfx_flags = (gfx_flags & ~GFX_CAN_8) | GFX_RGBONLY;
             break;
     }
+    /* Plain 8bpp output can skip the intermediate surface */
+    if (render.src.bpp == 8 && !complexBlock && simpleBlock == &ScaleNormal1x)
+        gfx_flags |= GFX_DIRECT;
     gfx_flags=GFX_GetBestMode(gfx_flags);
     if (!gfx_flags) {
         if (!complexBlock && simpleBlock == &ScaleNormal1x) 
@@ -479,6 +553,7 @@ forcenormal:
         render.scale.outMode = scalerMode32;
     else 
         E_Exit("Failed to create a rendering output");
+    render.scale.direct = (gfx_flags & GFX_DIRECT) && render.scale.outMode == scalerMode16;
     ScalerLineBlock_t *lineBlock;
     if (gfx_flags & GFX_HARDWARE) {
 #if RENDER_USE_ADVANCED_SCALERS>1
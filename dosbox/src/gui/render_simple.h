@@ -23,6 +23,11 @@ static void conc4d(SCALERNAME,SBPP,DBPP,L)(const void *s) {
 static void conc4d(SCALERNAME,SBPP,DBPP,R)(const void *s) {
 #endif
 #ifdef RENDER_NULL_INPUT
+#if (SBPP == 9)
+	/* The palette indices of an unchanged line are still in the cache, the
+	 * pixels using changed palette entries get redrawn from there */
+	if (!s) s = render.scale.cacheRead;
+#else
 	if (!s) {
 		render.scale.cacheRead += render.scale.cachePitch;
 #if defined(SCALERLINEAR) 
@@ -33,6 +38,7 @@ static void conc4d(SCALERNAME,SBPP,DBPP,R)(const void *s) {
 		ScalerAddLines( 0, skipLines );
 		return;
 	}
+#endif
 #endif
 	/* Clear the complete line marker */
 	Bitu hadChange = 0;
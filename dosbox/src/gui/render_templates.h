@@ -155,12 +155,17 @@
 #if RENDER_USE_ADVANCED_SCALERS>1
 static void conc3d(Cache,SBPP,DBPP) (const void * s) {
 #ifdef RENDER_NULL_INPUT
+#if (SBPP == 9)
+	/* Unchanged palette indices are still in the cache */
+	if (!s) s = render.scale.cacheRead;
+#else
 	if (!s) {
 		render.scale.cacheRead += render.scale.cachePitch;
 		render.scale.inLine++;
 		render.scale.complexHandler();
 		return;
 	}
+#endif
 #endif
 	const SRCTYPE * src = (SRCTYPE*)s;
 	PTYPE *fc= &FC[render.scale.inLine+1][1];
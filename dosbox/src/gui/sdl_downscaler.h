@@ -1,44 +1,285 @@
-
-
-#define COLORMIX32(A,B,C,D) ((((A) >> 2) & 0x3F3F3F3F) + (((B) >> 2) & 0x3F3F3F3F) + (((C) >> 2) & 0x3F3F3F3F) + (((D) >> 2) & 0x3F3F3F3F))
-#define COLORMIX16(A,B,C,D) ((((A) >> 2) & 0x39E7) + (((B) >> 2) & 0x39E7) + (((C) >> 2) & 0x39E7) + (((D) >> 2) & 0x39E7))
-
-#define DEFINE_GFX_DOWNSCALE(SX,SY,DX,DY,BPP)                                                  \
-void GFX_Downscale_##SX##x##SY##_to_##DX##x##DY##_##BPP(SDL_Surface *src, SDL_Surface *dst)    \
-{                                                                                              \
-    Bit##BPP##u *Dest = (Bit##BPP##u *)dst->pixels;                                            \
-    Bit##BPP##u *Src  = (Bit##BPP##u *)src->pixels;                                            \
-                                                                                               \
-    int x,y;                                                                                   \
-    Dest += (DY-SY/2)/2*DX;                                                                    \
-    for(y = SY/2; y--;) {                                                                      \
-        for(x = SX/2; x--;) {                                                                  \
-            __builtin_prefetch(Dest + 4, 1);                                                   \
-            __builtin_prefetch(Src + 4, 0);                                                    \
-            *Dest++ = COLORMIX##BPP(Src[0], Src[1], Src[SX], Src[SX+1]);                       \
-            Src += 2;                                                                          \
-        }                                                                                      \
-        Src += SX;                                                                             \
-        Dest+= (dst->pitch - SX/2);                                                            \
-    }                                                                                          \
-}
-
-
-DEFINE_GFX_DOWNSCALE(640, 350, 320, 240, 16)
-DEFINE_GFX_DOWNSCALE(640, 400, 320, 240, 16)
-DEFINE_GFX_DOWNSCALE(640, 480, 320, 240, 16)
-DEFINE_GFX_DOWNSCALE(640, 350, 320, 240, 32)
-DEFINE_GFX_DOWNSCALE(640, 400, 320, 240, 32)
-DEFINE_GFX_DOWNSCALE(640, 480, 320, 240, 32)
-
-void (* GFX_PDownscale)(SDL_Surface *, SDL_Surface *) = NULL;
-
-#define GFX_PDOWNSCALE(A,B) \
-{\
-    if(GFX_PDownscale) {    \
-        if(SDL_MUSTLOCK(B)) SDL_LockSurface(B); \
-        GFX_PDownscale(A, B);    \
-        if(SDL_MUSTLOCK(B)) SDL_UnlockSurface(B); \
-    }    \
-}
-    
+/* 2x2 box filter downscalers for the 640 pixel wide modes on a 320x240 screen.
+ * Each output pixel is the rounded average of a 2x2 block of source pixels.
+ * A row is done by one of the kernels below, SSE2 when the compiler targets it
+ * and otherwise a portable one that works on two pixels per 32 bit load.
+ * The portable kernel is what the MIPS Dingux builds run, there is no NEON
+ * kernel for ARM handhelds yet. scripts/bench/downscale.cpp checks and times
+ * them. */
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* RGB565: red/blue and green are summed in separate words, so the sums of four
+ * pixels have room to grow without running into the next field */
+#define DOWNSCALE16_RB 0x0000F81F
+#define DOWNSCALE16_G  0x000007E0
+#define DOWNSCALE16_RB_ROUND 0x00001002
+#define DOWNSCALE16_G_ROUND  0x00000040
+#define DOWNSCALE16_SPREAD 0x07E0F81F
+#define DOWNSCALE16_SPREAD_ROUND 0x00401002
+
+/* XRGB8888: alternate bytes are summed, each gets 16 bits to grow */
+#define DOWNSCALE32_LANES 0x00FF00FF
+#define DOWNSCALE32_ROUND 0x00020002
+
+static void GFX_DownscaleRow16(const Bit16u *a, const Bit16u *b, Bit16u *d, int w)
+{
+#if defined(__SSE2__)
+    const __m128i rbmask = _mm_set1_epi32(DOWNSCALE16_RB);
+    const __m128i gmask = _mm_set1_epi32(DOWNSCALE16_G);
+    const __m128i rbround = _mm_set1_epi32(DOWNSCALE16_RB_ROUND);
+    const __m128i ground = _mm_set1_epi32(DOWNSCALE16_G_ROUND);
+    __m128i out[2];
+    for(; w >= 8; w -= 8, a += 16, b += 16, d += 8)
+    {
+        for(int i=0; i<2; i++)
+        {
+            // Every 32 bit lane holds a horizontal pair, add it to the pair below
+            const __m128i pa = _mm_loadu_si128((const __m128i *)a + i);
+            const __m128i pb = _mm_loadu_si128((const __m128i *)b + i);
+            const __m128i ha = _mm_srli_epi32(pa, 16);
+            const __m128i hb = _mm_srli_epi32(pb, 16);
+            __m128i rb = _mm_add_epi32(_mm_add_epi32(_mm_and_si128(pa, rbmask), _mm_and_si128(ha, rbmask)),
+                                       _mm_add_epi32(_mm_and_si128(pb, rbmask), _mm_and_si128(hb, rbmask)));
+            __m128i g = _mm_add_epi32(_mm_add_epi32(_mm_and_si128(pa, gmask), _mm_and_si128(ha, gmask)),
+                                      _mm_add_epi32(_mm_and_si128(pb, gmask), _mm_and_si128(hb, gmask)));
+            rb = _mm_and_si128(_mm_srli_epi32(_mm_add_epi32(rb, rbround), 2), rbmask);
+            g = _mm_and_si128(_mm_srli_epi32(_mm_add_epi32(g, ground), 2), gmask);
+            // Sign extend the 16 bit results so the saturating pack keeps them
+            out[i] = _mm_srai_epi32(_mm_slli_epi32(_mm_or_si128(rb, g), 16), 16);
+        }
+        _mm_storeu_si128((__m128i *)d, _mm_packs_epi32(out[0], out[1]));
+    }
+#endif
+    /* Two pixels per load, masked once as loaded and once with the halves
+     * swapped, which lines up the fields of both and leaves gaps for the carries */
+    const Bit32u *pa = (const Bit32u *)a;
+    const Bit32u *pb = (const Bit32u *)b;
+    for(; w > 0; w--)
+    {
+        const Bit32u sa = *pa++;
+        const Bit32u sb = *pb++;
+        Bit32u sum = (sa & DOWNSCALE16_SPREAD) + (((sa << 16) | (sa >> 16)) & DOWNSCALE16_SPREAD) +
+                     (sb & DOWNSCALE16_SPREAD) + (((sb << 16) | (sb >> 16)) & DOWNSCALE16_SPREAD);
+        sum = ((sum + DOWNSCALE16_SPREAD_ROUND) >> 2) & DOWNSCALE16_SPREAD;
+        *d++ = (Bit16u)(sum | (sum >> 16));
+    }
+}
+
+static void GFX_DownscaleRow32(const Bit32u *a, const Bit32u *b, Bit32u *d, int w)
+{
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi16(2);
+    __m128i out[2];
+    for(; w >= 4; w -= 4, a += 8, b += 8, d += 4)
+    {
+        for(int i=0; i<2; i++)
+        {
+            const __m128i pa = _mm_loadu_si128((const __m128i *)a + i);
+            const __m128i pb = _mm_loadu_si128((const __m128i *)b + i);
+            // Widen to 16 bits per channel and add the rows, two pixels per register
+            const __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(pa, zero), _mm_unpacklo_epi8(pb, zero));
+            const __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(pa, zero), _mm_unpackhi_epi8(pb, zero));
+            // Then the horizontal pairs, which sit in the two 64 bit halves
+            __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));
+            out[i] = _mm_srli_epi16(_mm_add_epi16(sum, round), 2);
+        }
+        _mm_storeu_si128((__m128i *)d, _mm_packus_epi16(out[0], out[1]));
+    }
+#endif
+    for(; w > 0; w--, a += 2, b += 2)
+    {
+        Bit32u lanes = (a[0] & DOWNSCALE32_LANES) + (a[1] & DOWNSCALE32_LANES) +
+                       (b[0] & DOWNSCALE32_LANES) + (b[1] & DOWNSCALE32_LANES);
+        Bit32u odd = ((a[0] >> 8) & DOWNSCALE32_LANES) + ((a[1] >> 8) & DOWNSCALE32_LANES) +
+                     ((b[0] >> 8) & DOWNSCALE32_LANES) + ((b[1] >> 8) & DOWNSCALE32_LANES);
+        lanes = ((lanes + DOWNSCALE32_ROUND) >> 2) & DOWNSCALE32_LANES;
+        odd = ((odd + DOWNSCALE32_ROUND) >> 2) & DOWNSCALE32_LANES;
+        *d++ = lanes | (odd << 8);
+    }
+}
+
+/* The lines that do not fill the screen are centered vertically */
+#define DEFINE_GFX_DOWNSCALE(SX,SY,DX,DY,BPP)                                                  \
+void GFX_Downscale_##SX##x##SY##_to_##DX##x##DY##_##BPP(SDL_Surface *src, SDL_Surface *dst)    \
+{                                                                                              \
+    const Bit8u *Src = (const Bit8u *)src->pixels;                                             \
+    Bit8u *Dest = (Bit8u *)dst->pixels;                                                        \
+                                                                                               \
+    Dest += (DY-SY/2)/2*dst->pitch;                                                            \
+    for(int y = SY/2; y--;) {                                                                  \
+        GFX_DownscaleRow##BPP((const Bit##BPP##u *)Src, (const Bit##BPP##u *)(Src + src->pitch), \
+                              (Bit##BPP##u *)Dest, SX/2);                                      \
+        Src += src->pitch * 2;                                                                 \
+        Dest += dst->pitch;                                                                    \
+    }                                                                                          \
+}
+
+
+DEFINE_GFX_DOWNSCALE(640, 350, 320, 240, 16)
+DEFINE_GFX_DOWNSCALE(640, 400, 320, 240, 16)
+DEFINE_GFX_DOWNSCALE(640, 480, 320, 240, 16)
+DEFINE_GFX_DOWNSCALE(640, 350, 320, 240, 32)
+DEFINE_GFX_DOWNSCALE(640, 400, 320, 240, 32)
+DEFINE_GFX_DOWNSCALE(640, 480, 320, 240, 32)
+
+/* Area averaging downscaler for the modes without a fixed one above, like the
+ * 800x600 and 1024x768 SVGA modes or the 640x200 EGA mode. Every output pixel is the average of the
+ * source area it covers, with 8 bit fixed point weights that sum to 256 for
+ * the partly covered columns and rows, set up once per mode. Source rows are
+ * filtered horizontally once and then summed into the output rows they cover. */
+#define DOWNSCALE_AREA_TAPS 8       // covers shrinking up to 7:1
+#define DOWNSCALE_AREA_MAXW 640
+#define DOWNSCALE_AREA_MAXH 480
+
+static struct {
+    int width, height;              // scaled size
+    Bit16u colStart[DOWNSCALE_AREA_MAXW];
+    Bit8u colCount[DOWNSCALE_AREA_MAXW];
+    Bit16u colWeight[DOWNSCALE_AREA_MAXW][DOWNSCALE_AREA_TAPS];
+    Bit16u rowStart[DOWNSCALE_AREA_MAXH];
+    Bit8u rowCount[DOWNSCALE_AREA_MAXH];
+    Bit16u rowWeight[DOWNSCALE_AREA_MAXH][DOWNSCALE_AREA_TAPS];
+    // Horizontal sums of one source row, blue (low) and red (high) share a word
+    int row;
+    Bit32u rb[DOWNSCALE_AREA_MAXW], g[DOWNSCALE_AREA_MAXW];
+    Bit32u accR[DOWNSCALE_AREA_MAXW], accG[DOWNSCALE_AREA_MAXW], accB[DOWNSCALE_AREA_MAXW];
+} downscale_area;
+
+static bool GFX_DownscaleAreaWeights(int src, int dst, Bit16u *start, Bit8u *count, Bit16u (*weight)[DOWNSCALE_AREA_TAPS])
+{
+    for(int j=0; j<dst; j++)
+    {
+        // In units of 1/dst source pixels output pixel j covers [from,to)
+        const int from = j * src;
+        const int to = from + src;
+        int k = from / dst;
+        int n = 0, total = 0, biggest = 0;
+        start[j] = (Bit16u)k;
+        for(; k * dst < to; k++, n++)
+        {
+            if(n == DOWNSCALE_AREA_TAPS) return false;
+            const int lo = from > k * dst ? from : k * dst;
+            const int hi = to < (k + 1) * dst ? to : (k + 1) * dst;
+            weight[j][n] = (Bit16u)(((hi - lo) * 256 + src / 2) / src);
+            total += weight[j][n];
+            if(weight[j][n] > weight[j][biggest]) biggest = n;
+        }
+        // Rounding leftovers go to the biggest share so every pixel sums to 256
+        weight[j][biggest] += 256 - total;
+        count[j] = (Bit8u)n;
+    }
+    return true;
+}
+
+/* Scale a sw x sh frame to the whole dw x dh screen, false if the frame is
+ * too large to be handled. A monitor shows every DOS mode at 4:3 whatever the
+ * shape of its pixels, so 640x200 fills the screen just like 800x600 does;
+ * rows of such modes cover more than one output line. */
+bool GFX_SetupDownscaleArea(int sw, int sh, int dw, int dh)
+{
+    if(dw > DOWNSCALE_AREA_MAXW || dh > DOWNSCALE_AREA_MAXH) return false;
+    if(!GFX_DownscaleAreaWeights(sw, dw, downscale_area.colStart, downscale_area.colCount, downscale_area.colWeight)) return false;
+    if(!GFX_DownscaleAreaWeights(sh, dh, downscale_area.rowStart, downscale_area.rowCount, downscale_area.rowWeight)) return false;
+    downscale_area.width = dw;
+    downscale_area.height = dh;
+    return true;
+}
+
+// RGB565, red moves up to bit 16 so the weighted blue has room below it
+static INLINE void GFX_DownscaleAreaRow16(const Bit16u *src)
+{
+    for(int j=0; j<downscale_area.width; j++)
+    {
+        const Bit16u *s = src + downscale_area.colStart[j];
+        const Bit16u *w = downscale_area.colWeight[j];
+        Bit32u rb = 0, g = 0;
+        for(int n = downscale_area.colCount[j]; n--; s++, w++)
+        {
+            const Bit32u p = *s;
+            rb += *w * ((p & 0x001F) | ((p & 0xF800) << 5));
+            g += *w * (p & 0x07E0);
+        }
+        downscale_area.rb[j] = rb;
+        downscale_area.g[j] = g;
+    }
+}
+
+static INLINE Bit16u GFX_DownscaleAreaPixel16(Bit32u r, Bit32u g, Bit32u b)
+{
+    return (Bit16u)((((r + 0x8000) >> 16) << 11) | (((g + 0x100000) >> 16) & 0x07E0) | ((b + 0x8000) >> 16));
+}
+
+// XRGB8888, red and blue keep their 16 bit lanes
+static INLINE void GFX_DownscaleAreaRow32(const Bit32u *src)
+{
+    for(int j=0; j<downscale_area.width; j++)
+    {
+        const Bit32u *s = src + downscale_area.colStart[j];
+        const Bit16u *w = downscale_area.colWeight[j];
+        Bit32u rb = 0, g = 0;
+        for(int n = downscale_area.colCount[j]; n--; s++, w++)
+        {
+            const Bit32u p = *s;
+            rb += *w * (p & 0x00FF00FF);
+            g += *w * ((p >> 8) & 0xFF);
+        }
+        downscale_area.rb[j] = rb;
+        downscale_area.g[j] = g;
+    }
+}
+
+static INLINE Bit32u GFX_DownscaleAreaPixel32(Bit32u r, Bit32u g, Bit32u b)
+{
+    return (((r + 0x8000) >> 16) << 16) | (((g + 0x8000) >> 16) << 8) | ((b + 0x8000) >> 16);
+}
+
+#define DEFINE_GFX_DOWNSCALE_AREA(BPP)                                                         \
+void GFX_Downscale_Area_##BPP(SDL_Surface *src, SDL_Surface *dst)                              \
+{                                                                                              \
+    const Bit8u *Src = (const Bit8u *)src->pixels;                                             \
+    Bit8u *Dest = (Bit8u *)dst->pixels;                                                        \
+    const int width = downscale_area.width;                                                    \
+                                                                                               \
+    downscale_area.row = -1;                                                                   \
+    for(int y = 0; y < downscale_area.height; y++, Dest += dst->pitch) {                       \
+        memset(downscale_area.accR, 0, width * sizeof(Bit32u));                                \
+        memset(downscale_area.accG, 0, width * sizeof(Bit32u));                                \
+        memset(downscale_area.accB, 0, width * sizeof(Bit32u));                                \
+        for(int t = 0; t < downscale_area.rowCount[y]; t++) {                                  \
+            const int row = downscale_area.rowStart[y] + t;                                    \
+            const Bit32u wy = downscale_area.rowWeight[y][t];                                  \
+            /* The last row of an output line is often the first of the next */               \
+            if(row != downscale_area.row) {                                                    \
+                GFX_DownscaleAreaRow##BPP((const Bit##BPP##u *)(Src + row * src->pitch));      \
+                downscale_area.row = row;                                                      \
+            }                                                                                  \
+            for(int x = 0; x < width; x++) {                                                   \
+                downscale_area.accR[x] += wy * (downscale_area.rb[x] >> 16);                   \
+                downscale_area.accG[x] += wy * downscale_area.g[x];                            \
+                downscale_area.accB[x] += wy * (downscale_area.rb[x] & 0xFFFF);                \
+            }                                                                                  \
+        }                                                                                      \
+        Bit##BPP##u *d = (Bit##BPP##u *)Dest;                                                  \
+        for(int x = 0; x < width; x++)                                                         \
+            d[x] = GFX_DownscaleAreaPixel##BPP(downscale_area.accR[x], downscale_area.accG[x], \
+                                               downscale_area.accB[x]);                        \
+    }                                                                                          \
+}
+
+DEFINE_GFX_DOWNSCALE_AREA(16)
+DEFINE_GFX_DOWNSCALE_AREA(32)
+
+void (* GFX_PDownscale)(SDL_Surface *, SDL_Surface *) = NULL;
+
+#define GFX_PDOWNSCALE(A,B) \
+{\
+    if(GFX_PDownscale) {    \
+        if(SDL_MUSTLOCK(B)) SDL_LockSurface(B); \
+        GFX_PDownscale(A, B);    \
+        if(SDL_MUSTLOCK(B)) SDL_UnlockSurface(B); \
+    }    \
+}
+
@@ -101,6 +101,7 @@ void MENU_UpdateMenu()
     else if(cpudecoder == &CPU_Core_Normal_Run) strcpy(menu.core, "normal");
     else if(cpudecoder == &CPU_Core_Simple_Run) strcpy(menu.core, "simple");
     else if(cpudecoder == &CPU_Core_Full_Run) strcpy(menu.core, "full");
+    else if(cpudecoder == &CPU_Core_Threaded_Run) strcpy(menu.core, "threaded");
 #if (C_DYNREC)
     else if(cpudecoder == &CPU_Core_Dynrec_Run) strcpy(menu.core, "dynamic");
 #endif
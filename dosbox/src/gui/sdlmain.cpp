@@ -202,6 +202,10 @@ struct SDL_Block {
     struct {
         SDL_Surface * surface;
         SDL_Surface * buffer;
+        SDL_Surface * convert;  // surface at the display depth for the downscalers
+        bool direct;        // render draws into sdl.surface itself
+        bool overlaid;      // the last direct frame got an overlay drawn over it
+        bool allow_direct;
 #if (HAVE_DDRAW_H) && defined(WIN32)
         RECT rect;
 #endif
@@ -239,8 +243,10 @@ extern bool CPU_CycleAutoAdjust;
 bool startup_state_numlock=false;
 bool startup_state_capslock=false;
 
+static char title_info[64]={0};
+
 void GFX_SetTitle(Bit32s cycles,Bits frameskip,bool paused){
-    char title[200]={0};
+    char title[264]={0};
     static Bit32s internal_cycles=0;
     static Bits internal_frameskip=0;
     if(cycles != -1) internal_cycles = cycles;
@@ -251,10 +257,20 @@ void GFX_SetTitle(Bit32s cycles,Bits frameskip,bool paused){
         sprintf(title,"DOSBox %s, CPU speed: %8d cycles, Frameskip %2d, Program: %8s",VERSION,internal_cycles,internal_frameskip,RunningProgram);
     }
 
+    if(title_info[0]) {
+        strcat(title,", ");
+        strcat(title,title_info);
+    }
     if(paused) strcat(title," PAUSED");
     SDL_WM_SetCaption(title,VERSION);
 }
 
+/* Extra status shown at the end of the title, like the frame times */
+void GFX_SetTitleInfo(const char * info){
+    safe_strncpy(title_info,info,sizeof(title_info));
+    GFX_SetTitle(-1,-1,false);
+}
+
 static unsigned char logo[32*32*4]= {
 #include "dosbox_logo.h"
 };
@@ -303,54 +319,18 @@ void GFX_BlitUnscaledDinguxSurface(SDL_Surface *source, SDL_Surface *destination
     }
 }
 
-#define BLEND16(A,B) ((((A) >> 1) & 0x7BEF) + (((B) >> 1) & 0x7BEF))
-void GFX_BlitDownscaledDinguxSurface(SDL_Surface *source, SDL_Surface *destination)
+void GFX_BlitDinguxSurface(SDL_Surface *source, SDL_Surface *destination)
 {
-    if(SDL_MUSTLOCK(source)) SDL_LockSurface(source);
-    if(SDL_MUSTLOCK(destination)) SDL_LockSurface(destination);
- 
-    uint16_t *s = (uint16_t*)source->pixels;
-    uint16_t *d = (uint16_t*)destination->pixels;
-    
-    uint16_t buffer1[320];
-    uint16_t buffer2[320];
-    
-    int width = source->w/2;
-    int height = source->h/2;
-    int offsetx;
-    int offsety;
-    
-    for(int y=0; y<height; y++)
+    if(GFX_PDownscale) 
     {
-        offsety = (y << 1) * source->w;
-        
-        for(int x=0; x<width; x++)
+        // the downscalers only work between surfaces of the same depth
+        if(sdl.blit.convert) 
         {
-            offsetx = x << 1;
-            buffer1[x] = (uint16_t)BLEND16(s[offsety + offsetx], s[offsety + offsetx | 1]);
-        }
-        
-        offsety = ((y << 1) | 1) * source->w;;
-        
-        for(int x=0; x<width; x++)
-        {
-            offsetx = x << 1;
-            buffer2[x] = (uint16_t)BLEND16(s[offsety + offsetx], s[offsety + offsetx | 1]);
-        }
-        
-        for(int x=0; x<width; x++)
-        {
-            d[y * destination->w + x] = BLEND16(buffer1[x], buffer2[x]);
+            SDL_BlitSurface(source, NULL, sdl.blit.convert, NULL);
+            source = sdl.blit.convert;
         }
+        GFX_PDOWNSCALE(source, destination);
     }
-    
-    if(SDL_MUSTLOCK(source)) SDL_UnlockSurface(source);
-    if(SDL_MUSTLOCK(destination)) SDL_UnlockSurface(destination);
-}
-
-void GFX_BlitDinguxSurface(SDL_Surface *source, SDL_Surface *destination)
-{
-    if(GFX_PDownscale) GFX_BlitDownscaledDinguxSurface(source, destination);
     else SDL_BlitSurface(source, NULL, destination, NULL);
 }
 
@@ -467,7 +447,7 @@ check_gotbpp:
         switch (sdl.desktop.bpp) {
         case 0:
         case 8:
-        case 16: flags = GFX_CAN_16; break;
+        case 16: flags = GFX_CAN_16 | (flags & GFX_DIRECT); break;
         case 24:
         case 32: flags = GFX_CAN_32; break;
         }
@@ -600,6 +580,9 @@ Bitu GFX_SetSize(Bitu width, Bitu height, Bitu flags, double scalex, double scal
     Bitu bpp = 0;
     Bitu retFlags = 0;
 
+    sdl.blit.direct = false;
+    sdl.blit.overlaid = false;
+
     if (sdl.blit.surface) 
     {
         SDL_FreeSurface(sdl.blit.surface);
@@ -612,6 +595,12 @@ Bitu GFX_SetSize(Bitu width, Bitu height, Bitu flags, double scalex, double scal
         sdl.blit.buffer = 0;
     }
     
+    if (sdl.blit.convert) 
+    {
+        SDL_FreeSurface(sdl.blit.convert);
+        sdl.blit.convert = 0;
+    }
+    
     if (sdl.surface)
     {
         SDL_FreeSurface(sdl.surface);
@@ -736,6 +725,13 @@ printf("Scaling (%i, %i), (%i, %i) -> (%i, %i)\n", width, height, sdl.desktop.fu
             sdl.clip.y = 0; // (Sint16)((sdl.desktop.full.height-height)/2);
             sdl.blit.surface = SDL_CreateRGBSurface(SDL_SWSURFACE, width, height, bpp, 0, 0, 0, 0);
             printf("Using IPU scaled surface of %ix%i\n", width, height);
+            
+            // No conversion or scaling left, render can write the display surface itself
+            if(sdl.blit.allow_direct && (flags & GFX_DIRECT) && bpp == 16) 
+            {
+                sdl.blit.direct = true;
+                printf("Drawing directly into the display surface\n");
+            }
         } 
         else 
         {
@@ -745,20 +741,41 @@ printf("Scaling (%i, %i), (%i, %i) -> (%i, %i)\n", width, height, sdl.desktop.fu
             sdl.clip.y = 0;
             sdl.blit.surface = SDL_CreateRGBSurface(SDL_SWSURFACE, width, height, bpp, 0, 0, 0, 0);
 
-            if(width == 640 && height == 400)
+            // the kernels write the display surface, so its depth picks them
+            Bitu dst_bpp = sdl.surface ? sdl.surface->format->BitsPerPixel : 16;
+            
+            if(dst_bpp != 16 && dst_bpp != 32)
+            {
+                printf("No downscaler for a %i bpp display\n", (int)dst_bpp);
+            }
+            else if(width == 640 && height == 400)
             {
                 printf("==Selected 640x400 downscaler==\n");
-                GFX_PDownscale = (bpp == 16 ? &GFX_Downscale_640x400_to_320x240_16 : &GFX_Downscale_640x400_to_320x240_32);
+                GFX_PDownscale = (dst_bpp == 16 ? &GFX_Downscale_640x400_to_320x240_16 : &GFX_Downscale_640x400_to_320x240_32);
             }
             else if(width == 640 && height == 480)
             {
                 printf("==Selected 640x480 downscaler==\n");
-                GFX_PDownscale = (bpp == 16 ? &GFX_Downscale_640x480_to_320x240_16 : &GFX_Downscale_640x480_to_320x240_32);
+                GFX_PDownscale = (dst_bpp == 16 ? &GFX_Downscale_640x480_to_320x240_16 : &GFX_Downscale_640x480_to_320x240_32);
             }
             else if(width == 640 && height == 350)
             {
                 printf("==Selected 640x350 downscaler==\n");
-                GFX_PDownscale = (bpp == 16 ? &GFX_Downscale_640x350_to_320x240_16 : &GFX_Downscale_640x350_to_320x240_32);
+                GFX_PDownscale = (dst_bpp == 16 ? &GFX_Downscale_640x350_to_320x240_16 : &GFX_Downscale_640x350_to_320x240_32);
+            }
+            else if(GFX_SetupDownscaleArea(width, height, sdl_width, sdl_height))
+            {
+                printf("==Selected %ix%i area downscaler==\n", width, height);
+                GFX_PDownscale = (dst_bpp == 16 ? &GFX_Downscale_Area_16 : &GFX_Downscale_Area_32);
+            }
+            
+            // a frame of another depth is converted by SDL before it is downscaled
+            if(GFX_PDownscale && dst_bpp != bpp)
+            {
+                SDL_PixelFormat * fmt = sdl.surface->format;
+                sdl.blit.convert = SDL_CreateRGBSurface(SDL_SWSURFACE, width, height, dst_bpp, 
+                                    fmt->Rmask, fmt->Gmask, fmt->Bmask, fmt->Amask);
+                if(!sdl.blit.convert) GFX_PDownscale = NULL;
             }
         }
 
@@ -794,6 +811,7 @@ printf("Scaling (%i, %i), (%i, %i) -> (%i, %i)\n", width, height, sdl.desktop.fu
         }
 
         retFlags |= GFX_SCALING;
+        if(sdl.blit.direct) retFlags |= GFX_DIRECT;
         break;
     case SCREEN_OVERLAY:
         if (sdl.overlay) {
@@ -1043,7 +1061,7 @@ bool GFX_StartUpdate(Bit8u * & pixels, Bitu & pitch)
 
         case SCREEN_SURFACE_DINGUX:
             
-            if(sdl.blit.surface) 
+            if(sdl.blit.surface && !sdl.blit.direct) 
             {
                 pixels = (Bit8u *)sdl.blit.surface->pixels;
                 pitch = sdl.blit.surface->pitch;
@@ -1086,6 +1104,12 @@ bool GFX_StartUpdate(Bit8u * & pixels, Bitu & pitch)
 }
 
 
+/* Lines render skips in the direct surface have to be drawn again after an overlay */
+bool GFX_DirectOverlaid(void) 
+{
+    return sdl.blit.overlaid;
+}
+
 void GFX_EndUpdate( const Bit16u *changedLines ) 
 {
 #if (HAVE_DDRAW_H) && defined(WIN32)
@@ -1149,7 +1173,16 @@ void GFX_EndUpdate( const Bit16u *changedLines )
         }
         break;
     case SCREEN_SURFACE_DINGUX:
-        if(!vkeyb_active && !vkeyb_last) 
+        if(sdl.blit.direct) 
+        {
+            // The frame is already in place, only the overlays are left
+            if(SDL_MUSTLOCK(sdl.surface)) SDL_UnlockSurface(sdl.surface);
+            
+            sdl.blit.overlaid = vkeyb_active || vkeyb_last || VMOUSE_IsEnabled();
+            if(!vkeyb_active && !vkeyb_last) VMOUSE_BlitVMouse(sdl.surface);
+            else VKEYB_BlitVkeyboard(sdl.surface);
+        }
+        else if(!vkeyb_active && !vkeyb_last) 
         {
             if(sdl.blit.surface) 
             {
@@ -1491,6 +1524,7 @@ static void GUI_StartUp(Section * sec) {
 #endif
     }
     sdl.mouse.autoenable=section->Get_bool("autolock");
+    sdl.blit.allow_direct=section->Get_bool("directdraw");
     if (!sdl.mouse.autoenable) SDL_ShowCursor(SDL_DISABLE);
     sdl.mouse.autolock=false;
     sdl.mouse.sensitivity=section->Get_int("sensitivity");
@@ -1960,6 +1994,10 @@ void Config_Add_SDL() {
     Pstring->Set_help("What video system to use for output.");
     Pstring->Set_values(outputs);
 
+    Pbool = sdl_sec->Add_bool("directdraw",Property::Changeable::OnlyAtStart,true);
+    Pbool->Set_help("Convert 8-bit modes straight into the display surface when they fit unscaled,\n"
+                    "instead of going through an intermediate surface.");
+
     Pbool = sdl_sec->Add_bool("autolock",Property::Changeable::Always,true);
     Pbool->Set_help("Mouse will automatically lock, if you click on the screen. (Press CTRL-F10 to unlock)");
 
@@ -18,17 +18,71 @@
 
 
 #include <string.h>
+#include <stdio.h>
+#include <vector>
+#include <algorithm>
 #include "dosbox.h"
 #include "inout.h"
 #include "setup.h"
 #include "cpu.h"
 #include "../src/cpu/lazyflags.h"
 #include "callback.h"
+#include "mapper.h"
 
 //#define ENABLE_PORTLOG
 
-IO_WriteHandler * io_writehandlers[3][IO_MAX];
-IO_ReadHandler * io_readhandlers[3][IO_MAX];
+/* The handlers are kept in blocks of IO_BLOCK_SIZE ports. Blocks without any
+ * registered handler share the default block, so only the port ranges that
+ * are actually used take memory. A block is never freed once allocated, the
+ * address of a handler slot stays valid for the recompiler to call through.
+ */
+#define IO_BLOCK_SHIFT 8
+#define IO_BLOCK_SIZE (1<<IO_BLOCK_SHIFT)
+#define IO_BLOCK_MASK (IO_BLOCK_SIZE-1)
+#define IO_BLOCKS ((IO_MAX+IO_BLOCK_SIZE-1)>>IO_BLOCK_SHIFT)
+
+struct IO_ReadBlock {
+	IO_ReadHandler * handler[3][IO_BLOCK_SIZE];
+};
+
+struct IO_WriteBlock {
+	IO_WriteHandler * handler[3][IO_BLOCK_SIZE];
+};
+
+static IO_ReadBlock io_read_default;
+static IO_WriteBlock io_write_default;
+static IO_ReadBlock * io_readblocks[IO_BLOCKS];
+static IO_WriteBlock * io_writeblocks[IO_BLOCKS];
+
+#define IO_READHANDLER(width,port) io_readblocks[(port)>>IO_BLOCK_SHIFT]->handler[width][(port)&IO_BLOCK_MASK]
+#define IO_WRITEHANDLER(width,port) io_writeblocks[(port)>>IO_BLOCK_SHIFT]->handler[width][(port)&IO_BLOCK_MASK]
+
+// per port access counts (reads at even, writes at odd indices), only allocated when enabled
+static Bit32u * io_counts=NULL;
+
+static INLINE void IO_Count(Bitu port,Bitu write) {
+	if (GCC_UNLIKELY(io_counts!=NULL)) io_counts[(port<<1)|write]++;
+}
+
+static IO_ReadBlock * IO_GetReadBlock(Bitu port) {
+	IO_ReadBlock * block=io_readblocks[port>>IO_BLOCK_SHIFT];
+	if (block==&io_read_default) {
+		block=new IO_ReadBlock;
+		memcpy(block,&io_read_default,sizeof(IO_ReadBlock));
+		io_readblocks[port>>IO_BLOCK_SHIFT]=block;
+	}
+	return block;
+}
+
+static IO_WriteBlock * IO_GetWriteBlock(Bitu port) {
+	IO_WriteBlock * block=io_writeblocks[port>>IO_BLOCK_SHIFT];
+	if (block==&io_write_default) {
+		block=new IO_WriteBlock;
+		memcpy(block,&io_write_default,sizeof(IO_WriteBlock));
+		io_writeblocks[port>>IO_BLOCK_SHIFT]=block;
+	}
+	return block;
+}
 
 static Bitu IO_ReadBlocked(Bitu /*port*/,Bitu /*iolen*/) {
 	return ~0;
@@ -41,16 +95,16 @@ static Bitu IO_ReadDefault(Bitu port,Bitu iolen) {
 	switch (iolen) {
 	case 1:
 		LOG(LOG_IO,LOG_WARN)("Read from port %04X",port);
-		io_readhandlers[0][port]=IO_ReadBlocked;
+		IO_RegisterReadHandler(port,IO_ReadBlocked,IO_MB);
 		return 0xff;
 	case 2:
 		return
-			(io_readhandlers[0][port+0](port+0,1) << 0) |
-			(io_readhandlers[0][port+1](port+1,1) << 8);
+			(IO_READHANDLER(0,port+0)(port+0,1) << 0) |
+			(IO_READHANDLER(0,port+1)(port+1,1) << 8);
 	case 4:
 		return
-			(io_readhandlers[1][port+0](port+0,2) << 0) |
-			(io_readhandlers[1][port+2](port+2,2) << 16);
+			(IO_READHANDLER(1,port+0)(port+0,2) << 0) |
+			(IO_READHANDLER(1,port+2)(port+2,2) << 16);
 	}
 	return 0;
 }
@@ -59,55 +113,72 @@ void IO_WriteDefault(Bitu port,Bitu val,Bitu iolen) {
 	switch (iolen) {
 	case 1:
 		LOG(LOG_IO,LOG_WARN)("Writing %02X to port %04X",val,port);
-		io_writehandlers[0][port]=IO_WriteBlocked;
+		IO_RegisterWriteHandler(port,IO_WriteBlocked,IO_MB);
 		break;
 	case 2:
-		io_writehandlers[0][port+0](port+0,(val >> 0) & 0xff,1);
-		io_writehandlers[0][port+1](port+1,(val >> 8) & 0xff,1);
+		IO_WRITEHANDLER(0,port+0)(port+0,(val >> 0) & 0xff,1);
+		IO_WRITEHANDLER(0,port+1)(port+1,(val >> 8) & 0xff,1);
 		break;
 	case 4:
-		io_writehandlers[1][port+0](port+0,(val >> 0 ) & 0xffff,2);
-		io_writehandlers[1][port+2](port+2,(val >> 16) & 0xffff,2);
+		IO_WRITEHANDLER(1,port+0)(port+0,(val >> 0 ) & 0xffff,2);
+		IO_WRITEHANDLER(1,port+2)(port+2,(val >> 16) & 0xffff,2);
 		break;
 	}
 }
 
 void IO_RegisterReadHandler(Bitu port,IO_ReadHandler * handler,Bitu mask,Bitu range) {
 	while (range--) {
-		if (mask&IO_MB) io_readhandlers[0][port]=handler;
-		if (mask&IO_MW) io_readhandlers[1][port]=handler;
-		if (mask&IO_MD) io_readhandlers[2][port]=handler;
+		IO_ReadBlock * block=IO_GetReadBlock(port);
+		if (mask&IO_MB) block->handler[0][port&IO_BLOCK_MASK]=handler;
+		if (mask&IO_MW) block->handler[1][port&IO_BLOCK_MASK]=handler;
+		if (mask&IO_MD) block->handler[2][port&IO_BLOCK_MASK]=handler;
 		port++;
 	}
 }
 
 void IO_RegisterWriteHandler(Bitu port,IO_WriteHandler * handler,Bitu mask,Bitu range) {
 	while (range--) {
-		if (mask&IO_MB) io_writehandlers[0][port]=handler;
-		if (mask&IO_MW) io_writehandlers[1][port]=handler;
-		if (mask&IO_MD) io_writehandlers[2][port]=handler;
+		IO_WriteBlock * block=IO_GetWriteBlock(port);
+		if (mask&IO_MB) block->handler[0][port&IO_BLOCK_MASK]=handler;
+		if (mask&IO_MW) block->handler[1][port&IO_BLOCK_MASK]=handler;
+		if (mask&IO_MD) block->handler[2][port&IO_BLOCK_MASK]=handler;
 		port++;
 	}
 }
 
 void IO_FreeReadHandler(Bitu port,Bitu mask,Bitu range) {
 	while (range--) {
-		if (mask&IO_MB) io_readhandlers[0][port]=IO_ReadDefault;
-		if (mask&IO_MW) io_readhandlers[1][port]=IO_ReadDefault;
-		if (mask&IO_MD) io_readhandlers[2][port]=IO_ReadDefault;
+		// ports in the default block are free already
+		IO_ReadBlock * block=io_readblocks[port>>IO_BLOCK_SHIFT];
+		if (block!=&io_read_default) {
+			if (mask&IO_MB) block->handler[0][port&IO_BLOCK_MASK]=IO_ReadDefault;
+			if (mask&IO_MW) block->handler[1][port&IO_BLOCK_MASK]=IO_ReadDefault;
+			if (mask&IO_MD) block->handler[2][port&IO_BLOCK_MASK]=IO_ReadDefault;
+		}
 		port++;
 	}
 }
 
 void IO_FreeWriteHandler(Bitu port,Bitu mask,Bitu range) {
 	while (range--) {
-		if (mask&IO_MB) io_writehandlers[0][port]=IO_WriteDefault;
-		if (mask&IO_MW) io_writehandlers[1][port]=IO_WriteDefault;
-		if (mask&IO_MD) io_writehandlers[2][port]=IO_WriteDefault;
+		IO_WriteBlock * block=io_writeblocks[port>>IO_BLOCK_SHIFT];
+		if (block!=&io_write_default) {
+			if (mask&IO_MB) block->handler[0][port&IO_BLOCK_MASK]=IO_WriteDefault;
+			if (mask&IO_MW) block->handler[1][port&IO_BLOCK_MASK]=IO_WriteDefault;
+			if (mask&IO_MD) block->handler[2][port&IO_BLOCK_MASK]=IO_WriteDefault;
+		}
 		port++;
 	}
 }
 
+IO_ReadHandler ** IO_GetReadSlot(Bitu port,Bitu width) {
+	return &IO_GetReadBlock(port)->handler[width][port&IO_BLOCK_MASK];
+}
+
+IO_WriteHandler ** IO_GetWriteSlot(Bitu port,Bitu width) {
+	return &IO_GetWriteBlock(port)->handler[width][port&IO_BLOCK_MASK];
+}
+
 void IO_ReadHandleObject::Install(Bitu port,IO_ReadHandler * handler,Bitu mask,Bitu range) {
 	if(!installed) {
 		installed=true;
@@ -286,228 +357,222 @@ void log_io(Bitu width, bool write, Bitu port, Bitu val) {
 #endif
 
 
-void IO_WriteB(Bitu port,Bitu val) {
-	log_io(0, true, port, val);
-	if (GCC_UNLIKELY(GETFLAG(VM) && (CPU_IO_Exception(port,1)))) {
-		LazyFlags old_lflags;
-		memcpy(&old_lflags,&lflags,sizeof(LazyFlags));
-		CPU_Decoder * old_cpudecoder;
-		old_cpudecoder=cpudecoder;
-		cpudecoder=&IOFaultCore;
-		IOF_Entry * entry=&iof_queue.entries[iof_queue.used++];
-		entry->cs=SegValue(cs);
-		entry->eip=reg_eip;
-		CPU_Push16(SegValue(cs));
-		CPU_Push16(reg_ip);
-		Bit8u old_al = reg_al;
-		Bit16u old_dx = reg_dx;
-		reg_al = val;
-		reg_dx = port;
-		RealPt icb = CALLBACK_RealPointer(call_priv_io);
-		SegSet16(cs,RealSeg(icb));
-		reg_eip = RealOff(icb)+0x08;
-		CPU_Exception(cpu.exception.which,cpu.exception.error);
-
-		DOSBOX_RunMachine();
-		iof_queue.used--;
-
-		reg_al = old_al;
-		reg_dx = old_dx;
-		memcpy(&lflags,&old_lflags,sizeof(LazyFlags));
-		cpudecoder=old_cpudecoder;
-	}
-	else {
-		IO_USEC_write_delay();
-		io_writehandlers[0][port](port,val,1);
-	}
-}
-
-void IO_WriteW(Bitu port,Bitu val) {
-	log_io(1, true, port, val);
-	if (GCC_UNLIKELY(GETFLAG(VM) && (CPU_IO_Exception(port,2)))) {
-		LazyFlags old_lflags;
-		memcpy(&old_lflags,&lflags,sizeof(LazyFlags));
-		CPU_Decoder * old_cpudecoder;
-		old_cpudecoder=cpudecoder;
-		cpudecoder=&IOFaultCore;
-		IOF_Entry * entry=&iof_queue.entries[iof_queue.used++];
-		entry->cs=SegValue(cs);
-		entry->eip=reg_eip;
-		CPU_Push16(SegValue(cs));
-		CPU_Push16(reg_ip);
-		Bit16u old_ax = reg_ax;
-		Bit16u old_dx = reg_dx;
-		reg_ax = val;
-		reg_dx = port;
-		RealPt icb = CALLBACK_RealPointer(call_priv_io);
-		SegSet16(cs,RealSeg(icb));
-		reg_eip = RealOff(icb)+0x0a;
-		CPU_Exception(cpu.exception.which,cpu.exception.error);
-
-		DOSBOX_RunMachine();
-		iof_queue.used--;
-
-		reg_ax = old_ax;
-		reg_dx = old_dx;
-		memcpy(&lflags,&old_lflags,sizeof(LazyFlags));
-		cpudecoder=old_cpudecoder;
-	}
-	else {
-		IO_USEC_write_delay();
-		io_writehandlers[1][port](port,val,2);
+/* Let the v86 monitor handle an access that raised an exception. The stubs at
+ * the private io callback do the access (reads first, then writes, for each
+ * width) and return to the faulting code.
+ */
+static Bitu IO_FaultAccess(Bitu port,Bitu val,Bitu width,bool write) {
+	LazyFlags old_lflags;
+	memcpy(&old_lflags,&lflags,sizeof(LazyFlags));
+	CPU_Decoder * old_cpudecoder;
+	old_cpudecoder=cpudecoder;
+	cpudecoder=&IOFaultCore;
+	IOF_Entry * entry=&iof_queue.entries[iof_queue.used++];
+	entry->cs=SegValue(cs);
+	entry->eip=reg_eip;
+	CPU_Push16(SegValue(cs));
+	CPU_Push16(reg_ip);
+	Bit32u old_eax = reg_eax;
+	Bit16u old_dx = reg_dx;
+	if (write) switch (width) {
+		case 0: reg_al = (Bit8u)val; break;
+		case 1: reg_ax = (Bit16u)val; break;
+		case 2: reg_eax = (Bit32u)val; break;
 	}
-}
-
-void IO_WriteD(Bitu port,Bitu val) {
-	log_io(2, true, port, val);
-	if (GCC_UNLIKELY(GETFLAG(VM) && (CPU_IO_Exception(port,4)))) {
-		LazyFlags old_lflags;
-		memcpy(&old_lflags,&lflags,sizeof(LazyFlags));
-		CPU_Decoder * old_cpudecoder;
-		old_cpudecoder=cpudecoder;
-		cpudecoder=&IOFaultCore;
-		IOF_Entry * entry=&iof_queue.entries[iof_queue.used++];
-		entry->cs=SegValue(cs);
-		entry->eip=reg_eip;
-		CPU_Push16(SegValue(cs));
-		CPU_Push16(reg_ip);
-		Bit32u old_eax = reg_eax;
-		Bit16u old_dx = reg_dx;
-		reg_eax = val;
-		reg_dx = port;
-		RealPt icb = CALLBACK_RealPointer(call_priv_io);
-		SegSet16(cs,RealSeg(icb));
-		reg_eip = RealOff(icb)+0x0c;
-		CPU_Exception(cpu.exception.which,cpu.exception.error);
-
-		DOSBOX_RunMachine();
-		iof_queue.used--;
-
-		reg_eax = old_eax;
-		reg_dx = old_dx;
-		memcpy(&lflags,&old_lflags,sizeof(LazyFlags));
-		cpudecoder=old_cpudecoder;
+	reg_dx = port;
+	RealPt icb = CALLBACK_RealPointer(call_priv_io);
+	SegSet16(cs,RealSeg(icb));
+	reg_eip = RealOff(icb)+(write ? 0x08 : 0x00)+width*2;
+	CPU_Exception(cpu.exception.which,cpu.exception.error);
+
+	DOSBOX_RunMachine();
+	iof_queue.used--;
+
+	Bitu retval = 0;
+	if (write) switch (width) {
+		case 0: reg_al = (Bit8u)old_eax; break;
+		case 1: reg_ax = (Bit16u)old_eax; break;
+		case 2: reg_eax = old_eax; break;
+	} else switch (width) {
+		case 0: retval = reg_al; break;
+		case 1: retval = reg_ax; break;
+		case 2: retval = reg_eax; break;
 	}
-	else io_writehandlers[2][port](port,val,4);
+	reg_dx = old_dx;
+	memcpy(&lflags,&old_lflags,sizeof(LazyFlags));
+	cpudecoder=old_cpudecoder;
+	return retval;
 }
 
-Bitu IO_ReadB(Bitu port) {
+/* The accesses go through the handler slot of the port, the recompiler looks
+ * the slot of a constant port up in advance and calls these directly.
+ */
+Bitu IO_ReadSlotB(Bitu port,IO_ReadHandler ** slot) {
 	Bitu retval;
-	if (GCC_UNLIKELY(GETFLAG(VM) && (CPU_IO_Exception(port,1)))) {
-		LazyFlags old_lflags;
-		memcpy(&old_lflags,&lflags,sizeof(LazyFlags));
-		CPU_Decoder * old_cpudecoder;
-		old_cpudecoder=cpudecoder;
-		cpudecoder=&IOFaultCore;
-		IOF_Entry * entry=&iof_queue.entries[iof_queue.used++];
-		entry->cs=SegValue(cs);
-		entry->eip=reg_eip;
-		CPU_Push16(SegValue(cs));
-		CPU_Push16(reg_ip);
-		Bit16u old_dx = reg_dx;
-		reg_dx = port;
-		RealPt icb = CALLBACK_RealPointer(call_priv_io);
-		SegSet16(cs,RealSeg(icb));
-		reg_eip = RealOff(icb)+0x00;
-		CPU_Exception(cpu.exception.which,cpu.exception.error);
-
-		DOSBOX_RunMachine();
-		iof_queue.used--;
-
-		retval = reg_al;
-		reg_dx = old_dx;
-		memcpy(&lflags,&old_lflags,sizeof(LazyFlags));
-		cpudecoder=old_cpudecoder;
-		return retval;
-	}
+	IO_Count(port,0);
+	if (GCC_UNLIKELY(GETFLAG(VM) && (CPU_IO_Exception(port,1)))) retval = IO_FaultAccess(port,0,0,false);
 	else {
 		IO_USEC_read_delay();
-		retval = io_readhandlers[0][port](port,1);
+		retval = (*slot)(port,1);
 	}
 	log_io(0, false, port, retval);
 	return retval;
 }
 
-Bitu IO_ReadW(Bitu port) {
+Bitu IO_ReadSlotW(Bitu port,IO_ReadHandler ** slot) {
 	Bitu retval;
-	if (GCC_UNLIKELY(GETFLAG(VM) && (CPU_IO_Exception(port,2)))) {
-		LazyFlags old_lflags;
-		memcpy(&old_lflags,&lflags,sizeof(LazyFlags));
-		CPU_Decoder * old_cpudecoder;
-		old_cpudecoder=cpudecoder;
-		cpudecoder=&IOFaultCore;
-		IOF_Entry * entry=&iof_queue.entries[iof_queue.used++];
-		entry->cs=SegValue(cs);
-		entry->eip=reg_eip;
-		CPU_Push16(SegValue(cs));
-		CPU_Push16(reg_ip);
-		Bit16u old_dx = reg_dx;
-		reg_dx = port;
-		RealPt icb = CALLBACK_RealPointer(call_priv_io);
-		SegSet16(cs,RealSeg(icb));
-		reg_eip = RealOff(icb)+0x02;
-		CPU_Exception(cpu.exception.which,cpu.exception.error);
-
-		DOSBOX_RunMachine();
-		iof_queue.used--;
-
-		retval = reg_ax;
-		reg_dx = old_dx;
-		memcpy(&lflags,&old_lflags,sizeof(LazyFlags));
-		cpudecoder=old_cpudecoder;
-	}
+	IO_Count(port,0);
+	if (GCC_UNLIKELY(GETFLAG(VM) && (CPU_IO_Exception(port,2)))) retval = IO_FaultAccess(port,0,1,false);
 	else {
 		IO_USEC_read_delay();
-		retval = io_readhandlers[1][port](port,2);
+		retval = (*slot)(port,2);
 	}
 	log_io(1, false, port, retval);
 	return retval;
 }
 
-Bitu IO_ReadD(Bitu port) {
+Bitu IO_ReadSlotD(Bitu port,IO_ReadHandler ** slot) {
 	Bitu retval;
-	if (GCC_UNLIKELY(GETFLAG(VM) && (CPU_IO_Exception(port,4)))) {
-		LazyFlags old_lflags;
-		memcpy(&old_lflags,&lflags,sizeof(LazyFlags));
-		CPU_Decoder * old_cpudecoder;
-		old_cpudecoder=cpudecoder;
-		cpudecoder=&IOFaultCore;
-		IOF_Entry * entry=&iof_queue.entries[iof_queue.used++];
-		entry->cs=SegValue(cs);
-		entry->eip=reg_eip;
-		CPU_Push16(SegValue(cs));
-		CPU_Push16(reg_ip);
-		Bit16u old_dx = reg_dx;
-		reg_dx = port;
-		RealPt icb = CALLBACK_RealPointer(call_priv_io);
-		SegSet16(cs,RealSeg(icb));
-		reg_eip = RealOff(icb)+0x04;
-		CPU_Exception(cpu.exception.which,cpu.exception.error);
-
-		DOSBOX_RunMachine();
-		iof_queue.used--;
-
-		retval = reg_eax;
-		reg_dx = old_dx;
-		memcpy(&lflags,&old_lflags,sizeof(LazyFlags));
-		cpudecoder=old_cpudecoder;
-	} else {
-		retval = io_readhandlers[2][port](port,4);
-	}
+	IO_Count(port,0);
+	if (GCC_UNLIKELY(GETFLAG(VM) && (CPU_IO_Exception(port,4)))) retval = IO_FaultAccess(port,0,2,false);
+	else retval = (*slot)(port,4);
 	log_io(2, false, port, retval);
 	return retval;
 }
 
+void IO_WriteSlotB(Bitu port,Bitu val,IO_WriteHandler ** slot) {
+	log_io(0, true, port, val);
+	IO_Count(port,1);
+	if (GCC_UNLIKELY(GETFLAG(VM) && (CPU_IO_Exception(port,1)))) IO_FaultAccess(port,val,0,true);
+	else {
+		IO_USEC_write_delay();
+		(*slot)(port,val,1);
+	}
+}
+
+void IO_WriteSlotW(Bitu port,Bitu val,IO_WriteHandler ** slot) {
+	log_io(1, true, port, val);
+	IO_Count(port,1);
+	if (GCC_UNLIKELY(GETFLAG(VM) && (CPU_IO_Exception(port,2)))) IO_FaultAccess(port,val,1,true);
+	else {
+		IO_USEC_write_delay();
+		(*slot)(port,val,2);
+	}
+}
+
+void IO_WriteSlotD(Bitu port,Bitu val,IO_WriteHandler ** slot) {
+	log_io(2, true, port, val);
+	IO_Count(port,1);
+	if (GCC_UNLIKELY(GETFLAG(VM) && (CPU_IO_Exception(port,4)))) IO_FaultAccess(port,val,2,true);
+	else (*slot)(port,val,4);
+}
+
+void IO_WriteB(Bitu port,Bitu val) {
+	IO_WriteSlotB(port,val,&IO_WRITEHANDLER(0,port));
+}
+
+void IO_WriteW(Bitu port,Bitu val) {
+	IO_WriteSlotW(port,val,&IO_WRITEHANDLER(1,port));
+}
+
+void IO_WriteD(Bitu port,Bitu val) {
+	IO_WriteSlotD(port,val,&IO_WRITEHANDLER(2,port));
+}
+
+Bitu IO_ReadB(Bitu port) {
+	return IO_ReadSlotB(port,&IO_READHANDLER(0,port));
+}
+
+Bitu IO_ReadW(Bitu port) {
+	return IO_ReadSlotW(port,&IO_READHANDLER(1,port));
+}
+
+Bitu IO_ReadD(Bitu port) {
+	return IO_ReadSlotD(port,&IO_READHANDLER(2,port));
+}
+
+struct IO_PortCount {
+	Bitu port;
+	Bit32u reads,writes;
+};
+
+static bool IO_PortBusier(const IO_PortCount & a,const IO_PortCount & b) {
+	return (Bit64u)a.reads+a.writes>(Bit64u)b.reads+b.writes;
+}
+
+#define IO_HISTOGRAM_PORTS 64
+#define IO_HISTOGRAM_FILE "io_histogram.txt"
+
+// write the most accessed ports to a text file
+static void IO_DumpHistogram(bool pressed) {
+	if (!pressed) return;
+	if (!io_counts) {
+		LOG_MSG("IO:Port access counting is disabled, set iohistogram=true");
+		return;
+	}
+	std::vector<IO_PortCount> ports;
+	Bit64u total=0;
+	for (Bitu port=0;port<IO_MAX;port++) {
+		IO_PortCount entry;
+		entry.port=port;
+		entry.reads=io_counts[port<<1];
+		entry.writes=io_counts[(port<<1)|1];
+		if (!entry.reads && !entry.writes) continue;
+		total+=(Bit64u)entry.reads+entry.writes;
+		ports.push_back(entry);
+	}
+	Bitu count=ports.size();
+	if (count>IO_HISTOGRAM_PORTS) count=IO_HISTOGRAM_PORTS;
+	std::partial_sort(ports.begin(),ports.begin()+count,ports.end(),IO_PortBusier);
+
+	FILE * f=fopen(IO_HISTOGRAM_FILE,"wt");
+	if (!f) {
+		LOG_MSG("IO:Can't write port histogram to %s",IO_HISTOGRAM_FILE);
+		return;
+	}
+	fprintf(f,"%d ports accessed, %.0f accesses\n\n",(int)ports.size(),(double)total);
+	fprintf(f,"rank  port       reads      writes  share\n");
+	for (Bitu i=0;i<count;i++) {
+		const IO_PortCount & entry=ports[i];
+		fprintf(f,"%4d  %04X  %10u  %10u  %5.1f%%\n",(int)(i+1),(int)entry.port,
+			entry.reads,entry.writes,100.0*((double)entry.reads+entry.writes)/(double)total);
+	}
+	fclose(f);
+	LOG_MSG("IO:Wrote the %d most accessed ports to %s",(int)count,IO_HISTOGRAM_FILE);
+}
+
 class IO :public Module_base {
 public:
 	IO(Section* configuration):Module_base(configuration){
+	Section_prop * section=static_cast<Section_prop *>(configuration);
 	iof_queue.used=0;
+	for (Bitu i=0;i<IO_BLOCK_SIZE;i++) {
+		for (Bitu w=0;w<3;w++) {
+			io_read_default.handler[w][i]=IO_ReadDefault;
+			io_write_default.handler[w][i]=IO_WriteDefault;
+		}
+	}
+	for (Bitu i=0;i<IO_BLOCKS;i++) {
+		// blocks that were allocated before are reset in place
+		if (!io_readblocks[i]) io_readblocks[i]=&io_read_default;
+		if (!io_writeblocks[i]) io_writeblocks[i]=&io_write_default;
+	}
 	IO_FreeReadHandler(0,IO_MA,IO_MAX);
 	IO_FreeWriteHandler(0,IO_MA,IO_MAX);
+	if (section->Get_bool("iohistogram")) {
+		if (!io_counts) io_counts=new Bit32u[IO_MAX*2];
+		memset(io_counts,0,IO_MAX*2*sizeof(Bit32u));
+	}
+	static bool mapper_added=false;
+	if (!mapper_added) {
+		MAPPER_AddHandler(IO_DumpHistogram,MK_f3,MMOD1|MMOD2,"iohistogram","IO Histogram");
+		mapper_added=true;
+	}
 	}
 	~IO()
 	{
-		//Same as the constructor ?
+		delete[] io_counts;
+		io_counts=NULL;
 	}
 };
 
@@ -25,6 +25,19 @@
 #include "regs.h"
 
 #include <string.h>
+#include <map>
+#include <set>
+
+#if (C_HAVE_MPROTECT)
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#endif
 
 #define PAGES_IN_BLOCK	((1024*1024)/MEM_PAGE_SIZE)
 #define SAFE_MEMORY	32
@@ -54,10 +67,23 @@ static struct MemoryBlock {
 		bool enabled;
 		Bit8u controlport;
 	} a20;
+	struct {
+		Bitu size;				// bytes of guest memory at MemBase
+		bool mapped;			// MemBase is a host mapping, not new[]
+		bool anonymous;			// released pages can be returned to the host
+	} base;
 } memory;
 
 HostPt MemBase;
 
+/* Runs of free pages above XMS_START, by start page for merging and
+   by size for finding the best fit */
+static struct {
+	std::map<Bitu,Bitu> by_start;			// start -> pages
+	std::set<std::pair<Bitu,Bitu> > by_size;	// (pages,start)
+	Bitu total;
+} mem_free;
+
 class IllegalPageHandler : public PageHandler {
 public:
 	IllegalPageHandler() {
@@ -209,29 +235,62 @@ Bitu MEM_TotalPages(void) {
 }
 
 Bitu MEM_FreeLargest(void) {
-	Bitu size=0;Bitu largest=0;
-	Bitu index=XMS_START;	
-	while (index<memory.pages) {
-		if (!memory.mhandles[index]) {
-			size++;
-		} else {
-			if (size>largest) largest=size;
-			size=0;
-		}
-		index++;
-	}
-	if (size>largest) largest=size;
-	return largest;
+	if (mem_free.by_size.empty()) return 0;
+	return mem_free.by_size.rbegin()->first;
 }
 
 Bitu MEM_FreeTotal(void) {
-	Bitu free=0;
-	Bitu index=XMS_START;	
-	while (index<memory.pages) {
-		if (!memory.mhandles[index]) free++;
-		index++;
+	return mem_free.total;
+}
+
+static void MEM_AddFreeRun(Bitu start,Bitu pages) {
+	mem_free.by_start[start]=pages;
+	mem_free.by_size.insert(std::make_pair(pages,start));
+}
+
+static void MEM_EraseFreeRun(std::map<Bitu,Bitu>::iterator run) {
+	mem_free.by_size.erase(std::make_pair(run->second,run->first));
+	mem_free.by_start.erase(run);
+}
+
+/* Mark pages as free, merging them with the neighbouring free runs */
+static void MEM_FreeRun(Bitu start,Bitu pages) {
+	if (!pages) return;
+	mem_free.total+=pages;
+	std::map<Bitu,Bitu>::iterator run=mem_free.by_start.lower_bound(start);
+	if (run!=mem_free.by_start.end() && run->first==start+pages) {
+		pages+=run->second;
+		std::map<Bitu,Bitu>::iterator merged=run++;
+		MEM_EraseFreeRun(merged);
 	}
-	return free;
+	if (run!=mem_free.by_start.begin()) {
+		--run;
+		if (run->first+run->second==start) {
+			start=run->first;
+			pages+=run->second;
+			MEM_EraseFreeRun(run);
+		}
+	}
+	MEM_AddFreeRun(start,pages);
+}
+
+/* Mark pages as used, they have to be inside a single free run */
+static void MEM_TakeRun(Bitu start,Bitu pages) {
+	std::map<Bitu,Bitu>::iterator run=mem_free.by_start.upper_bound(start);
+	--run;
+	Bitu run_start=run->first;
+	Bitu run_end=run->first+run->second;
+	MEM_EraseFreeRun(run);
+	if (start>run_start) MEM_AddFreeRun(run_start,start-run_start);
+	if (run_end>start+pages) MEM_AddFreeRun(start+pages,run_end-(start+pages));
+	mem_free.total-=pages;
+}
+
+/* Free pages starting at page */
+static Bitu MEM_FreeRunAt(Bitu page) {
+	std::map<Bitu,Bitu>::iterator run=mem_free.by_start.find(page);
+	if (run==mem_free.by_start.end()) return 0;
+	return run->second;
 }
 
 Bitu MEM_AllocatedPages(MemHandle handle) 
@@ -246,40 +305,33 @@ Bitu MEM_AllocatedPages(MemHandle handle)
 
 //TODO Maybe some protection for this whole allocation scheme
 
+/* The smallest free run that fits, the lowest one of those */
 INLINE Bitu BestMatch(Bitu size) {
-	Bitu index=XMS_START;	
-	Bitu first=0;
-	Bitu best=0xfffffff;
-	Bitu best_first=0;
-	while (index<memory.pages) {
-		/* Check if we are searching for first free page */
-		if (!first) {
-			/* Check if this is a free page */
-			if (!memory.mhandles[index]) {
-				first=index;	
-			}
-		} else {
-			/* Check if this still is used page */
-			if (memory.mhandles[index]) {
-				Bitu pages=index-first;
-				if (pages==size) {
-					return first;
-				} else if (pages>size) {
-					if (pages<best) {
-						best=pages;
-						best_first=first;
-					}
-				}
-				first=0;			//Always reset for new search
-			}
-		}
-		index++;
-	}
-	/* Check for the final block if we can */
-	if (first && (index-first>=size) && (index-first<best)) {
-		return first;
-	}
-	return best_first;
+	std::set<std::pair<Bitu,Bitu> >::iterator run=mem_free.by_size.lower_bound(std::make_pair(size,(Bitu)0));
+	if (run==mem_free.by_size.end()) return 0;
+	return run->second;
+}
+
+#if (C_HAVE_MPROTECT)
+static struct {
+	bool active;
+	Bitu pagesize;			// host page size, the unit of protection
+	HostPt copy;			// old contents of the pages written since the snapshot
+	Bit8u * saved;			// host page has been copied
+	struct sigaction old_segv,old_bus;
+} mem_snapshot;
+#endif
+
+/* Tell the host it can drop the contents of released pages, they are
+   zero again when touched the next time */
+static void MEM_DiscardPages(Bitu page,Bitu pages) {
+#if (C_HAVE_MPROTECT) && defined(MADV_DONTNEED)
+	if (!pages || !memory.base.anonymous || mem_snapshot.active) return;
+	Bitu host_mask=sysconf(_SC_PAGESIZE)-1;
+	Bitu start=(page*MEM_PAGESIZE+host_mask) & ~host_mask;
+	Bitu end=((page+pages)*MEM_PAGESIZE) & ~host_mask;
+	if (end>start) madvise(MemBase+start,end-start,MADV_DONTNEED);
+#endif
 }
 
 MemHandle MEM_AllocatePages(Bitu pages,bool sequence) {
@@ -288,6 +340,7 @@ MemHandle MEM_AllocatePages(Bitu pages,bool sequence) {
 	if (sequence) {
 		Bitu index=BestMatch(pages);
 		if (!index) return 0;
+		MEM_TakeRun(index,pages);
 		MemHandle * next=&ret;
 		while (pages) {
 			*next=index;
@@ -301,10 +354,14 @@ MemHandle MEM_AllocatePages(Bitu pages,bool sequence) {
 		while (pages) {
 			Bitu index=BestMatch(1);
 			if (!index) E_Exit("MEM:corruption during allocate");
-			while (pages && (!memory.mhandles[index])) {
+			Bitu run=MEM_FreeRunAt(index);
+			if (run>pages) run=pages;
+			MEM_TakeRun(index,run);
+			pages-=run;
+			while (run) {
 				*next=index;
 				next=&memory.mhandles[index];
-				index++;pages--;
+				index++;run--;
 			}
 			*next=-1;		//Invalidate it in case we need another match
 		}
@@ -317,11 +374,23 @@ MemHandle MEM_GetNextFreePage(void) {
 }
 
 void MEM_ReleasePages(MemHandle handle) {
+	Bitu run_start=0,run_pages=0;
 	while (handle>0) {
 		MemHandle next=memory.mhandles[handle];
+		if (!next) break;		//Already free
 		memory.mhandles[handle]=0;
+		/* Collect runs of pages to free and give back to the host */
+		if (run_pages && ((Bitu)handle==run_start+run_pages)) run_pages++;
+		else {
+			MEM_FreeRun(run_start,run_pages);
+			MEM_DiscardPages(run_start,run_pages);
+			run_start=handle;
+			run_pages=1;
+		}
 		handle=next;
 	}
+	MEM_FreeRun(run_start,run_pages);
+	MEM_DiscardPages(run_start,run_pages);
 }
 
 bool MEM_ReAllocatePages(MemHandle & handle,Bitu pages,bool sequence) {
@@ -352,25 +421,16 @@ bool MEM_ReAllocatePages(MemHandle & handle,Bitu pages,bool sequence) {
 		}
 		MemHandle next=memory.mhandles[index];
 		memory.mhandles[index]=-1;
-		index=next;
-		while (old_pages) {
-			next=memory.mhandles[index];
-			memory.mhandles[index]=0;
-			index=next;
-			old_pages--;
-		}
+		MEM_ReleasePages(next);
 		return true;
 	} else {
 		/* Increase size, check for enough free space */
 		Bitu need=pages-old_pages;
 		if (sequence) {
-			index=last+1;
-			Bitu free=0;
-			while ((index<(MemHandle)memory.pages) && !memory.mhandles[index]) {
-				index++;free++;
-			}
+			Bitu free=MEM_FreeRunAt(last+1);
 			if (free>=need) {
 				/* Enough space allocate more pages */
+				MEM_TakeRun(last+1,need);
 				index=last;
 				while (need) {
 					memory.mhandles[index]=index+1;
@@ -537,6 +597,142 @@ void PreparePCJRCartRom(void) {
 
 HostPt GetMemBase(void) { return MemBase; }
 
+/* Map the guest memory so the host only commits pages that get touched,
+   backed by file when one is given */
+static HostPt MEM_AllocateBase(Bitu size,const char * file) {
+	memory.base.size=size;
+	memory.base.mapped=false;
+	memory.base.anonymous=false;
+#if (C_HAVE_MPROTECT)
+	void * base=MAP_FAILED;
+	if (file && *file) {
+		int fd=open(file,O_RDWR|O_CREAT,0600);
+		/* Truncate first so the guest starts with zeroed memory */
+		if (fd>=0 && !ftruncate(fd,0) && !ftruncate(fd,size))
+			base=mmap(0,size,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+		if (fd>=0) close(fd);
+		if (base==MAP_FAILED) LOG_MSG("MEM:Can't map memory file %s, using anonymous memory",file);
+	}
+	if (base==MAP_FAILED) {
+		base=mmap(0,size,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+		if (base!=MAP_FAILED) memory.base.anonymous=true;
+	}
+	if (base!=MAP_FAILED) {
+		memory.base.mapped=true;
+		return (HostPt)base;
+	}
+#endif
+	HostPt mem=new Bit8u[size];
+	if (!mem) E_Exit("Can't allocate main memory of %d MB",size/(1024*1024));
+	/* Clear the memory, as new doesn't always give zeroed memory
+	 * (Visual C debug mode). We want zeroed memory though. */
+	memset((void*)mem,0,size);
+	return mem;
+}
+
+static void MEM_FreeBase(void) {
+#if (C_HAVE_MPROTECT)
+	MEM_SnapshotDrop();
+	if (memory.base.mapped) {
+		munmap(MemBase,memory.base.size);
+		return;
+	}
+#endif
+	delete [] MemBase;
+}
+
+#if (C_HAVE_MPROTECT)
+/* Write to guest memory protected by a snapshot, keep the old page */
+static void MEM_SnapshotFault(int sig,siginfo_t * info,void * context) {
+	HostPt addr=(HostPt)info->si_addr;
+	if (mem_snapshot.active && addr>=MemBase && addr<MemBase+memory.base.size) {
+		Bitu offset=(Bitu)(addr-MemBase) & ~(mem_snapshot.pagesize-1);
+		Bitu index=offset/mem_snapshot.pagesize;
+		if (!mem_snapshot.saved[index]) {
+			memcpy(mem_snapshot.copy+offset,MemBase+offset,mem_snapshot.pagesize);
+			mem_snapshot.saved[index]=1;
+		}
+		mprotect(MemBase+offset,mem_snapshot.pagesize,PROT_READ|PROT_WRITE);
+		return;
+	}
+	/* Not ours, pass it on to the handler that was installed before */
+	struct sigaction * old=(sig==SIGSEGV) ? &mem_snapshot.old_segv : &mem_snapshot.old_bus;
+	if (old->sa_flags & SA_SIGINFO) old->sa_sigaction(sig,info,context);
+	else if (old->sa_handler!=SIG_DFL && old->sa_handler!=SIG_IGN) old->sa_handler(sig);
+	else {
+		/* The access faults again and the default action ends the program */
+		signal(sig,SIG_DFL);
+	}
+}
+
+bool MEM_SnapshotTake(void) {
+	if (!memory.base.mapped) return false;
+	MEM_SnapshotDrop();
+	mem_snapshot.pagesize=sysconf(_SC_PAGESIZE);
+	void * copy=mmap(0,memory.base.size,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+	if (copy==MAP_FAILED) return false;
+	mem_snapshot.copy=(HostPt)copy;
+	Bitu pages=memory.base.size/mem_snapshot.pagesize;
+	mem_snapshot.saved=new Bit8u[pages];
+	memset(mem_snapshot.saved,0,pages);
+
+	struct sigaction action;
+	memset(&action,0,sizeof(action));
+	action.sa_sigaction=MEM_SnapshotFault;
+	action.sa_flags=SA_SIGINFO;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGSEGV,&action,&mem_snapshot.old_segv);
+	sigaction(SIGBUS,&action,&mem_snapshot.old_bus);
+	mem_snapshot.active=true;
+	mprotect(MemBase,memory.base.size,PROT_READ);
+	return true;
+}
+
+bool MEM_SnapshotRestore(void) {
+	if (!mem_snapshot.active) return false;
+	Bitu pages=memory.base.size/mem_snapshot.pagesize;
+	for (Bitu i=0;i<pages;i++) {
+		if (!mem_snapshot.saved[i]) continue;
+		Bitu offset=i*mem_snapshot.pagesize;
+		for (Bitu page=offset/MEM_PAGESIZE;page<(offset+mem_snapshot.pagesize)/MEM_PAGESIZE;page++) {
+			HostPt copy=mem_snapshot.copy+page*MEM_PAGESIZE;
+			if (!(memory.phandlers[page]->flags & PFLAG_HASCODE)) {
+				memcpy(MemBase+page*MEM_PAGESIZE,copy,MEM_PAGESIZE);
+				continue;
+			}
+			/* Go through the handler so translated code gets invalidated,
+			   it may release itself on the way */
+			for (Bitu addr=0;addr<MEM_PAGESIZE;addr+=4)
+				memory.phandlers[page]->writed(page*MEM_PAGESIZE+addr,host_readd(copy+addr));
+		}
+		mprotect(MemBase+offset,mem_snapshot.pagesize,PROT_READ);
+		mem_snapshot.saved[i]=0;
+	}
+	return true;
+}
+
+void MEM_SnapshotDrop(void) {
+	if (!mem_snapshot.active) return;
+	mem_snapshot.active=false;
+	mprotect(MemBase,memory.base.size,PROT_READ|PROT_WRITE);
+	sigaction(SIGSEGV,&mem_snapshot.old_segv,0);
+	sigaction(SIGBUS,&mem_snapshot.old_bus,0);
+	munmap(mem_snapshot.copy,memory.base.size);
+	delete [] mem_snapshot.saved;
+	mem_snapshot.copy=0;
+	mem_snapshot.saved=0;
+}
+#else
+bool MEM_SnapshotTake(void) {
+	return false;
+}
+bool MEM_SnapshotRestore(void) {
+	return false;
+}
+void MEM_SnapshotDrop(void) {
+}
+#endif
+
 class MEMORY:public Module_base{
 private:
 	IO_ReadHandleObject ReadHandler;
@@ -559,11 +755,8 @@ public:
 			LOG_MSG("Memory sizes above %d MB are NOT recommended.",SAFE_MEMORY - 1);
 			LOG_MSG("Stick with the default values unless you are absolutely certain.");
 		}
-		MemBase = new Bit8u[memsize*1024*1024];
-		if (!MemBase) E_Exit("Can't allocate main memory of %d MB",memsize);
-		/* Clear the memory, as new doesn't always give zeroed memory
-		 * (Visual C debug mode). We want zeroed memory though. */
-		memset((void*)MemBase,0,memsize*1024*1024);
+		Prop_path* memfile=section->Get_path("memfile");
+		MemBase=MEM_AllocateBase(memsize*1024*1024,memfile ? memfile->realpath.c_str() : 0);
 		memory.pages = (memsize*1024*1024)/4096;
 		/* Allocate the data for the different page information blocks */
 		memory.phandlers=new  PageHandler * [memory.pages];
@@ -572,6 +765,10 @@ public:
 			memory.phandlers[i] = &ram_page_handler;
 			memory.mhandles[i] = 0;				//Set to 0 for memory allocation
 		}
+		mem_free.by_start.clear();
+		mem_free.by_size.clear();
+		mem_free.total=0;
+		if (memory.pages>XMS_START) MEM_FreeRun(XMS_START,memory.pages-XMS_START);
 		/* Setup rom at 0xc0000-0xc8000 */
 		for (i=0xc0;i<0xc8;i++) {
 			memory.phandlers[i] = &rom_page_handler;
@@ -594,7 +791,7 @@ public:
 		MEM_A20_Enable(false);
 	}
 	~MEMORY(){
-		delete [] MemBase;
+		MEM_FreeBase();
 		delete [] memory.phandlers;
 		delete [] memory.mhandles;
 	}
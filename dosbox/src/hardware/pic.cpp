@@ -168,13 +168,22 @@ struct PICEntry {
 	float index;
 	Bitu value;
 	PIC_EventHandler pic_event;
-	PICEntry * next;
+	Bitu order;			// insertion order, keeps events with the same index in sequence
+	Bitu heap_pos;
+	PICEntry * next;	// free list
 };
 
+/* Pending events are kept in a binary min-heap on their index,
+ * the next event to run is heap[0].
+ */
 static struct {
 	PICEntry entries[PIC_QUEUESIZE];
 	PICEntry * free_entry;
-	PICEntry * next_entry;
+	PICEntry * heap[PIC_QUEUESIZE];
+	Bitu used;
+	Bitu order;
+	Bitu peak;
+	Bit64u events;
 } pic_queue;
 
 static void write_command(Bitu port,Bitu val,Bitu iolen) {
@@ -369,36 +378,82 @@ void PIC_SetIRQMask(Bitu irq, bool masked) {
 	pic->set_imr(newmask);
 }
 
-static void AddEntry(PICEntry * entry) {
-	PICEntry * find_entry=pic_queue.next_entry;
-	if (GCC_UNLIKELY(find_entry ==0)) {
-		entry->next=0;
-		pic_queue.next_entry=entry;
-	} else if (find_entry->index>entry->index) {
-		pic_queue.next_entry=entry;
-		entry->next=find_entry;
-	} else while (find_entry) {
-		if (find_entry->next) {
-			/* See if the next index comes later than this one */
-			if (find_entry->next->index > entry->index) {
-				entry->next=find_entry->next;
-				find_entry->next=entry;
-				break;
-			} else {
-				find_entry=find_entry->next;
-			}
-		} else {
-			entry->next=find_entry->next;
-			find_entry->next=entry;
-			break;
-		}
+static INLINE bool EntryBefore(const PICEntry * a,const PICEntry * b) {
+	if (a->index!=b->index) return a->index<b->index;
+	return (Bits)(a->order-b->order)<0;
+}
+
+static INLINE void HeapPlace(PICEntry * entry,Bitu pos) {
+	pic_queue.heap[pos]=entry;
+	entry->heap_pos=pos;
+}
+
+static void HeapUp(Bitu pos) {
+	PICEntry * entry=pic_queue.heap[pos];
+	while (pos>0) {
+		Bitu parent=(pos-1)>>1;
+		if (!EntryBefore(entry,pic_queue.heap[parent])) break;
+		HeapPlace(pic_queue.heap[parent],pos);
+		pos=parent;
+	}
+	HeapPlace(entry,pos);
+}
+
+static void HeapDown(Bitu pos) {
+	PICEntry * entry=pic_queue.heap[pos];
+	for (;;) {
+		Bitu child=pos*2+1;
+		if (child>=pic_queue.used) break;
+		if ((child+1<pic_queue.used) && EntryBefore(pic_queue.heap[child+1],pic_queue.heap[child])) child++;
+		if (!EntryBefore(pic_queue.heap[child],entry)) break;
+		HeapPlace(pic_queue.heap[child],pos);
+		pos=child;
 	}
-	Bits cycles=PIC_MakeCycles(pic_queue.next_entry->index-PIC_TickIndex());
+	HeapPlace(entry,pos);
+}
+
+static void AddEntry(PICEntry * entry) {
+	entry->order=pic_queue.order++;
+	HeapPlace(entry,pic_queue.used++);
+	HeapUp(entry->heap_pos);
+	if (pic_queue.used>pic_queue.peak) pic_queue.peak=pic_queue.used;
+	Bits cycles=PIC_MakeCycles(pic_queue.heap[0]->index-PIC_TickIndex());
 	if (cycles<CPU_Cycles) {
 		CPU_CycleLeft+=CPU_Cycles;
 		CPU_Cycles=0;
 	}
 }
+
+static INLINE void FreeEntry(PICEntry * entry) {
+	entry->next=pic_queue.free_entry;
+	pic_queue.free_entry=entry;
+}
+
+/* Take an entry out of the queue and put it in the free list */
+static void RemoveEntry(PICEntry * entry) {
+	Bitu pos=entry->heap_pos;
+	PICEntry * last=pic_queue.heap[--pic_queue.used];
+	if (last!=entry) {
+		HeapPlace(last,pos);
+		if (pos>0 && EntryBefore(last,pic_queue.heap[(pos-1)>>1])) HeapUp(pos);
+		else HeapDown(pos);
+	}
+	FreeEntry(entry);
+}
+
+/* Free all entries of a handler (with a specific value) and rebuild the heap from the rest */
+static void RemoveMatching(PIC_EventHandler handler,bool specific,Bitu val) {
+	Bitu kept=0;
+	for (Bitu i=0;i<pic_queue.used;i++) {
+		PICEntry * entry=pic_queue.heap[i];
+		if (GCC_UNLIKELY(entry->pic_event==handler) && (!specific || (entry->value==val))) FreeEntry(entry);
+		else HeapPlace(entry,kept++);
+	}
+	if (kept==pic_queue.used) return;
+	pic_queue.used=kept;
+	for (Bitu i=kept/2;i-->0;) HeapDown(i);
+}
+
 static bool InEventService = false;
 static float srv_lag = 0;
 
@@ -418,53 +473,11 @@ void PIC_AddEvent(PIC_EventHandler handler,float delay,Bitu val) {
 }
 
 void PIC_RemoveSpecificEvents(PIC_EventHandler handler, Bitu val) {
-	PICEntry * entry=pic_queue.next_entry;
-	PICEntry * prev_entry;
-	prev_entry = 0;
-	while (entry) {
-		if (GCC_UNLIKELY((entry->pic_event == handler)) && (entry->value == val)) {
-			if (prev_entry) {
-				prev_entry->next=entry->next;
-				entry->next=pic_queue.free_entry;
-				pic_queue.free_entry=entry;
-				entry=prev_entry->next;
-				continue;
-			} else {
-				pic_queue.next_entry=entry->next;
-				entry->next=pic_queue.free_entry;
-				pic_queue.free_entry=entry;
-				entry=pic_queue.next_entry;
-				continue;
-			}
-		}
-		prev_entry=entry;
-		entry=entry->next;
-	}	
+	RemoveMatching(handler,true,val);
 }
 
 void PIC_RemoveEvents(PIC_EventHandler handler) {
-	PICEntry * entry=pic_queue.next_entry;
-	PICEntry * prev_entry;
-	prev_entry=0;
-	while (entry) {
-		if (GCC_UNLIKELY(entry->pic_event==handler)) {
-			if (prev_entry) {
-				prev_entry->next=entry->next;
-				entry->next=pic_queue.free_entry;
-				pic_queue.free_entry=entry;
-				entry=prev_entry->next;
-				continue;
-			} else {
-				pic_queue.next_entry=entry->next;
-				entry->next=pic_queue.free_entry;
-				pic_queue.free_entry=entry;
-				entry=pic_queue.next_entry;
-				continue;
-			}
-		}
-		prev_entry=entry;
-		entry=entry->next;
-	}	
+	RemoveMatching(handler,false,0);
 }
 
 
@@ -478,22 +491,21 @@ bool PIC_RunQueue(void) {
 	/* Check the queue for an entry */
 	Bits index_nd=PIC_TickIndexND();
 	InEventService = true;
-	while (pic_queue.next_entry && (pic_queue.next_entry->index*CPU_CycleMax<=index_nd)) {
-		PICEntry * entry=pic_queue.next_entry;
-		pic_queue.next_entry=entry->next;
-
+	while (pic_queue.used && (pic_queue.heap[0]->index*CPU_CycleMax<=index_nd)) {
+		PICEntry * entry=pic_queue.heap[0];
+		PIC_EventHandler handler=entry->pic_event;
+		Bitu value=entry->value;
 		srv_lag = entry->index;
-		(entry->pic_event)(entry->value); // call the event handler
-
-		/* Put the entry in the free list */
-		entry->next=pic_queue.free_entry;
-		pic_queue.free_entry=entry;
+		/* Free the entry first, the handler may schedule new events */
+		RemoveEntry(entry);
+		pic_queue.events++;
+		handler(value); // call the event handler
 	}
 	InEventService = false;
 
 	/* Check when to set the new cycle end */
-	if (pic_queue.next_entry) {
-		Bits cycles=(Bits)(pic_queue.next_entry->index*CPU_CycleMax-index_nd);
+	if (pic_queue.used) {
+		Bits cycles=(Bits)(pic_queue.heap[0]->index*CPU_CycleMax-index_nd);
 		if (GCC_UNLIKELY(!cycles)) cycles=1;
 		if (cycles<CPU_CycleLeft) {
 			CPU_Cycles=cycles;
@@ -541,12 +553,9 @@ void TIMER_AddTick(void) {
 	CPU_CycleLeft=CPU_CycleMax;
 	CPU_Cycles=0;
 	PIC_Ticks++;
-	/* Go through the list of scheduled events and lower their index with 1000 */
-	PICEntry * entry=pic_queue.next_entry;
-	while (entry) {
-		entry->index -= 1.0;
-		entry=entry->next;
-	}
+	/* Go through the scheduled events and lower their index with 1000,
+	 * the order of the heap doesn't change */
+	for (Bitu i=0;i<pic_queue.used;i++) pic_queue.heap[i]->index -= 1.0;
 	/* Call our list of ticker handlers */
 	TickerBlock * ticker=firstticker;
 	while (ticker) {
@@ -600,15 +609,17 @@ public:
 		WriteHandler[2].Install(0xa0,write_command,IO_MB);
 		WriteHandler[3].Install(0xa1,write_data,IO_MB);
 		/* Initialize the pic queue */
-		for (i=0;i<PIC_QUEUESIZE-1;i++) {
-			pic_queue.entries[i].next=&pic_queue.entries[i+1];
-		}
+		for (i=0;i<PIC_QUEUESIZE-1;i++) pic_queue.entries[i].next=&pic_queue.entries[i+1];
 		pic_queue.entries[PIC_QUEUESIZE-1].next=0;
 		pic_queue.free_entry=&pic_queue.entries[0];
-		pic_queue.next_entry=0;
+		pic_queue.used=0;
+		pic_queue.order=0;
+		pic_queue.peak=0;
+		pic_queue.events=0;
 	}
 
 	~PIC_8259A(){
+		LOG_MSG("PIC:%.0f events run, at most %d pending",(double)pic_queue.events,(int)pic_queue.peak);
 	}
 };
 
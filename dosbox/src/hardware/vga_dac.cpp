@@ -58,6 +58,10 @@ static void VGA_DAC_SendColor( Bitu index, Bitu src ) {
 	vga.dac.xlat16[index] = ((blue>>1)&0x1f) | (((green)&0x3f)<<5) | (((red>>1)&0x1f) << 11);
 	
 	RENDER_SetPal( index, (red << 2) | ( red >> 4 ), (green << 2) | ( green >> 4 ), (blue << 2) | ( blue >> 4 ) );
+#ifdef VGA_KEEP_CHANGES
+	//The xlat16 lookup is applied while drawing, redraw every line
+	vga.changes.palette = true;
+#endif
 }
 
 static void VGA_DAC_UpdateColor( Bitu index ) {
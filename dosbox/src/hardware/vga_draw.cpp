@@ -136,34 +136,6 @@ static Bit8u * VGA_Draw_4BPP_Line_Double(Bitu vidstart, Bitu line) {
 	return TempLine;
 }
 
-#ifdef VGA_KEEP_CHANGES
-static Bit8u * VGA_Draw_Changes_Line(Bitu vidstart, Bitu line) {
-	Bitu checkMask = vga.changes.checkMask;
-	Bit8u *map = vga.changes.map;
-	Bitu start = (vidstart >> VGA_CHANGE_SHIFT);
-	Bitu end = ((vidstart + vga.draw.line_length ) >> VGA_CHANGE_SHIFT);
-	for (; start <= end;start++) {
-		if ( map[start] & checkMask ) {
-			Bitu offset = vidstart & vga.draw.linear_mask;
-			if (vga.draw.linear_mask-offset < vga.draw.line_length)
-				memcpy(vga.draw.linear_base+vga.draw.linear_mask+1, vga.draw.linear_base, vga.draw.line_length);
-			Bit8u *ret = &vga.draw.linear_base[ offset ];
-#if !defined(C_UNALIGNED_MEMORY)
-			if (GCC_UNLIKELY( ((Bitu)ret) & (sizeof(Bitu)-1)) ) {
-				memcpy( TempLine, ret, vga.draw.line_length );
-				return TempLine;
-			}
-#endif
-			return ret;
-		}
-	}
-//	memset( TempLine, 0x30, vga.changes.lineWidth );
-//	return TempLine;
-	return 0;
-}
-
-#endif
-
 static Bit8u * VGA_Draw_Linear_Line(Bitu vidstart, Bitu /*line*/) {
 	Bitu offset = vidstart & vga.draw.linear_mask;
 	Bit8u* ret = &vga.draw.linear_base[offset];
@@ -562,20 +534,86 @@ static Bit8u* VGA_TEXT_Xlat16_Draw_Line(Bitu vidstart, Bitu line) {
 }
 
 #ifdef VGA_KEEP_CHANGES
-static INLINE void VGA_ChangesEnd(void ) {
-	if ( vga.changes.active ) {
-//		vga.changes.active = false;
-		Bitu end = vga.draw.address >> VGA_CHANGE_SHIFT;
-		Bitu total = 4 + end - vga.changes.start;
-		Bit32u clearMask = vga.changes.clearMask;
-		total >>= 2;
-		Bit32u *clear = (Bit32u *)&vga.changes.map[  vga.changes.start & ~3 ];
-		while ( total-- ) {
-			clear[0] &= clearMask;
-			clear++;
+/* Everything besides the memory contents that decides what the lines of a frame
+ * look like, any difference to the last frame draws the whole frame */
+static struct VGA_ChangesLayout {
+	VGAModes mode;
+	VGA_Line_Handler drawline;
+	Bit8u * base;
+	Bitu mask;
+	Bitu address, address_add, address_line, address_line_total;
+	Bitu line_length, lines_total, split_line, panning;
+} changes_layout;
+
+/* Only the writes through the trapping handlers of the planar and mode 13h/X
+ * memory get recorded, the mapped handlers of the other modes write directly */
+static bool VGA_ChangesTracked(void) {
+	if (vga.draw.bpp!=8 && vga.draw.bpp!=16) return false;
+	switch (vga.mode) {
+	case M_EGA:
+		return true;
+	case M_VGA:
+		if (vga.config.chained) {
+			if (!vga.config.compatible_chain4) return false;
+			// the chained handler marks fastmem offsets, without doubleword mode
+			// the lines are drawn from the interleaved planes in mem.linear
+			if (!(vga.crtc.underline_location & 0x40)) return false;
 		}
+		// the linear frame buffer would write around the handlers
+		if ((svgaCard==SVGA_S3Trio) && (vga.s3.reg_58 & 0x10)) return false;
+		return true;
+	default:
+		return false;
 	}
 }
+
+static void VGA_ChangesStart(void) {
+	vga.changes.active = false;
+	vga.changes.skipped = 0;
+	if (!VGA_ChangesTracked()) {
+		vga.changes.complete = false;
+		return;
+	}
+	VGA_ChangesLayout layout;
+	memset(&layout,0,sizeof(layout));
+	layout.mode = vga.mode;
+	layout.drawline = VGA_DrawLine;
+	layout.base = vga.draw.linear_base;
+	layout.mask = vga.draw.linear_mask;
+	layout.address = vga.draw.address;
+	layout.address_add = vga.draw.address_add;
+	layout.address_line = vga.draw.address_line;
+	layout.address_line_total = vga.draw.address_line_total;
+	layout.line_length = vga.draw.line_length;
+	layout.lines_total = vga.draw.lines_total;
+	layout.split_line = vga.draw.split_line;
+	layout.panning = vga.draw.panning;
+	/* The render cache has to hold the last frame, so it must have been drawn
+	 * completely, and render must not want a full frame for its own reasons.
+	 * 8bpp lines are palette indices, render picks up dac changes by itself */
+	const bool palette = vga.changes.palette && (vga.draw.bpp != 8);
+	vga.changes.active = vga.changes.complete && !palette && !render.fullFrame &&
+		!memcmp(&layout,&changes_layout,sizeof(layout));
+	changes_layout = layout;
+	vga.changes.complete = false;
+	vga.changes.palette = false;
+	/* Start a new frame of writes, the ones of the frame before this are kept
+	 * for the lines that were drawn before they happened */
+	Bit32u * map = (Bit32u *)vga.changes.map;
+	for (Bitu i=0;i<vga.changes.mapsize/4;i++) map[i] = (map[i] >> 1) & 0x7f7f7f7f;
+}
+
+static INLINE bool VGA_LineChanged(Bitu vidstart) {
+	Bitu start = vidstart & vga.draw.linear_mask;
+	Bitu end = start + vga.draw.line_length - 1;
+	// lines wrapping around the end are copied together when drawn
+	if (GCC_UNLIKELY(end > vga.draw.linear_mask)) return true;
+	const Bit8u * map = vga.changes.map;
+	for (start >>= VGA_CHANGE_SHIFT, end >>= VGA_CHANGE_SHIFT; start <= end; start++) {
+		if (map[start]) return true;
+	}
+	return false;
+}
 #endif
 
 
@@ -692,7 +730,15 @@ static void VGA_DrawEGASingleLine(Bitu /*blah*/) {
 
 static void VGA_DrawPart(Bitu lines) {
 	while (lines--) {
-		Bit8u * data=VGA_DrawLine( vga.draw.address, vga.draw.address_line );
+		Bit8u * data;
+#ifdef VGA_KEEP_CHANGES
+		// render takes a null line as unchanged
+		if (vga.changes.active && !VGA_LineChanged(vga.draw.address)) {
+			data=0;
+			vga.changes.skipped++;
+		} else
+#endif
+		data=VGA_DrawLine( vga.draw.address, vga.draw.address_line );
 		RENDER_DrawLine(data);
 		vga.draw.address_line++;
 		if (vga.draw.address_line>=vga.draw.address_line_total) {
@@ -700,22 +746,17 @@ static void VGA_DrawPart(Bitu lines) {
 			vga.draw.address+=vga.draw.address_add;
 		}
 		vga.draw.lines_done++;
-		if (vga.draw.split_line==vga.draw.lines_done) {
-#ifdef VGA_KEEP_CHANGES
-			VGA_ChangesEnd( );
-#endif
-			VGA_ProcessSplit();
-#ifdef VGA_KEEP_CHANGES
-			vga.changes.start = vga.draw.address >> VGA_CHANGE_SHIFT;
-#endif
-		}
+		if (vga.draw.split_line==vga.draw.lines_done) VGA_ProcessSplit();
 	}
 	if (--vga.draw.parts_left) {
 		PIC_AddEvent(VGA_DrawPart,(float)vga.draw.delay.parts,
 			 (vga.draw.parts_left!=1) ? vga.draw.parts_lines  : (vga.draw.lines_total - vga.draw.lines_done));
 	} else {
 #ifdef VGA_KEEP_CHANGES
-		VGA_ChangesEnd();
+		vga.changes.complete=true;
+		vga.changes.skipped_last=vga.changes.skipped;
+		vga.changes.total_skipped+=vga.changes.skipped;
+		vga.changes.total_lines+=vga.draw.lines_total;
 #endif
 		RENDER_EndUpdate(false);
 	}
@@ -736,29 +777,6 @@ void VGA_SetBlinking(Bitu enabled) {
 	for (Bitu i=0;i<8;i++) TXT_BG_Table[i+8]=(b+i) | ((b+i) << 8)| ((b+i) <<16) | ((b+i) << 24);
 }
 
-#ifdef VGA_KEEP_CHANGES
-static void INLINE VGA_ChangesStart( void ) {
-	vga.changes.start = vga.draw.address >> VGA_CHANGE_SHIFT;
-	vga.changes.last = vga.changes.start;
-	if ( vga.changes.lastAddress != vga.draw.address ) {
-//		LOG_MSG("Address");
-		VGA_DrawLine = VGA_Draw_Linear_Line;
-		vga.changes.lastAddress = vga.draw.address;
-	} else if ( render.fullFrame ) {
-//		LOG_MSG("Full Frame");
-		VGA_DrawLine = VGA_Draw_Linear_Line;
-	} else {
-//		LOG_MSG("Changes");
-		VGA_DrawLine = VGA_Draw_Changes_Line;
-	}
-	vga.changes.active = true;
-	vga.changes.checkMask = vga.changes.writeMask;
-	vga.changes.clearMask = ~( 0x01010101 << (vga.changes.frame & 7));
-	vga.changes.frame++;
-	vga.changes.writeMask = 1 << (vga.changes.frame & 7);
-}
-#endif
-
 static void VGA_VertInterrupt(Bitu /*val*/) {
 	if ((!vga.draw.vret_triggered) && ((vga.crtc.vertical_retrace_end&0x30)==0x10)) {
 		vga.draw.vret_triggered=true;
@@ -835,9 +853,6 @@ static void VGA_VerticalTimer(Bitu /*val*/) {
 		vga.draw.split_line++; // EGA adds one buggy scanline
 	}
 //	if (machine==MCH_EGA) vga.draw.split_line = ((((vga.config.line_compare&0x5ff)+1)*2-1)/vga.draw.lines_scaled);
-#ifdef VGA_KEEP_CHANGES
-	bool startaddr_changed=false;
-#endif
 	switch (vga.mode) {
 	case M_EGA:
 		if (!(vga.crtc.mode_control&0x1)) vga.draw.linear_mask &= ~0x10000;
@@ -847,9 +862,6 @@ static void VGA_VerticalTimer(Bitu /*val*/) {
 		vga.draw.address += vga.draw.bytes_skip;
 		vga.draw.address *= vga.draw.byte_panning_shift;
 		if (machine!=MCH_EGA) vga.draw.address += vga.draw.panning;
-#ifdef VGA_KEEP_CHANGES
-		startaddr_changed=true;
-#endif
 		break;
 	case M_VGA:
 		if (vga.config.compatible_chain4 && (vga.crtc.underline_location & 0x40)) {
@@ -867,9 +879,6 @@ static void VGA_VerticalTimer(Bitu /*val*/) {
 		vga.draw.address += vga.draw.bytes_skip;
 		vga.draw.address *= vga.draw.byte_panning_shift;
 		vga.draw.address += vga.draw.panning;
-#ifdef VGA_KEEP_CHANGES
-		startaddr_changed=true;
-#endif
 		break;
 	case M_TEXT:
 		vga.draw.byte_panning_shift = 2;
@@ -904,9 +913,6 @@ static void VGA_VerticalTimer(Bitu /*val*/) {
 		break;
 	}
 	if (GCC_UNLIKELY(vga.draw.split_line==0)) VGA_ProcessSplit();
-#ifdef VGA_KEEP_CHANGES
-	if (startaddr_changed) VGA_ChangesStart();
-#endif
 
 	// check if some lines at the top off the screen are blanked
 	float draw_skip = 0.0;
@@ -925,6 +931,9 @@ static void VGA_VerticalTimer(Bitu /*val*/) {
 		}
 		vga.draw.lines_done = 0;
 		vga.draw.parts_left = vga.draw.parts_total;
+#ifdef VGA_KEEP_CHANGES
+		VGA_ChangesStart();
+#endif
 		PIC_AddEvent(VGA_DrawPart,(float)vga.draw.delay.parts + draw_skip,vga.draw.parts_lines);
 		break;
 	case LINE:
@@ -1512,8 +1521,7 @@ void VGA_SetupDrawing(Bitu /*val*/) {
 	vga.draw.line_length = width * ((bpp + 1) / 8);
 #ifdef VGA_KEEP_CHANGES
 	vga.changes.active = false;
-	vga.changes.frame = 0;
-	vga.changes.writeMask = 1;
+	vga.changes.complete = false;
 #endif
     /* 
 	   Cheap hack to just make all > 640x480 modes have 4:3 aspect ratio